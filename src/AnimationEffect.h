@@ -0,0 +1,75 @@
+/**
+* @file        :AnimationEffect.h
+* @brief       :照片动画师的关键帧动画
+* @details     :N个节点的相机位置、朝向和fov，节点之间按阶段时长插值；交互渲染、GL导出和CPU导出共用
+* @date        :2024/12/06 15:08:30
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef ANIMATIONEFFECT_H
+#define ANIMATIONEFFECT_H
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+// 照片动画N个节点，N-1个区间段，如果首尾节点数据保持一致，表示回到原处状态
+struct AnimationEffect {
+    std::vector<glm::vec3> CameraPosNodes;  // 动画在N个节点上的相机位置
+    std::vector<glm::quat> CameraRotNodes;  // 动画在N个节点上的相机朝向四元数
+    std::vector<float> FovNodes;            // 动画在N个节点上的fov角度
+
+    std::vector<float> stagesDuration;  // 每个阶段的时长（N-1个阶段）,长度比上面数组少1
+
+    // 计算动画的总时长
+    float getTotalDuration() const {
+        float totalDuration = 0.0f;
+        for (size_t i = 0; i < stagesDuration.size(); i++) {
+            totalDuration += stagesDuration[i];
+        }
+        return totalDuration;
+    }
+
+    // 获取当前阶段的插值进度
+    float getStageProgress(float currentTime) const {
+        float accumulatedTime = 0.0f;
+
+        for (size_t i = 0; i < stagesDuration.size(); i++) {
+            accumulatedTime += stagesDuration[i];
+            if (currentTime <= accumulatedTime) {
+                float stageStartTime = accumulatedTime - stagesDuration[i];
+                return glm::clamp((currentTime - stageStartTime) / stagesDuration[i], 0.0f, 1.0f);
+            }
+        }
+        return 1.0f;  // 动画结束
+    }
+
+    // 获取当前阶段的参数（例如：相机位置，方向，fov）
+    void getInterpolatedParams(float currentTime, glm::vec3 &cameraPos, glm::quat &cameraRot, float &fov) const {
+        float progress = getStageProgress(currentTime);
+
+        // 处理插值
+        float accumulatedStageTime = 0.0f;
+        for (size_t i = 0; i < stagesDuration.size(); i++) {
+            float stageStartTime = accumulatedStageTime;
+            accumulatedStageTime += stagesDuration[i];  // 累加前面的阶段时长
+
+            if (currentTime <= stageStartTime + stagesDuration[i]) {
+                // 线性插值计算相机位置和fov
+                cameraPos = glm::mix(CameraPosNodes[i], CameraPosNodes[i + 1], progress);
+                fov = glm::mix(FovNodes[i], FovNodes[i + 1], progress);
+
+                // 使用slerp对四元数进行插值，计算相机朝向
+                cameraRot = glm::slerp(CameraRotNodes[i], CameraRotNodes[i + 1], progress);
+                break;
+            }
+        }
+    }
+};
+
+#endif  // ANIMATIONEFFECT_H
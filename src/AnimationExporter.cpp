@@ -0,0 +1,228 @@
+/**
+* @file        :AnimationExporter.cpp
+* @brief       :照片动画师视频的后台并行导出实现
+* @details     :工作线程通过原子计数领取帧序号；只有当帧序号落在 [m_nextWrite, m_nextWrite + 容量) 窗口内才开始渲染，
+*               窗口最前面的帧总是已经被某个线程领取，因此不会死锁
+* @date        :2026/10/16 18:05:40
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "AnimationExporter.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include "PanoramaRenderer.h"
+#include "TraceRecorder.h"
+
+AnimationExporter::AnimationExporter()
+    : m_loadedTileLevel(-1), m_nextWrite(0), m_reorderCapacity(0), m_sourceReady(false), m_nextFrame(0), m_framesWritten(0), m_totalFrames(0), m_cancel(false), m_state(State::IDLE), m_startTick(0.0) {
+    m_reprojector.setThreadCount(1);
+}
+
+AnimationExporter::~AnimationExporter() {
+    cancel();
+    wait();
+}
+
+bool AnimationExporter::start(const Job &job) {
+    if (isRunning()) {
+        std::cerr << "Export already in progress!" << std::endl;
+        return false;
+    }
+    wait();  // 回收上一次导出的线程
+
+    if (job.effect.stagesDuration.empty() || job.fps <= 0 || job.width <= 0 || job.height <= 0) {
+        std::cerr << "No animation effect to export!" << std::endl;
+        return false;
+    }
+    bool fromTiles = job.panorama.empty() && job.tileSource;
+    if (fromTiles) {
+        if (job.tileLevel < 0 || job.tileLevel >= job.tileSource->getLevelCount()) {
+            std::cerr << "Invalid tile level for export: " << job.tileLevel << std::endl;
+            return false;
+        }
+    } else {
+        if (!m_reprojector.setSource(job.panorama)) {
+            return false;
+        }
+        m_loadedTileSource.reset();
+    }
+    m_writer.open(job.outputFile, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), job.fps, cv::Size(job.width, job.height));
+    if (!m_writer.isOpened()) {
+        std::cerr << "Cannot open video file for writing: " << job.outputFile << std::endl;
+        return false;
+    }
+
+    m_job = job;
+    if (job.remapCacheBytes > 0) {
+        m_remapCache.setBudget(job.remapCacheBytes);
+    } else {
+        m_remapCache.clear();
+    }
+    m_remapCache.resetStats();  // 每次导出单独统计，已缓存的查找表保留
+    m_job.panorama = cv::Mat();  // 源图已经转换到 m_reprojector 中
+    int workers = job.workers > 0 ? job.workers : (int)std::thread::hardware_concurrency() - 1;
+    workers = std::max(1, workers);
+    m_reorderCapacity = job.reorderFrames > 0 ? job.reorderFrames : 2 * workers;
+    m_totalFrames = (int)std::ceil(job.effect.getTotalDuration() * job.fps);
+    m_pending.clear();
+    // 同时存在的帧最多为缓冲区中的帧加上各线程正在渲染和编码的帧
+    m_framePool.setMaxFrames(m_reorderCapacity + workers + 1);
+    m_framePool.setFormat(job.height, job.width, CV_8UC3);
+    m_nextWrite = 0;
+    m_nextFrame = 0;
+    m_sourceReady = !fromTiles || (m_loadedTileSource == job.tileSource && m_loadedTileLevel == job.tileLevel && m_reprojector.hasSource());
+    m_framesWritten = 0;
+    m_cancel = false;
+    m_state = State::RUNNING;
+    m_startTick = (double)cv::getTickCount();
+
+    m_encoder = std::thread(&AnimationExporter::encoderLoop, this);
+    for (int i = 0; i < workers; i++) {
+        m_workers.emplace_back(&AnimationExporter::workerLoop, this);
+    }
+    printf("[export] %s: %d frames %dx%d@%d, %d render threads\n", job.outputFile.c_str(), m_totalFrames, job.width, job.height, job.fps, workers);
+    return true;
+}
+
+bool AnimationExporter::run(const Job &job) {
+    if (!start(job)) return false;
+    wait();
+    return getState() == State::FINISHED;
+}
+
+void AnimationExporter::cancel() {
+    if (!isRunning()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancel = true;
+    }
+    m_frameReady.notify_all();
+    m_slotFree.notify_all();
+}
+
+void AnimationExporter::wait() {
+    for (std::thread &worker : m_workers) {
+        if (worker.joinable()) worker.join();
+    }
+    m_workers.clear();
+    if (m_encoder.joinable()) m_encoder.join();
+}
+
+void AnimationExporter::workerLoop() {
+    TraceRecorder::instance().setThreadName("export worker");
+    while (!m_cancel) {
+        int index = m_nextFrame++;
+        if (index >= m_totalFrames) break;
+
+        // 等待帧序号进入重排序窗口，避免领先编码线程太多
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_slotFree.wait(lock, [&] { return m_cancel || (m_sourceReady && index < m_nextWrite + m_reorderCapacity); });
+            if (m_cancel) break;
+        }
+
+        // 与交互渲染相同的插值和矩阵，直接按输出尺寸和宽高比渲染，不需要再缩放
+        glm::vec3 cameraPosition;
+        glm::quat cameraOrientation;
+        float fov;
+        m_job.effect.getInterpolatedParams((float)index / m_job.fps, cameraPosition, cameraOrientation, fov);
+        glm::mat4 projection, view;
+        PanoramaRenderer::getAnimationMatrices(cameraPosition, cameraOrientation, fov, (float)m_job.width / m_job.height, projection, view);
+        cv::Mat frame = m_framePool.acquire();  // 编码线程写完后归还，稳定后不再分配新内存
+        {
+            TraceScope trace("cpu render frame");
+            if (m_job.remapCacheBytes > 0) {
+                RemapCache::Key key = RemapCache::makeKey(cameraPosition, cameraOrientation, fov, m_job.width, m_job.height, m_reprojector.getSourceWidth(), m_reprojector.getSourceHeight());
+                m_reprojector.renderCached(m_remapCache, key, projection, view, m_job.width, m_job.height, frame);
+            } else {
+                m_reprojector.render(projection, view, m_job.width, m_job.height, frame);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending[index] = frame;
+        }
+        m_frameReady.notify_one();
+    }
+}
+
+bool AnimationExporter::loadTileSource() {
+    cv::Mat image;
+    bool ok;
+    {
+        TraceScope trace("read tile level");
+        ok = m_job.tileSource->readLevel(m_job.tileLevel, image) && m_reprojector.setSource(image);
+    }
+    if (ok) {
+        m_loadedTileSource = m_job.tileSource;
+        m_loadedTileLevel = m_job.tileLevel;
+        printf("[export] source %dx%d from tile level %d\n", image.cols, image.rows, m_job.tileLevel);
+    } else {
+        std::cerr << "Cannot read tile level " << m_job.tileLevel << " for export." << std::endl;
+        m_loadedTileSource.reset();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sourceReady = ok;
+        if (!ok) m_cancel = true;
+    }
+    m_slotFree.notify_all();
+    return ok;
+}
+
+void AnimationExporter::encoderLoop() {
+    TraceRecorder::instance().setThreadName("export encoder");
+    // 工作线程在源图就绪前等待，拼图在这里进行，调用 start 的线程（交互时为渲染线程）不会卡住
+    if (!m_sourceReady) {
+        loadTileSource();
+    }
+    double lastReport = m_startTick;
+    for (int index = 0; index < m_totalFrames; index++) {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_frameReady.wait(lock, [&] { return m_cancel || m_pending.count(index) > 0; });
+            if (m_cancel) break;
+            frame = m_pending[index];
+            m_pending.erase(index);
+            m_nextWrite = index + 1;
+        }
+        m_slotFree.notify_all();
+
+        {
+            TraceScope trace("encode frame");
+            m_writer.write(frame);
+        }
+        m_framePool.release(frame);
+        m_framesWritten++;
+
+        double now = (double)cv::getTickCount();
+        if ((now - lastReport) / cv::getTickFrequency() >= 1.0) {
+            printf("[export] %d/%d frames\n", m_framesWritten.load(), m_totalFrames);
+            lastReport = now;
+        }
+    }
+    m_writer.release();
+    m_framePool.clear();
+
+    double seconds = ((double)cv::getTickCount() - m_startTick) / cv::getTickFrequency();
+    if (m_cancel) {
+        std::remove(m_job.outputFile.c_str());
+        printf("[export] cancelled after %d/%d frames\n", m_framesWritten.load(), m_totalFrames);
+        m_state = State::CANCELLED;
+    } else {
+        printf("[export] %s done: %d frames in %.2f s (%.1f fps)\n", m_job.outputFile.c_str(), m_totalFrames, seconds, seconds > 0 ? m_totalFrames / seconds : 0.0);
+        m_state = State::FINISHED;
+    }
+    if (m_job.remapCacheBytes > 0) {
+        RemapCache::Stats stats = m_remapCache.getStats();
+        printf("[export] remap cache: %ld hits, %ld misses (%.0f%%), %ld evictions, %zu tables %.1f/%.1f MB\n", stats.hits, stats.misses, stats.hitRate() * 100.0, stats.evictions,
+               stats.entries, stats.bytes / 1048576.0, m_remapCache.getBudget() / 1048576.0);
+    }
+}
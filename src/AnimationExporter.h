@@ -0,0 +1,105 @@
+/**
+* @file        :AnimationExporter.h
+* @brief       :照片动画师视频的后台并行导出
+* @details     :多个工作线程各自用 CpuReprojector 渲染不同的帧（帧级并行，吞吐量随核数增长），渲染好的帧放入重排序缓冲区，
+*               单独的编码线程按帧序号依次写入 cv::VideoWriter。重排序缓冲区有容量上限，工作线程领先编码线程太多时会等待，
+*               因此内存占用与视频长度无关。导出在后台进行，不阻塞渲染线程，可以随时取消
+* @date        :2026/10/16 18:05:40
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef ANIMATIONEXPORTER_H
+#define ANIMATIONEXPORTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "AnimationEffect.h"
+#include "CpuReprojector.h"
+#include "FramePool.h"
+#include "TileSource.h"
+
+class AnimationExporter {
+   public:
+    enum class State { IDLE,
+                       RUNNING,
+                       FINISHED,
+                       CANCELLED };
+
+    struct Job {
+        std::string outputFile;
+        int width = 1920;
+        int height = 1080;
+        int fps = 30;
+        AnimationEffect effect;  // 导出时拷贝一份，之后交互修改动画不影响正在进行的导出
+        cv::Mat panorama;        // 等距柱状投影全景图（BGR）
+        std::shared_ptr<TileSource> tileSource;  // panorama 为空时在编码线程上由它的第 tileLevel 层拼出源图（分页缓存文件没有原图），不阻塞调用线程
+        int tileLevel = 0;
+        int workers = 0;         // 渲染线程数，0 表示硬件线程数减一（留一个给编码线程）
+        int reorderFrames = 0;   // 重排序缓冲区最多容纳的帧数，0 表示工作线程数的两倍
+        size_t remapCacheBytes = 256u << 20;  // 查找表缓存的内存预算，缓存在多次导出之间保留；0 表示每帧直接重投影
+    };
+
+    AnimationExporter();
+    // 析构时取消并等待正在进行的导出
+    ~AnimationExporter();
+
+    // 打开输出文件并启动后台导出，正在导出或输出文件打不开时返回 false
+    bool start(const Job &job);
+    // 同步导出，返回是否完整写出所有帧
+    bool run(const Job &job);
+    // 请求取消，线程会尽快结束，未完成的输出文件会被删除
+    void cancel();
+    // 等待后台线程结束
+    void wait();
+
+    State getState() const { return m_state.load(); }
+    bool isRunning() const { return m_state.load() == State::RUNNING; }
+    int getFramesWritten() const { return m_framesWritten.load(); }
+    int getTotalFrames() const { return m_totalFrames; }
+    RemapCache::Stats getRemapCacheStats() const { return m_remapCache.getStats(); }
+
+   private:
+    void workerLoop();
+    void encoderLoop();
+    // 由 m_job.tileSource 拼出源图，完成或失败后唤醒等待的工作线程
+    bool loadTileSource();
+
+    Job m_job;
+    CpuReprojector m_reprojector;  // 所有工作线程共用，每个线程单线程渲染整帧
+    RemapCache m_remapCache;       // 相同相机参数和尺寸的帧（重复导出同一动画）只按表取像素
+    std::shared_ptr<TileSource> m_loadedTileSource;  // m_reprojector 当前的源图来自这个分页数据源的 m_loadedTileLevel 层，再次导出时不重新拼
+    int m_loadedTileLevel;
+    cv::VideoWriter m_writer;
+    std::vector<std::thread> m_workers;
+    std::thread m_encoder;
+
+    // 重排序缓冲区：帧序号 -> 已渲染的帧，编码线程只取序号等于 m_nextWrite 的帧
+    std::mutex m_mutex;
+    std::condition_variable m_frameReady;  // 有新帧放入缓冲区
+    std::condition_variable m_slotFree;    // 编码线程取走一帧，窗口前移
+    std::map<int, cv::Mat> m_pending;
+    FramePool m_framePool;  // 帧内存在工作线程和编码线程之间循环使用
+    int m_nextWrite;
+    int m_reorderCapacity;
+    bool m_sourceReady;  // 源图已设置，工作线程可以开始渲染
+
+    std::atomic<int> m_nextFrame;  // 下一个待渲染的帧序号
+    std::atomic<int> m_framesWritten;
+    int m_totalFrames;
+    std::atomic<bool> m_cancel;
+    std::atomic<State> m_state;
+    double m_startTick;
+};
+
+#endif  // ANIMATIONEXPORTER_H
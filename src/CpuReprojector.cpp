@@ -0,0 +1,423 @@
+/**
+* @file        :CpuReprojector.cpp
+* @brief       :纯CPU的全景重投影渲染器实现
+* @details     :标量和 NEON 内核在本文件中；SSE4.1 和 AVX2 内核在各自以对应指令集参数编译的文件中，
+*               运行时检测 CPU 后选择（PANO_SIMD_X86 由 CMake 在 x86 平台上定义）
+* @date        :2026/10/16 16:02:45
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "CpuReprojector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "CpuReprojectorKernels.h"
+
+#if defined(PANO_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PANO_SIMD_NEON 1
+#endif
+
+using namespace reproject;
+
+void reprojectRowScalar(const ReprojectSource &src, const ReprojectRow &row) {
+    for (int x = 0; x < row.width; x++) {
+        reprojectPixel(src, row, x);
+    }
+}
+
+#ifdef PANO_SIMD_NEON
+static inline float32x4_t atan2NEON(float32x4_t y, float32x4_t x) {
+    float32x4_t ax = vabsq_f32(x), ay = vabsq_f32(y);
+    float32x4_t mx = vmaxq_f32(ax, ay), mn = vminq_f32(ax, ay);
+    float32x4_t a = vdivq_f32(mn, vmaxq_f32(mx, vdupq_n_f32(1e-30f)));
+    float32x4_t s = vmulq_f32(a, a);
+    float32x4_t p = vfmaq_f32(vdupq_n_f32(kAtan9), s, vdupq_n_f32(kAtan11));
+    p = vfmaq_f32(vdupq_n_f32(kAtan7), s, p);
+    p = vfmaq_f32(vdupq_n_f32(kAtan5), s, p);
+    p = vfmaq_f32(vdupq_n_f32(kAtan3), s, p);
+    p = vfmaq_f32(vdupq_n_f32(kAtan1), s, p);
+    float32x4_t r = vmulq_f32(a, p);
+    r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(kHalfPi), r), r);
+    r = vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(kPi), r), r);
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(y), vdupq_n_u32(0x80000000u));
+    return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(r), sign));
+}
+
+static inline float32x4_t channelNEON(uint32x4_t pixels, int shift) {
+    return vcvtq_f32_u32(vandq_u32(vshlq_u32(pixels, vdupq_n_s32(-shift)), vdupq_n_u32(0xff)));
+}
+
+// NEON 没有 gather 指令，按算好的索引逐个读取源像素
+static inline uint32x4_t loadPixelsNEON(const uint32_t *base, uint32x4_t index) {
+    uint32_t idx[4], pixels[4];
+    vst1q_u32(idx, index);
+    for (int i = 0; i < 4; i++) pixels[i] = base[idx[i]];
+    return vld1q_u32(pixels);
+}
+
+void reprojectRowNEON(const ReprojectSource &src, const ReprojectRow &row) {
+    const float laneInit[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    const float32x4_t laneOffsets = vld1q_f32(laneInit);
+    const float cValue = row.origin[0] * row.origin[0] + row.origin[1] * row.origin[1] + row.origin[2] * row.origin[2] - 1.0f;
+    const float32x4_t zero = vdupq_n_f32(0.0f), half = vdupq_n_f32(0.5f), minT = vdupq_n_f32(kMinT);
+    const int32x4_t widthI = vdupq_n_s32(src.width), lastRow = vdupq_n_s32(src.height - 1), zeroI = vdupq_n_s32(0);
+
+    int x = 0;
+    uint32_t packed[4];
+    for (; x + 4 <= row.width; x += 4) {
+        float32x4_t xs = vaddq_f32(vdupq_n_f32((float)x), laneOffsets);
+        float32x4_t dx = vaddq_f32(vdupq_n_f32(row.dir[0]), vmulq_f32(xs, vdupq_n_f32(row.step[0])));
+        float32x4_t dy = vaddq_f32(vdupq_n_f32(row.dir[1]), vmulq_f32(xs, vdupq_n_f32(row.step[1])));
+        float32x4_t dz = vaddq_f32(vdupq_n_f32(row.dir[2]), vmulq_f32(xs, vdupq_n_f32(row.step[2])));
+
+        float32x4_t px = dx, py = dy, pz = dz;
+        uint32x4_t valid = vdupq_n_u32(0xffffffffu);
+        if (!row.centered) {
+            float32x4_t oX = vdupq_n_f32(row.origin[0]), oY = vdupq_n_f32(row.origin[1]), oZ = vdupq_n_f32(row.origin[2]);
+            float32x4_t a = vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_f32(dz, dz));
+            float32x4_t b = vaddq_f32(vaddq_f32(vmulq_f32(oX, dx), vmulq_f32(oY, dy)), vmulq_f32(oZ, dz));
+            float32x4_t disc = vsubq_f32(vmulq_f32(b, b), vmulq_f32(a, vdupq_n_f32(cValue)));
+            float32x4_t s = vsqrtq_f32(vmaxq_f32(disc, zero));
+            float32x4_t t1 = vdivq_f32(vsubq_f32(vnegq_f32(b), s), a);
+            float32x4_t t2 = vdivq_f32(vaddq_f32(vnegq_f32(b), s), a);
+            float32x4_t t = vbslq_f32(vcgtq_f32(t1, minT), t1, t2);
+            valid = vandq_u32(vcgeq_f32(disc, zero), vcgtq_f32(t, minT));
+            px = vaddq_f32(oX, vmulq_f32(t, dx));
+            py = vaddq_f32(oY, vmulq_f32(t, dy));
+            pz = vaddq_f32(oZ, vmulq_f32(t, dz));
+        }
+
+        float32x4_t u = vmulq_f32(atan2NEON(pz, px), vdupq_n_f32(kInvTwoPi));
+        u = vbslq_f32(vcltq_f32(u, zero), vaddq_f32(u, vdupq_n_f32(1.0f)), u);
+        float32x4_t rho = vsqrtq_f32(vaddq_f32(vmulq_f32(px, px), vmulq_f32(pz, pz)));
+        float32x4_t v = vmulq_f32(atan2NEON(rho, py), vdupq_n_f32(kInvPi));
+        float32x4_t sx = vsubq_f32(vmulq_f32(u, vdupq_n_f32((float)src.width)), half);
+        float32x4_t sy = vsubq_f32(vmulq_f32(v, vdupq_n_f32((float)src.height)), half);
+
+        float32x4_t fx0 = vrndmq_f32(sx), fy0 = vrndmq_f32(sy);
+        float32x4_t fx = vsubq_f32(sx, fx0), fy = vsubq_f32(sy, fy0);
+        int32x4_t x0 = vcvtq_s32_f32(fx0), y0 = vcvtq_s32_f32(fy0);
+        x0 = vbslq_s32(vcltq_s32(x0, zeroI), vaddq_s32(x0, widthI), x0);
+        int32x4_t x1 = vaddq_s32(x0, vdupq_n_s32(1));
+        x1 = vbslq_s32(vcgeq_s32(x1, widthI), vsubq_s32(x1, widthI), x1);
+        int32x4_t y1 = vminq_s32(vaddq_s32(y0, vdupq_n_s32(1)), lastRow);
+        y0 = vminq_s32(vmaxq_s32(y0, zeroI), lastRow);
+        uint32x4_t row0 = vreinterpretq_u32_s32(vmulq_n_s32(y0, src.stride));
+        uint32x4_t row1 = vreinterpretq_u32_s32(vmulq_n_s32(y1, src.stride));
+        uint32x4_t ux0 = vreinterpretq_u32_s32(x0), ux1 = vreinterpretq_u32_s32(x1);
+
+        // 无交点的像素索引置0，避免越界读取
+        uint32x4_t p00 = loadPixelsNEON(src.pixels, vandq_u32(vaddq_u32(row0, ux0), valid));
+        uint32x4_t p01 = loadPixelsNEON(src.pixels, vandq_u32(vaddq_u32(row0, ux1), valid));
+        uint32x4_t p10 = loadPixelsNEON(src.pixels, vandq_u32(vaddq_u32(row1, ux0), valid));
+        uint32x4_t p11 = loadPixelsNEON(src.pixels, vandq_u32(vaddq_u32(row1, ux1), valid));
+
+        uint32x4_t result = vdupq_n_u32(0);
+        for (int ch = 0; ch < 3; ch++) {
+            float32x4_t c00 = channelNEON(p00, 8 * ch), c01 = channelNEON(p01, 8 * ch);
+            float32x4_t c10 = channelNEON(p10, 8 * ch), c11 = channelNEON(p11, 8 * ch);
+            float32x4_t top = vaddq_f32(c00, vmulq_f32(fx, vsubq_f32(c01, c00)));
+            float32x4_t bottom = vaddq_f32(c10, vmulq_f32(fx, vsubq_f32(c11, c10)));
+            float32x4_t value = vaddq_f32(vaddq_f32(top, vmulq_f32(fy, vsubq_f32(bottom, top))), half);
+            result = vorrq_u32(result, vshlq_u32(vcvtq_u32_f32(value), vdupq_n_s32(8 * ch)));
+        }
+        vst1q_u32(packed, vandq_u32(result, valid));
+
+        unsigned char *out = row.dst + 3 * x;
+        for (int i = 0; i < 4; i++) {
+            out[3 * i] = (unsigned char)packed[i];
+            out[3 * i + 1] = (unsigned char)(packed[i] >> 8);
+            out[3 * i + 2] = (unsigned char)(packed[i] >> 16);
+        }
+    }
+    for (; x < row.width; x++) {
+        reprojectPixel(src, row, x);
+    }
+}
+#endif  // PANO_SIMD_NEON
+
+#ifdef PANO_SIMD_X86
+static bool cpuSupportsSSE41() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+static bool cpuSupportsAVX2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;  // 操作系统需要保存 YMM 寄存器
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif  // PANO_SIMD_X86
+
+static ReprojectRowFunc kernelFunction(CpuReprojector::Kernel kernel) {
+    switch (kernel) {
+#ifdef PANO_SIMD_X86
+        case CpuReprojector::Kernel::SSE41:
+            return reprojectRowSSE41;
+        case CpuReprojector::Kernel::AVX2:
+            return reprojectRowAVX2;
+#endif
+#ifdef PANO_SIMD_NEON
+        case CpuReprojector::Kernel::NEON:
+            return reprojectRowNEON;
+#endif
+        default:
+            return reprojectRowScalar;
+    }
+}
+
+CpuReprojector::CpuReprojector()
+    : m_kernel(Kernel::SCALAR), m_threadCount(0), m_tileRows(16) {
+    setKernel(Kernel::AUTO);
+}
+
+bool CpuReprojector::isKernelSupported(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::AUTO:
+        case Kernel::SCALAR:
+            return true;
+#ifdef PANO_SIMD_X86
+        case Kernel::SSE41:
+            return cpuSupportsSSE41();
+        case Kernel::AVX2:
+            return cpuSupportsAVX2();
+#endif
+#ifdef PANO_SIMD_NEON
+        case Kernel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+const char *CpuReprojector::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::AUTO:
+            return "AUTO";
+        case Kernel::SCALAR:
+            return "SCALAR";
+        case Kernel::SSE41:
+            return "SSE4.1";
+        case Kernel::AVX2:
+            return "AVX2";
+        case Kernel::NEON:
+            return "NEON";
+    }
+    return "UNKNOWN";
+}
+
+void CpuReprojector::setKernel(Kernel kernel) {
+    if (kernel != Kernel::AUTO && !isKernelSupported(kernel)) {
+        std::cerr << "CpuReprojector: kernel " << kernelName(kernel) << " not supported on this CPU, use AUTO." << std::endl;
+        kernel = Kernel::AUTO;
+    }
+    if (kernel == Kernel::AUTO) {
+        kernel = Kernel::SCALAR;
+        for (Kernel candidate : {Kernel::AVX2, Kernel::SSE41, Kernel::NEON}) {
+            if (isKernelSupported(candidate)) {
+                kernel = candidate;
+                break;
+            }
+        }
+    }
+    m_kernel = kernel;
+}
+
+bool CpuReprojector::setSource(const cv::Mat &panorama) {
+    if (panorama.empty() || panorama.type() != CV_8UC3) {
+        std::cerr << "CpuReprojector: source must be a non-empty CV_8UC3 image." << std::endl;
+        return false;
+    }
+    cv::cvtColor(panorama, m_source, cv::COLOR_BGR2BGRA);
+    return true;
+}
+
+CpuReprojector::RayGrid CpuReprojector::makeRayGrid(const glm::mat4 &projection, const glm::mat4 &view, int width, int height) {
+    // 透视投影下，近平面上的点与屏幕坐标是仿射关系，因此视线方向沿行、列都线性变化，只需反投影三个像素中心
+    glm::mat4 invViewProj = glm::inverse(projection * view);
+    RayGrid grid;
+    grid.eye = glm::vec3(glm::inverse(view)[3]);
+    auto rayAt = [&](float px, float py) {
+        // 输出图像第0行对应屏幕顶部（NDC y = 1）
+        glm::vec4 p = invViewProj * glm::vec4(px / width * 2.0f - 1.0f, 1.0f - py / height * 2.0f, -1.0f, 1.0f);
+        return glm::vec3(p) / p.w - grid.eye;
+    };
+    grid.origin = rayAt(0.5f, 0.5f);
+    grid.stepX = width > 1 ? (rayAt(width - 0.5f, 0.5f) - grid.origin) / (float)(width - 1) : glm::vec3(0.0f);
+    grid.stepY = height > 1 ? (rayAt(0.5f, height - 0.5f) - grid.origin) / (float)(height - 1) : glm::vec3(0.0f);
+    grid.centered = glm::dot(grid.eye, grid.eye) < 1e-12f;
+    return grid;
+}
+
+void CpuReprojector::forEachTile(int height, const std::function<void(int, int)> &func) const {
+    int tiles = (height + m_tileRows - 1) / m_tileRows;
+    std::atomic<int> nextTile(0);
+    auto worker = [&]() {
+        for (int tile = nextTile++; tile < tiles; tile = nextTile++) {
+            func(tile * m_tileRows, std::min(height, (tile + 1) * m_tileRows));
+        }
+    };
+
+    int threads = m_threadCount > 0 ? m_threadCount : (int)std::thread::hardware_concurrency();
+    threads = std::max(1, std::min(threads, tiles));
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();  // 调用线程也参与渲染
+    for (std::thread &t : pool) {
+        t.join();
+    }
+}
+
+static ReprojectSource makeSource(const cv::Mat &bgrx) {
+    ReprojectSource src;
+    src.pixels = reinterpret_cast<const uint32_t *>(bgrx.data);
+    src.width = bgrx.cols;
+    src.height = bgrx.rows;
+    src.stride = (int)(bgrx.step / sizeof(uint32_t));
+    return src;
+}
+
+static void fillRow(ReprojectRow &row, const glm::vec3 &eye, const glm::vec3 &dir, const glm::vec3 &stepX, bool centered) {
+    for (int i = 0; i < 3; i++) {
+        row.origin[i] = eye[i];
+        row.dir[i] = dir[i];
+        row.step[i] = stepX[i];
+    }
+    row.centered = centered;
+}
+
+void CpuReprojector::render(const glm::mat4 &projection, const glm::mat4 &view, int width, int height, cv::Mat &dst) const {
+    dst.create(height, width, CV_8UC3);
+    if (m_source.empty()) {
+        dst.setTo(cv::Scalar::all(0));
+        return;
+    }
+
+    ReprojectSource src = makeSource(m_source);
+    RayGrid grid = makeRayGrid(projection, view, width, height);
+    ReprojectRowFunc kernel = kernelFunction(m_kernel);
+    forEachTile(height, [&](int yBegin, int yEnd) {
+        ReprojectRow row;
+        row.width = width;
+        for (int y = yBegin; y < yEnd; y++) {
+            fillRow(row, grid.eye, grid.origin + (float)y * grid.stepY, grid.stepX, grid.centered);
+            row.dst = dst.ptr<unsigned char>(y);
+            kernel(src, row);
+        }
+    });
+}
+
+std::shared_ptr<RemapTable> CpuReprojector::buildRemapTable(const glm::mat4 &projection, const glm::mat4 &view, int width, int height) const {
+    std::shared_ptr<RemapTable> table = std::make_shared<RemapTable>();
+    table->width = width;
+    table->height = height;
+    table->srcWidth = m_source.cols;
+    table->entries.resize((size_t)width * height);
+    if (m_source.empty()) return table;
+
+    ReprojectSource src = makeSource(m_source);
+    RayGrid grid = makeRayGrid(projection, view, width, height);
+    forEachTile(height, [&](int yBegin, int yEnd) {
+        ReprojectRow row;
+        row.width = width;
+        for (int y = yBegin; y < yEnd; y++) {
+            fillRow(row, grid.eye, grid.origin + (float)y * grid.stepY, grid.stepX, grid.centered);
+            RemapEntry *entry = &table->entries[(size_t)y * width];
+            for (int x = 0; x < width; x++, entry++) {
+                float sx, sy;
+                if (!rayToTexel(src, row, row.dir[0] + x * row.step[0], row.dir[1] + x * row.step[1], row.dir[2] + x * row.step[2], sx, sy)) {
+                    *entry = RemapEntry();
+                    entry->flags = RemapEntry::INVALID;
+                    continue;
+                }
+                // 与 sampleBilinear 相同的环绕和钳位规则，权重量化为8位
+                float fx0 = std::floor(sx), fy0 = std::floor(sy);
+                int x0 = (int)fx0, y0 = (int)fy0;
+                if (x0 < 0) x0 += src.width;
+                int y1 = std::min(y0 + 1, src.height - 1);
+                y0 = std::min(std::max(y0, 0), src.height - 1);
+                entry->offset0 = (uint32_t)(y0 * src.stride + x0);
+                entry->offset1 = (uint32_t)(y1 * src.stride + x0);
+                entry->fx = (uint8_t)std::min(255, (int)((sx - fx0) * 256.0f + 0.5f));
+                entry->fy = (uint8_t)std::min(255, (int)((sy - fy0) * 256.0f + 0.5f));
+                entry->flags = x0 + 1 >= src.width ? RemapEntry::WRAP : 0;
+                entry->reserved = 0;
+            }
+        }
+    });
+    return table;
+}
+
+void CpuReprojector::remap(const RemapTable &table, cv::Mat &dst) const {
+    dst.create(table.height, table.width, CV_8UC3);
+    if (m_source.empty() || table.srcWidth != m_source.cols) {
+        dst.setTo(cv::Scalar::all(0));
+        return;
+    }
+
+    const uint32_t *pixels = reinterpret_cast<const uint32_t *>(m_source.data);
+    const int wrapStep = 1 - table.srcWidth;
+    forEachTile(table.height, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; y++) {
+            const RemapEntry *entry = &table.entries[(size_t)y * table.width];
+            unsigned char *out = dst.ptr<unsigned char>(y);
+            for (int x = 0; x < table.width; x++, entry++, out += 3) {
+                if (entry->flags & RemapEntry::INVALID) {
+                    out[0] = out[1] = out[2] = 0;
+                    continue;
+                }
+                int dx = (entry->flags & RemapEntry::WRAP) ? wrapStep : 1;
+                uint32_t p00 = pixels[entry->offset0], p01 = pixels[entry->offset0 + dx];
+                uint32_t p10 = pixels[entry->offset1], p11 = pixels[entry->offset1 + dx];
+                // 四个权重之和恰好为256，B、R 两个通道放在同一个32位整数的两个16位段中一起乘加（SWAR）
+                uint32_t w11 = ((uint32_t)entry->fx * entry->fy + 128) >> 8;
+                uint32_t w01 = entry->fx - w11, w10 = entry->fy - w11, w00 = 256 - entry->fx - entry->fy + w11;
+                const uint32_t mask = 0x00ff00ff;
+                uint32_t br = ((p00 & mask) * w00 + (p01 & mask) * w01 + (p10 & mask) * w10 + (p11 & mask) * w11 + 0x00800080) >> 8;
+                uint32_t gx = ((p00 >> 8 & mask) * w00 + (p01 >> 8 & mask) * w01 + (p10 >> 8 & mask) * w10 + (p11 >> 8 & mask) * w11 + 0x00800080) >> 8;
+                out[0] = (unsigned char)br;
+                out[1] = (unsigned char)gx;
+                out[2] = (unsigned char)(br >> 16);
+            }
+        }
+    });
+}
+
+void CpuReprojector::renderCached(RemapCache &cache, const RemapCache::Key &key, const glm::mat4 &projection, const glm::mat4 &view, int width, int height, cv::Mat &dst) const {
+    std::shared_ptr<const RemapTable> table = cache.find(key);
+    if (!table) {
+        std::shared_ptr<RemapTable> built = buildRemapTable(projection, view, width, height);
+        cache.insert(key, built);
+        table = built;
+    }
+    remap(*table, dst);
+}
@@ -0,0 +1,87 @@
+/**
+* @file        :CpuReprojector.h
+* @brief       :纯CPU的全景重投影渲染器
+* @details     :不需要GPU和OpenGL上下文，用与 renderPanorama 相同的 projection/view 矩阵，把等距柱状投影全景图渲染为透视视图，
+*               用于缩略图、预览和服务器端导出。每个输出像素的视线与单位球求交，换算为经纬度后在源图上双线性采样；
+*               按 CPU 能力自动选择 AVX2 / SSE4.1 / NEON / 标量内核，并按行块多线程并行。
+*               与 GL 渲染结果的容差：GL 在 50x50 的球面网格三角形内线性插值纹理坐标，这里逐像素计算精确的球面坐标。
+*               在透视、小行星、水晶球视角下实测逐通道平均差小于1个灰度级，差值超过8级的像素少于 0.5%，
+*               集中在经度接缝（GL 为 CLAMP_TO_EDGE，这里水平环绕）、两极附近和水晶球轮廓处；各内核之间结果最多相差1个灰度级
+* @date        :2026/10/16 16:02:45
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef CPUREPROJECTOR_H
+#define CPUREPROJECTOR_H
+
+#include <functional>
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+#include "glm/glm.hpp"
+#include "RemapCache.h"
+
+class CpuReprojector {
+   public:
+    enum class Kernel { AUTO,    // 自动选择当前 CPU 支持的最快内核
+                        SCALAR,  // 标量实现，所有平台可用
+                        SSE41,   // x86 SSE4.1，每次4个像素
+                        AVX2,    // x86 AVX2 + FMA，每次8个像素，使用 gather 取像素
+                        NEON };  // AArch64 NEON，每次4个像素
+
+    CpuReprojector();
+
+    // 设置等距柱状投影的源图（BGR，CV_8UC3），内部转换为每像素4字节的 BGRX 以便向量化取像素
+    bool setSource(const cv::Mat &panorama);
+    bool hasSource() const { return !m_source.empty(); }
+
+    // 按给定的投影和视图矩阵渲染 width x height 的 BGR 图像，矩阵与 renderPanorama 使用的相同，输出行序自上而下；
+    // 多个线程可以同时调用（导出时每个工作线程渲染不同的帧）
+    void render(const glm::mat4 &projection, const glm::mat4 &view, int width, int height, cv::Mat &dst) const;
+
+    // 建立给定视角的查找表，与 render 采样位置相同，权重量化为8位（结果与 render 最多相差1个灰度级）
+    std::shared_ptr<RemapTable> buildRemapTable(const glm::mat4 &projection, const glm::mat4 &view, int width, int height) const;
+    // 按查找表取像素，只做一次定点双线性插值
+    void remap(const RemapTable &table, cv::Mat &dst) const;
+    // 先在缓存中按 key 查找查找表，未命中时建表并放入缓存；key 应由 RemapCache::makeKey 按与矩阵相同的相机参数生成
+    // 与 render 一样可以由多个线程同时调用
+    void renderCached(RemapCache &cache, const RemapCache::Key &key, const glm::mat4 &projection, const glm::mat4 &view, int width, int height, cv::Mat &dst) const;
+
+    int getSourceWidth() const { return m_source.cols; }
+    int getSourceHeight() const { return m_source.rows; }
+
+    // 选择内核，请求的内核不被支持时退回 AUTO 的选择
+    void setKernel(Kernel kernel);
+    Kernel getKernel() const { return m_kernel; }
+    // 渲染线程数，0 表示使用全部硬件线程
+    void setThreadCount(int threads) { m_threadCount = threads; }
+    // 每个任务处理的行数
+    void setTileRows(int rows) { m_tileRows = rows < 1 ? 1 : rows; }
+
+    static bool isKernelSupported(Kernel kernel);
+    static const char *kernelName(Kernel kernel);
+
+   private:
+    // 输出像素 (x, y) 的视线为 eye + t * (origin + x * stepX + y * stepY)
+    struct RayGrid {
+        glm::vec3 eye;
+        glm::vec3 origin;
+        glm::vec3 stepX;
+        glm::vec3 stepY;
+        bool centered;  // 相机在球心
+    };
+    static RayGrid makeRayGrid(const glm::mat4 &projection, const glm::mat4 &view, int width, int height);
+    // 把 height 行按 m_tileRows 分块，在多个线程上执行 func(起始行, 结束行)
+    void forEachTile(int height, const std::function<void(int, int)> &func) const;
+
+    cv::Mat m_source;  // BGRX 源图
+    Kernel m_kernel;   // 实际使用的内核
+    int m_threadCount;
+    int m_tileRows;
+};
+
+#endif  // CPUREPROJECTOR_H
@@ -0,0 +1,128 @@
+/**
+* @file        :CpuReprojectorAVX2.cpp
+* @brief       :AVX2 重投影行内核
+* @details     :一次处理8个像素，源像素用 gather 读取；本文件以 -mavx2 -mfma（MSVC 为 /arch:AVX2）单独编译，
+*               只有运行时检测到 CPU 支持 AVX2 和 FMA 时才会被调用
+* @date        :2026/10/16 16:02:45
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "CpuReprojectorKernels.h"
+
+#include <immintrin.h>
+
+using namespace reproject;
+
+static inline __m256 atan2AVX2(__m256 y, __m256 x) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 ax = _mm256_andnot_ps(signMask, x);
+    __m256 ay = _mm256_andnot_ps(signMask, y);
+    __m256 mx = _mm256_max_ps(ax, ay);
+    __m256 mn = _mm256_min_ps(ax, ay);
+    __m256 a = _mm256_div_ps(mn, _mm256_max_ps(mx, _mm256_set1_ps(1e-30f)));
+    __m256 s = _mm256_mul_ps(a, a);
+    __m256 p = _mm256_fmadd_ps(s, _mm256_set1_ps(kAtan11), _mm256_set1_ps(kAtan9));
+    p = _mm256_fmadd_ps(s, p, _mm256_set1_ps(kAtan7));
+    p = _mm256_fmadd_ps(s, p, _mm256_set1_ps(kAtan5));
+    p = _mm256_fmadd_ps(s, p, _mm256_set1_ps(kAtan3));
+    p = _mm256_fmadd_ps(s, p, _mm256_set1_ps(kAtan1));
+    __m256 r = _mm256_mul_ps(a, p);
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(kHalfPi), r), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(kPi), r), x);  // blendv 只看符号位，x<0 时取 π-r
+    return _mm256_or_ps(r, _mm256_and_ps(y, signMask));
+}
+
+// 取8个像素某一通道的值
+static inline __m256 channelAVX2(__m256i pixels, int shift) {
+    return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, shift), _mm256_set1_epi32(0xff)));
+}
+
+void reprojectRowAVX2(const ReprojectSource &src, const ReprojectRow &row) {
+    const __m256 laneOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 stepX = _mm256_set1_ps(row.step[0]), stepY = _mm256_set1_ps(row.step[1]), stepZ = _mm256_set1_ps(row.step[2]);
+    const __m256 dirX = _mm256_set1_ps(row.dir[0]), dirY = _mm256_set1_ps(row.dir[1]), dirZ = _mm256_set1_ps(row.dir[2]);
+    const __m256 oX = _mm256_set1_ps(row.origin[0]), oY = _mm256_set1_ps(row.origin[1]), oZ = _mm256_set1_ps(row.origin[2]);
+    const __m256 c = _mm256_set1_ps(row.origin[0] * row.origin[0] + row.origin[1] * row.origin[1] + row.origin[2] * row.origin[2] - 1.0f);
+    const __m256 zero = _mm256_setzero_ps(), half = _mm256_set1_ps(0.5f), one = _mm256_set1_ps(1.0f), minT = _mm256_set1_ps(kMinT);
+    const __m256 srcW = _mm256_set1_ps((float)src.width), srcH = _mm256_set1_ps((float)src.height);
+    const __m256i widthI = _mm256_set1_epi32(src.width), lastRow = _mm256_set1_epi32(src.height - 1), strideI = _mm256_set1_epi32(src.stride);
+    const __m256i zeroI = _mm256_setzero_si256();
+    const int *base = reinterpret_cast<const int *>(src.pixels);
+
+    int x = 0;
+    alignas(32) uint32_t packed[8];
+    for (; x + 8 <= row.width; x += 8) {
+        __m256 xs = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+        __m256 dx = _mm256_add_ps(dirX, _mm256_mul_ps(xs, stepX));
+        __m256 dy = _mm256_add_ps(dirY, _mm256_mul_ps(xs, stepY));
+        __m256 dz = _mm256_add_ps(dirZ, _mm256_mul_ps(xs, stepZ));
+
+        __m256 px = dx, py = dy, pz = dz;
+        __m256 valid = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        if (!row.centered) {
+            __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+            __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(oX, dx), _mm256_mul_ps(oY, dy)), _mm256_mul_ps(oZ, dz));
+            __m256 disc = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(a, c));
+            __m256 s = _mm256_sqrt_ps(_mm256_max_ps(disc, zero));
+            __m256 t1 = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(zero, b), s), a);
+            __m256 t2 = _mm256_div_ps(_mm256_add_ps(_mm256_sub_ps(zero, b), s), a);
+            __m256 t = _mm256_blendv_ps(t2, t1, _mm256_cmp_ps(t1, minT, _CMP_GT_OQ));
+            valid = _mm256_and_ps(_mm256_cmp_ps(disc, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, minT, _CMP_GT_OQ));
+            px = _mm256_add_ps(oX, _mm256_mul_ps(t, dx));
+            py = _mm256_add_ps(oY, _mm256_mul_ps(t, dy));
+            pz = _mm256_add_ps(oZ, _mm256_mul_ps(t, dz));
+        }
+
+        __m256 u = _mm256_mul_ps(atan2AVX2(pz, px), _mm256_set1_ps(kInvTwoPi));
+        u = _mm256_add_ps(u, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_LT_OQ), one));
+        __m256 rho = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(pz, pz)));
+        __m256 v = _mm256_mul_ps(atan2AVX2(rho, py), _mm256_set1_ps(kInvPi));
+        __m256 sx = _mm256_sub_ps(_mm256_mul_ps(u, srcW), half);
+        __m256 sy = _mm256_sub_ps(_mm256_mul_ps(v, srcH), half);
+
+        __m256 fx0 = _mm256_floor_ps(sx), fy0 = _mm256_floor_ps(sy);
+        __m256 fx = _mm256_sub_ps(sx, fx0), fy = _mm256_sub_ps(sy, fy0);
+        __m256i x0 = _mm256_cvttps_epi32(fx0), y0 = _mm256_cvttps_epi32(fy0);
+        x0 = _mm256_add_epi32(x0, _mm256_and_si256(_mm256_cmpgt_epi32(zeroI, x0), widthI));
+        __m256i x1 = _mm256_add_epi32(x0, _mm256_set1_epi32(1));
+        x1 = _mm256_sub_epi32(x1, _mm256_andnot_si256(_mm256_cmpgt_epi32(widthI, x1), widthI));
+        __m256i y1 = _mm256_min_epi32(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), lastRow);
+        y0 = _mm256_min_epi32(_mm256_max_epi32(y0, zeroI), lastRow);
+        __m256i row0 = _mm256_mullo_epi32(y0, strideI), row1 = _mm256_mullo_epi32(y1, strideI);
+
+        // 无交点的像素索引置0，避免越界读取
+        __m256i validI = _mm256_castps_si256(valid);
+        __m256i i00 = _mm256_and_si256(_mm256_add_epi32(row0, x0), validI);
+        __m256i i01 = _mm256_and_si256(_mm256_add_epi32(row0, x1), validI);
+        __m256i i10 = _mm256_and_si256(_mm256_add_epi32(row1, x0), validI);
+        __m256i i11 = _mm256_and_si256(_mm256_add_epi32(row1, x1), validI);
+        __m256i p00 = _mm256_i32gather_epi32(base, i00, 4);
+        __m256i p01 = _mm256_i32gather_epi32(base, i01, 4);
+        __m256i p10 = _mm256_i32gather_epi32(base, i10, 4);
+        __m256i p11 = _mm256_i32gather_epi32(base, i11, 4);
+
+        __m256i result = _mm256_setzero_si256();
+        for (int ch = 0; ch < 3; ch++) {
+            __m256 c00 = channelAVX2(p00, 8 * ch), c01 = channelAVX2(p01, 8 * ch);
+            __m256 c10 = channelAVX2(p10, 8 * ch), c11 = channelAVX2(p11, 8 * ch);
+            __m256 top = _mm256_add_ps(c00, _mm256_mul_ps(fx, _mm256_sub_ps(c01, c00)));
+            __m256 bottom = _mm256_add_ps(c10, _mm256_mul_ps(fx, _mm256_sub_ps(c11, c10)));
+            __m256 value = _mm256_add_ps(_mm256_add_ps(top, _mm256_mul_ps(fy, _mm256_sub_ps(bottom, top))), half);
+            result = _mm256_or_si256(result, _mm256_slli_epi32(_mm256_cvttps_epi32(value), 8 * ch));
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i *>(packed), _mm256_and_si256(result, validI));
+
+        unsigned char *out = row.dst + 3 * x;
+        for (int i = 0; i < 8; i++) {
+            out[3 * i] = (unsigned char)packed[i];
+            out[3 * i + 1] = (unsigned char)(packed[i] >> 8);
+            out[3 * i + 2] = (unsigned char)(packed[i] >> 16);
+        }
+    }
+    for (; x < row.width; x++) {
+        reprojectPixel(src, row, x);
+    }
+}
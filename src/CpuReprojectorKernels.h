@@ -0,0 +1,142 @@
+/**
+* @file        :CpuReprojectorKernels.h
+* @brief       :CPU 全景重投影的行内核（内部头文件）
+* @details     :每个内核处理输出图像的一行：视线方向沿行线性变化，与单位球求交后换算为经纬度，再在 BGRX 源图上双线性采样。
+*               标量、SSE4.1、AVX2、NEON 内核使用同一个 atan 多项式近似，结果之间最多相差1个灰度级。
+*               本文件中的函数都是 static inline，保证以 -mavx2 编译的翻译单元中的副本不会被链接器选给其它翻译单元
+* @date        :2026/10/16 16:02:45
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef CPUREPROJECTORKERNELS_H
+#define CPUREPROJECTORKERNELS_H
+
+#include <cmath>
+#include <cstdint>
+
+// BGRX 源图，每像素4字节，使 AVX2 可以用 gather 一次取一个像素
+struct ReprojectSource {
+    const uint32_t *pixels;
+    int width;
+    int height;
+    int stride;  // 行跨度（像素个数）
+};
+
+// 一行输出像素的视线参数：第x个像素的视线为 origin + t * (dir + x * step)
+struct ReprojectRow {
+    float origin[3];     // 相机位置（世界坐标）
+    float dir[3];        // 第0个像素中心的视线方向（未归一化）
+    float step[3];       // 相邻像素的视线方向增量
+    bool centered;       // 相机位于球心，视线与球的交点方向就是视线方向，省去求交
+    int width;           // 输出像素个数
+    unsigned char *dst;  // 输出 BGR 像素
+};
+
+typedef void (*ReprojectRowFunc)(const ReprojectSource &src, const ReprojectRow &row);
+
+void reprojectRowScalar(const ReprojectSource &src, const ReprojectRow &row);
+void reprojectRowSSE41(const ReprojectSource &src, const ReprojectRow &row);
+void reprojectRowAVX2(const ReprojectSource &src, const ReprojectRow &row);
+void reprojectRowNEON(const ReprojectSource &src, const ReprojectRow &row);
+
+namespace reproject {
+
+const float kPi = 3.14159265358979323846f;
+const float kHalfPi = 1.57079632679489661923f;
+const float kInvTwoPi = 0.15915494309189533577f;
+const float kInvPi = 0.31830988618379067154f;
+const float kMinT = 1e-4f;  // 交点需在相机前方，排除相机恰好在球面上时 t=0 的解
+
+// atan(a), a∈[0,1] 的极小化多项式，最大误差约 1e-5 弧度（在8K全景上小于0.02像素）
+const float kAtan1 = 0.99997726f;
+const float kAtan3 = -0.33262347f;
+const float kAtan5 = 0.19354346f;
+const float kAtan7 = -0.11643287f;
+const float kAtan9 = 0.05265332f;
+const float kAtan11 = -0.01172120f;
+
+static inline float atan2Approx(float y, float x) {
+    float ax = std::fabs(x), ay = std::fabs(y);
+    float mx = ax > ay ? ax : ay;
+    float mn = ax > ay ? ay : ax;
+    float a = mn / (mx > 1e-30f ? mx : 1e-30f);
+    float s = a * a;
+    float r = a * (kAtan1 + s * (kAtan3 + s * (kAtan5 + s * (kAtan7 + s * (kAtan9 + s * kAtan11)))));
+    if (ay > ax) r = kHalfPi - r;
+    if (x < 0.0f) r = kPi - r;
+    return std::signbit(y) ? -r : r;
+}
+
+// 视线与单位球求交，得到源图上的采样坐标（像素中心在 +0.5 处），无交点时返回 false
+static inline bool rayToTexel(const ReprojectSource &src, const ReprojectRow &row, float dx, float dy, float dz, float &sx, float &sy) {
+    float px = dx, py = dy, pz = dz;
+    if (!row.centered) {
+        const float *o = row.origin;
+        float a = dx * dx + dy * dy + dz * dz;
+        float b = o[0] * dx + o[1] * dy + o[2] * dz;
+        float c = o[0] * o[0] + o[1] * o[1] + o[2] * o[2] - 1.0f;
+        float disc = b * b - a * c;
+        if (disc < 0.0f) return false;
+        float s = std::sqrt(disc);
+        float t = (-b - s) / a;  // 相机在球外时取较近的交点，与 GL 深度测试一致
+        if (t <= kMinT) t = (-b + s) / a;
+        if (t <= kMinT) return false;
+        px = o[0] + t * dx;
+        py = o[1] + t * dy;
+        pz = o[2] + t * dz;
+    }
+    // 与 SphereData 的参数化一致：经度 u = atan2(z, x) / 2π，纬度从北极 (y=1, 图像第0行) 开始 v = acos(y) / π
+    float u = atan2Approx(pz, px) * kInvTwoPi;
+    if (u < 0.0f) u += 1.0f;
+    float v = atan2Approx(std::sqrt(px * px + pz * pz), py) * kInvPi;
+    sx = u * src.width - 0.5f;
+    sy = v * src.height - 0.5f;
+    return true;
+}
+
+// 双线性采样：水平方向环绕（经度连续），垂直方向钳位，与 GL_LINEAR 的纹素中心约定相同
+static inline void sampleBilinear(const ReprojectSource &src, float sx, float sy, unsigned char *dst) {
+    float fx0 = std::floor(sx), fy0 = std::floor(sy);
+    float fx = sx - fx0, fy = sy - fy0;
+    int x0 = (int)fx0, y0 = (int)fy0;
+    if (x0 < 0) x0 += src.width;
+    int x1 = x0 + 1;
+    if (x1 >= src.width) x1 -= src.width;
+    int y1 = y0 + 1;
+    if (y0 < 0) y0 = 0;
+    if (y0 > src.height - 1) y0 = src.height - 1;
+    if (y1 > src.height - 1) y1 = src.height - 1;
+
+    const uint32_t *r0 = src.pixels + (size_t)y0 * src.stride;
+    const uint32_t *r1 = src.pixels + (size_t)y1 * src.stride;
+    uint32_t p00 = r0[x0], p01 = r0[x1], p10 = r1[x0], p11 = r1[x1];
+    for (int c = 0; c < 3; c++) {
+        float c00 = (float)((p00 >> (8 * c)) & 0xff), c01 = (float)((p01 >> (8 * c)) & 0xff);
+        float c10 = (float)((p10 >> (8 * c)) & 0xff), c11 = (float)((p11 >> (8 * c)) & 0xff);
+        float top = c00 + fx * (c01 - c00);
+        float bottom = c10 + fx * (c11 - c10);
+        dst[c] = (unsigned char)(int)(top + fy * (bottom - top) + 0.5f);
+    }
+}
+
+// 处理一个像素，SIMD 内核用它处理行尾不足一个向量宽度的像素
+static inline void reprojectPixel(const ReprojectSource &src, const ReprojectRow &row, int x) {
+    float dx = row.dir[0] + x * row.step[0];
+    float dy = row.dir[1] + x * row.step[1];
+    float dz = row.dir[2] + x * row.step[2];
+    unsigned char *out = row.dst + 3 * x;
+    float sx, sy;
+    if (rayToTexel(src, row, dx, dy, dz, sx, sy)) {
+        sampleBilinear(src, sx, sy, out);
+    } else {
+        out[0] = out[1] = out[2] = 0;  // 与渲染时的清屏颜色相同
+    }
+}
+
+}  // namespace reproject
+
+#endif  // CPUREPROJECTORKERNELS_H
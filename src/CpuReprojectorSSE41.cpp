@@ -0,0 +1,128 @@
+/**
+* @file        :CpuReprojectorSSE41.cpp
+* @brief       :SSE4.1 重投影行内核
+* @details     :一次处理4个像素；SSE 没有 gather 指令，源像素按算好的索引逐个读取后再做向量插值。
+*               本文件以 -msse4.1 单独编译，只有运行时检测到 CPU 支持 SSE4.1 时才会被调用
+* @date        :2026/10/16 16:02:45
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "CpuReprojectorKernels.h"
+
+#include <smmintrin.h>
+
+using namespace reproject;
+
+static inline __m128 atan2SSE41(__m128 y, __m128 x) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 ax = _mm_andnot_ps(signMask, x);
+    __m128 ay = _mm_andnot_ps(signMask, y);
+    __m128 mx = _mm_max_ps(ax, ay);
+    __m128 mn = _mm_min_ps(ax, ay);
+    __m128 a = _mm_div_ps(mn, _mm_max_ps(mx, _mm_set1_ps(1e-30f)));
+    __m128 s = _mm_mul_ps(a, a);
+    __m128 p = _mm_add_ps(_mm_mul_ps(s, _mm_set1_ps(kAtan11)), _mm_set1_ps(kAtan9));
+    p = _mm_add_ps(_mm_mul_ps(s, p), _mm_set1_ps(kAtan7));
+    p = _mm_add_ps(_mm_mul_ps(s, p), _mm_set1_ps(kAtan5));
+    p = _mm_add_ps(_mm_mul_ps(s, p), _mm_set1_ps(kAtan3));
+    p = _mm_add_ps(_mm_mul_ps(s, p), _mm_set1_ps(kAtan1));
+    __m128 r = _mm_mul_ps(a, p);
+    r = _mm_blendv_ps(r, _mm_sub_ps(_mm_set1_ps(kHalfPi), r), _mm_cmpgt_ps(ay, ax));
+    r = _mm_blendv_ps(r, _mm_sub_ps(_mm_set1_ps(kPi), r), x);  // blendv 只看符号位，x<0 时取 π-r
+    return _mm_or_ps(r, _mm_and_ps(y, signMask));
+}
+
+static inline __m128 channelSSE41(__m128i pixels, int shift) {
+    return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, shift), _mm_set1_epi32(0xff)));
+}
+
+// 按4个索引逐个读取源像素
+static inline __m128i loadPixelsSSE41(const uint32_t *base, __m128i index) {
+    return _mm_setr_epi32((int)base[_mm_extract_epi32(index, 0)], (int)base[_mm_extract_epi32(index, 1)],
+                          (int)base[_mm_extract_epi32(index, 2)], (int)base[_mm_extract_epi32(index, 3)]);
+}
+
+void reprojectRowSSE41(const ReprojectSource &src, const ReprojectRow &row) {
+    const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 stepX = _mm_set1_ps(row.step[0]), stepY = _mm_set1_ps(row.step[1]), stepZ = _mm_set1_ps(row.step[2]);
+    const __m128 dirX = _mm_set1_ps(row.dir[0]), dirY = _mm_set1_ps(row.dir[1]), dirZ = _mm_set1_ps(row.dir[2]);
+    const __m128 oX = _mm_set1_ps(row.origin[0]), oY = _mm_set1_ps(row.origin[1]), oZ = _mm_set1_ps(row.origin[2]);
+    const __m128 c = _mm_set1_ps(row.origin[0] * row.origin[0] + row.origin[1] * row.origin[1] + row.origin[2] * row.origin[2] - 1.0f);
+    const __m128 zero = _mm_setzero_ps(), half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f), minT = _mm_set1_ps(kMinT);
+    const __m128 srcW = _mm_set1_ps((float)src.width), srcH = _mm_set1_ps((float)src.height);
+    const __m128i widthI = _mm_set1_epi32(src.width), lastRow = _mm_set1_epi32(src.height - 1), strideI = _mm_set1_epi32(src.stride);
+    const __m128i zeroI = _mm_setzero_si128();
+
+    int x = 0;
+    alignas(16) uint32_t packed[4];
+    for (; x + 4 <= row.width; x += 4) {
+        __m128 xs = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+        __m128 dx = _mm_add_ps(dirX, _mm_mul_ps(xs, stepX));
+        __m128 dy = _mm_add_ps(dirY, _mm_mul_ps(xs, stepY));
+        __m128 dz = _mm_add_ps(dirZ, _mm_mul_ps(xs, stepZ));
+
+        __m128 px = dx, py = dy, pz = dz;
+        __m128 valid = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        if (!row.centered) {
+            __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(oX, dx), _mm_mul_ps(oY, dy)), _mm_mul_ps(oZ, dz));
+            __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+            __m128 s = _mm_sqrt_ps(_mm_max_ps(disc, zero));
+            __m128 t1 = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(zero, b), s), a);
+            __m128 t2 = _mm_div_ps(_mm_add_ps(_mm_sub_ps(zero, b), s), a);
+            __m128 t = _mm_blendv_ps(t2, t1, _mm_cmpgt_ps(t1, minT));
+            valid = _mm_and_ps(_mm_cmpge_ps(disc, zero), _mm_cmpgt_ps(t, minT));
+            px = _mm_add_ps(oX, _mm_mul_ps(t, dx));
+            py = _mm_add_ps(oY, _mm_mul_ps(t, dy));
+            pz = _mm_add_ps(oZ, _mm_mul_ps(t, dz));
+        }
+
+        __m128 u = _mm_mul_ps(atan2SSE41(pz, px), _mm_set1_ps(kInvTwoPi));
+        u = _mm_add_ps(u, _mm_and_ps(_mm_cmplt_ps(u, zero), one));
+        __m128 rho = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(pz, pz)));
+        __m128 v = _mm_mul_ps(atan2SSE41(rho, py), _mm_set1_ps(kInvPi));
+        __m128 sx = _mm_sub_ps(_mm_mul_ps(u, srcW), half);
+        __m128 sy = _mm_sub_ps(_mm_mul_ps(v, srcH), half);
+
+        __m128 fx0 = _mm_floor_ps(sx), fy0 = _mm_floor_ps(sy);
+        __m128 fx = _mm_sub_ps(sx, fx0), fy = _mm_sub_ps(sy, fy0);
+        __m128i x0 = _mm_cvttps_epi32(fx0), y0 = _mm_cvttps_epi32(fy0);
+        x0 = _mm_add_epi32(x0, _mm_and_si128(_mm_cmpgt_epi32(zeroI, x0), widthI));
+        __m128i x1 = _mm_add_epi32(x0, _mm_set1_epi32(1));
+        x1 = _mm_sub_epi32(x1, _mm_andnot_si128(_mm_cmpgt_epi32(widthI, x1), widthI));
+        __m128i y1 = _mm_min_epi32(_mm_add_epi32(y0, _mm_set1_epi32(1)), lastRow);
+        y0 = _mm_min_epi32(_mm_max_epi32(y0, zeroI), lastRow);
+        __m128i row0 = _mm_mullo_epi32(y0, strideI), row1 = _mm_mullo_epi32(y1, strideI);
+
+        // 无交点的像素索引置0，避免越界读取
+        __m128i validI = _mm_castps_si128(valid);
+        __m128i p00 = loadPixelsSSE41(src.pixels, _mm_and_si128(_mm_add_epi32(row0, x0), validI));
+        __m128i p01 = loadPixelsSSE41(src.pixels, _mm_and_si128(_mm_add_epi32(row0, x1), validI));
+        __m128i p10 = loadPixelsSSE41(src.pixels, _mm_and_si128(_mm_add_epi32(row1, x0), validI));
+        __m128i p11 = loadPixelsSSE41(src.pixels, _mm_and_si128(_mm_add_epi32(row1, x1), validI));
+
+        __m128i result = _mm_setzero_si128();
+        for (int ch = 0; ch < 3; ch++) {
+            __m128 c00 = channelSSE41(p00, 8 * ch), c01 = channelSSE41(p01, 8 * ch);
+            __m128 c10 = channelSSE41(p10, 8 * ch), c11 = channelSSE41(p11, 8 * ch);
+            __m128 top = _mm_add_ps(c00, _mm_mul_ps(fx, _mm_sub_ps(c01, c00)));
+            __m128 bottom = _mm_add_ps(c10, _mm_mul_ps(fx, _mm_sub_ps(c11, c10)));
+            __m128 value = _mm_add_ps(_mm_add_ps(top, _mm_mul_ps(fy, _mm_sub_ps(bottom, top))), half);
+            result = _mm_or_si128(result, _mm_slli_epi32(_mm_cvttps_epi32(value), 8 * ch));
+        }
+        _mm_store_si128(reinterpret_cast<__m128i *>(packed), _mm_and_si128(result, validI));
+
+        unsigned char *out = row.dst + 3 * x;
+        for (int i = 0; i < 4; i++) {
+            out[3 * i] = (unsigned char)packed[i];
+            out[3 * i + 1] = (unsigned char)(packed[i] >> 8);
+            out[3 * i + 2] = (unsigned char)(packed[i] >> 16);
+        }
+    }
+    for (; x < row.width; x++) {
+        reprojectPixel(src, row, x);
+    }
+}
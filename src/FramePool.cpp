@@ -0,0 +1,60 @@
+/**
+* @file        :FramePool.cpp
+* @brief       :可复用的帧内存池实现
+* @details     :空闲帧保存在数组中，后进先出，最近归还的帧更可能仍在缓存里
+* @date        :2026/10/16 19:20:10
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "FramePool.h"
+
+FramePool::FramePool(int maxFrames)
+    : m_maxFrames(maxFrames < 1 ? 1 : maxFrames), m_rows(0), m_cols(0), m_type(0), m_allocations(0) {
+}
+
+void FramePool::setMaxFrames(int maxFrames) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxFrames = maxFrames < 1 ? 1 : maxFrames;
+    if ((int)m_free.size() > m_maxFrames) m_free.resize(m_maxFrames);
+}
+
+void FramePool::setFormat(int rows, int cols, int type) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (rows == m_rows && cols == m_cols && type == m_type) return;
+    m_free.clear();
+    m_rows = rows;
+    m_cols = cols;
+    m_type = type;
+}
+
+cv::Mat FramePool::acquire() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_free.empty()) {
+        cv::Mat frame = m_free.back();
+        m_free.pop_back();
+        return frame;
+    }
+    m_allocations++;
+    return cv::Mat(m_rows, m_cols, m_type);
+}
+
+void FramePool::release(cv::Mat &frame) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (frame.rows == m_rows && frame.cols == m_cols && frame.type() == m_type && (int)m_free.size() < m_maxFrames) {
+        m_free.push_back(frame);
+    }
+    frame = cv::Mat();  // 调用者不再持有这块内存
+}
+
+void FramePool::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.clear();
+}
+
+long FramePool::getAllocations() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_allocations;
+}
@@ -0,0 +1,49 @@
+/**
+* @file        :FramePool.h
+* @brief       :可复用的帧内存池
+* @details     :导出时每帧都需要一块同样尺寸的 cv::Mat，逐帧分配和释放几兆字节的内存会反复触发缺页和清零。
+*               帧池保存用完归还的 cv::Mat，再次申请时直接复用；尺寸或类型改变时丢弃旧的帧。线程安全，
+*               可以在渲染线程申请、编码线程归还
+* @date        :2026/10/16 19:20:10
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <mutex>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+class FramePool {
+   public:
+    // maxFrames 为池中最多保留的空闲帧数，多余的归还帧直接释放
+    explicit FramePool(int maxFrames = 8);
+
+    void setMaxFrames(int maxFrames);
+    // 设置帧的尺寸和类型，与之前不同时清空池
+    void setFormat(int rows, int cols, int type);
+    // 取一帧，池为空时新分配；内容未初始化
+    cv::Mat acquire();
+    // 归还一帧，尺寸或类型与当前格式不一致的帧不会入池
+    void release(cv::Mat &frame);
+    void clear();
+
+    // 累计新分配的帧数，导出稳定后应不再增长
+    long getAllocations() const;
+
+   private:
+    mutable std::mutex m_mutex;
+    std::vector<cv::Mat> m_free;
+    int m_maxFrames;
+    int m_rows;
+    int m_cols;
+    int m_type;
+    long m_allocations;
+};
+
+#endif  // FRAMEPOOL_H
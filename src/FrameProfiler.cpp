@@ -0,0 +1,149 @@
+/**
+* @file        :FrameProfiler.cpp
+* @brief       :分阶段的帧耗时统计实现
+* @details     :百分位在样本窗口的拷贝上用 nth_element 求出，只在显示和写文件时计算；
+*               每个阶段一把锁，渲染线程和解码线程记录的阶段互不相同，锁几乎不会发生竞争
+* @date        :2026/10/17 11:30:20
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+const double BUCKET_BASE_MS = 1.0 / 32;
+
+// 样本的第 q 分位（最近秩），会打乱样本顺序
+double percentile(std::vector<float> &samples, double q) {
+    if (samples.empty()) return 0.0;
+    size_t k = (size_t)(q * (samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+}  // namespace
+
+FrameProfiler::FrameProfiler()
+    : m_enabled(false) {
+}
+
+const char *FrameProfiler::stageName(Stage stage) {
+    static const char *names[STAGE_COUNT] = {"input", "video decode", "video convert", "video upload", "texture load", "matrices",
+                                             "virtual texture", "render", "hud", "swap", "readback", "frame",
+                                             "gpu video upload", "gpu texture load", "gpu virtual tex", "gpu render", "gpu readback", "gpu frame"};
+    return stage >= 0 && stage < STAGE_COUNT ? names[stage] : "?";
+}
+
+double FrameProfiler::bucketUpperMs(int bucket) {
+    return BUCKET_BASE_MS * (double)(1 << bucket);
+}
+
+void FrameProfiler::record(Stage stage, double ms) {
+    if (stage < 0 || stage >= STAGE_COUNT) return;
+    int bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && ms > bucketUpperMs(bucket)) bucket++;
+
+    StageData &data = m_stages[stage];
+    std::lock_guard<std::mutex> lock(data.mutex);
+    data.window[data.windowNext] = (float)ms;
+    data.windowNext = (data.windowNext + 1) % WINDOW_SIZE;
+    data.windowCount = std::min(data.windowCount + 1, (int)WINDOW_SIZE);
+    data.count++;
+    data.totalMs += ms;
+    data.maxMs = std::max(data.maxMs, ms);
+    data.buckets[bucket]++;
+}
+
+FrameProfiler::Summary FrameProfiler::summarize(Stage stage) const {
+    Summary summary;
+    if (stage < 0 || stage >= STAGE_COUNT) return summary;
+    std::vector<float> samples;
+    {
+        const StageData &data = m_stages[stage];
+        std::lock_guard<std::mutex> lock(data.mutex);
+        summary.count = data.count;
+        summary.meanMs = data.count > 0 ? data.totalMs / data.count : 0.0;
+        summary.maxMs = data.maxMs;
+        samples.assign(data.window, data.window + data.windowCount);
+    }
+    summary.p50Ms = percentile(samples, 0.50);
+    summary.p95Ms = percentile(samples, 0.95);
+    summary.p99Ms = percentile(samples, 0.99);
+    return summary;
+}
+
+std::vector<std::string> FrameProfiler::formatTable() const {
+    std::vector<std::string> lines;
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-16s %7s %7s %7s %7s", "stage (ms)", "p50", "p95", "p99", "max");
+    lines.push_back(line);
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        Summary s = summarize((Stage)i);
+        if (s.count == 0) continue;
+        std::snprintf(line, sizeof(line), "%-16s %7.2f %7.2f %7.2f %7.2f", stageName((Stage)i), s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs);
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+bool FrameProfiler::dump(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not write profile: " << path << std::endl;
+        return false;
+    }
+    out << std::fixed << std::setprecision(3);
+    out << "# per-stage time in ms; p50/p95/p99 over the last " << WINDOW_SIZE << " samples, count/mean/max since start\n";
+    out << std::left << std::setw(17) << "stage" << std::right << std::setw(9) << "count" << std::setw(10) << "mean" << std::setw(10) << "p50"
+        << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        Summary s = summarize((Stage)i);
+        if (s.count == 0) continue;
+        out << std::left << std::setw(17) << stageName((Stage)i) << std::right << std::setw(9) << s.count << std::setw(10) << s.meanMs
+            << std::setw(10) << s.p50Ms << std::setw(10) << s.p95Ms << std::setw(10) << s.p99Ms << std::setw(10) << s.maxMs << "\n";
+    }
+
+    // 直方图：每个桶写成 "<=上界:次数"，只写非零的桶
+    out << "\n# histogram since start, bucket upper bound in ms\n";
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const StageData &data = m_stages[i];
+        std::lock_guard<std::mutex> lock(data.mutex);
+        if (data.count == 0) continue;
+        out << std::left << std::setw(17) << stageName((Stage)i) << std::right;
+        for (int b = 0; b < BUCKET_COUNT; b++) {
+            if (data.buckets[b] == 0) continue;
+            if (b == BUCKET_COUNT - 1) {
+                out << " >" << bucketUpperMs(b - 1) << ":" << data.buckets[b];
+            } else {
+                out << " <=" << bucketUpperMs(b) << ":" << data.buckets[b];
+            }
+        }
+        out << "\n";
+    }
+    if (!out) {
+        std::cerr << "Could not write profile: " << path << std::endl;
+        return false;
+    }
+    std::cout << "Frame profile written to " << path << std::endl;
+    return true;
+}
+
+void FrameProfiler::reset() {
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        StageData &data = m_stages[i];
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.windowCount = 0;
+        data.windowNext = 0;
+        data.count = 0;
+        data.totalMs = 0.0;
+        data.maxMs = 0.0;
+        std::fill(data.buckets, data.buckets + BUCKET_COUNT, 0L);
+    }
+}
@@ -0,0 +1,119 @@
+/**
+* @file        :FrameProfiler.h
+* @brief       :分阶段的帧耗时统计
+* @details     :渲染循环、导出循环和视频解码线程在各阶段外放置 ScopedStageTimer，每个阶段保留最近 WINDOW_SIZE 次的耗时，
+*               用于计算滚动的 p50/p95/p99；另有从启动开始累计的按2的幂分桶的直方图、次数、均值和最大值，退出时写入文件。
+*               未启用时计时器只读一次原子标志，不读时钟也不加锁；TraceRecorder 记录时，计时器同时以阶段名输出时间线事件
+* @date        :2026/10/17 11:30:20
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "TraceRecorder.h"
+
+class FrameProfiler {
+   public:
+    enum Stage { INPUT,             // processInput
+                 VIDEO_DECODE,      // 解码线程：demux 和解码（grab）
+                 VIDEO_CONVERT,     // 解码线程：转换为 BGR/NV12 并拷贝（retrieve）
+                 VIDEO_UPLOAD,      // 渲染线程：取帧并上传纹理
+                 TEXTURE_LOAD,      // 渐进加载的分帧上传
+                 MATRICES,          // 动画插值、投影和视图矩阵
+                 VIRTUAL_TEXTURE,   // 虚拟纹理的反馈和页上传
+                 RENDER,            // renderPanorama（导出时包括超采样缩小）
+                 HUD,               // 统计叠加层
+                 SWAP,              // glfwSwapBuffers
+                 READBACK,          // 导出：取出最早一帧写入视频，并发起本帧的异步回读
+                 FRAME,             // 一帧的总耗时（不含等待事件）
+                 // 以下为 GpuTimer 用计时查询测得的GPU执行时间，在几帧之后取回
+                 GPU_VIDEO_UPLOAD,
+                 GPU_TEXTURE_LOAD,
+                 GPU_VIRTUAL_TEXTURE,
+                 GPU_RENDER,
+                 GPU_READBACK,
+                 GPU_FRAME,         // 一帧开始和结束两个时间戳之差
+                 STAGE_COUNT };
+    enum { WINDOW_SIZE = 1024,  // 滚动百分位使用的最近样本数
+           BUCKET_COUNT = 16 };  // 直方图第 i 个桶的上界为 BUCKET_BASE_MS * 2^i，最后一个桶不设上界
+
+    struct Summary {
+        long count = 0;  // 累计次数
+        double meanMs = 0.0;
+        double maxMs = 0.0;
+        // 以下为最近 WINDOW_SIZE 次
+        double p50Ms = 0.0;
+        double p95Ms = 0.0;
+        double p99Ms = 0.0;
+    };
+
+    FrameProfiler();
+
+    static const char *stageName(Stage stage);
+    static double bucketUpperMs(int bucket);
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // 可以在任意线程调用
+    void record(Stage stage, double ms);
+    Summary summarize(Stage stage) const;
+    // 每个有样本的阶段一行，供叠加层显示
+    std::vector<std::string> formatTable() const;
+    // 写出各阶段的统计和直方图
+    bool dump(const std::string &path) const;
+    void reset();
+
+   private:
+    struct StageData {
+        mutable std::mutex mutex;
+        float window[WINDOW_SIZE];
+        int windowCount = 0;  // 环中有效的样本数
+        int windowNext = 0;
+        long count = 0;
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+        long buckets[BUCKET_COUNT] = {};
+    };
+
+    std::atomic<bool> m_enabled;
+    StageData m_stages[STAGE_COUNT];
+};
+
+// 作用域计时：构造时开始，析构时记录；统计和时间线都未启用时几乎没有开销
+class ScopedStageTimer {
+   public:
+    ScopedStageTimer(FrameProfiler *profiler, FrameProfiler::Stage stage)
+        : m_profiler(profiler && profiler->isEnabled() ? profiler : nullptr), m_trace(TraceRecorder::isRecording()), m_stage(stage), m_start(m_profiler || m_trace ? cv::getTickCount() : 0) {}
+    ~ScopedStageTimer() { stop(); }
+    // 在作用域结束之前提前记录，之后析构不再记录
+    void stop() {
+        if (!m_profiler && !m_trace) return;
+        int64_t end = cv::getTickCount();
+        if (m_profiler) m_profiler->record(m_stage, (end - m_start) * 1000.0 / cv::getTickFrequency());
+        if (m_trace) TraceRecorder::instance().addEvent(FrameProfiler::stageName(m_stage), m_start, end);
+        m_profiler = nullptr;
+        m_trace = false;
+    }
+    ScopedStageTimer(const ScopedStageTimer &) = delete;
+    ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+   private:
+    FrameProfiler *m_profiler;
+    bool m_trace;
+    FrameProfiler::Stage m_stage;
+    int64_t m_start;
+};
+
+#endif  // FRAMEPROFILER_H
@@ -0,0 +1,109 @@
+/**
+* @file        :FrameReadback.cpp
+* @brief       :渲染结果的异步回读实现
+* @details     :绑定 GL_PIXEL_PACK_BUFFER 后 glReadPixels 的指针参数是缓冲区内偏移，驱动在 GPU 上完成拷贝后才触发 fence
+* @date        :2026/10/16 19:20:10
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "FrameReadback.h"
+
+#include <cstring>
+#include <iostream>
+
+FrameReadback::FrameReadback()
+    : m_width(0), m_height(0), m_frameBytes(0), m_bufferCount(3), m_nextBuffer(0) {
+}
+
+bool FrameReadback::init(int width, int height, int bufferCount) {
+    release();
+
+    m_width = width;
+    m_height = height;
+    m_frameBytes = (size_t)width * height * 3;
+    m_bufferCount = bufferCount < 2 ? 2 : bufferCount;
+    m_nextBuffer = 0;
+
+    m_pbos.resize(m_bufferCount);
+    glGenBuffers(m_bufferCount, m_pbos.data());
+    for (GLuint pbo : m_pbos) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        // STREAM_READ：GPU 写入一次，CPU 读取一次
+        glBufferData(GL_PIXEL_PACK_BUFFER, m_frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_fences.assign(m_bufferCount, nullptr);
+    m_stats = Stats();
+    return m_pbos[0] != 0;
+}
+
+void FrameReadback::release() {
+    for (GLsync fence : m_fences) {
+        if (fence) glDeleteSync(fence);
+    }
+    m_fences.clear();
+    if (!m_pbos.empty()) {
+        glDeleteBuffers((GLsizei)m_pbos.size(), m_pbos.data());
+        m_pbos.clear();
+    }
+    m_pending.clear();
+}
+
+bool FrameReadback::readAsync() {
+    if (m_pbos.empty() || isFull()) return false;
+    int index = m_nextBuffer;
+    m_nextBuffer = (m_nextBuffer + 1) % m_bufferCount;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbos[index]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);  // 每行 width*3 字节，不一定是4字节对齐
+    glReadPixels(0, 0, m_width, m_height, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_fences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_pending.push_back(index);
+    return true;
+}
+
+bool FrameReadback::popFrame(cv::Mat &frame) {
+    if (m_pending.empty()) return false;
+    int index = m_pending.front();
+    m_pending.pop_front();
+
+    double t0 = cv::getTickCount();
+    // 刷新命令队列，保证 fence 一定会被 GPU 执行到
+    GLenum waitResult = glClientWaitSync(m_fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 5000000000ull);
+    glDeleteSync(m_fences[index]);
+    m_fences[index] = nullptr;
+    double t1 = cv::getTickCount();
+    if (waitResult != GL_ALREADY_SIGNALED && waitResult != GL_CONDITION_SATISFIED) {
+        // 超时或等待失败时 GPU 可能还没写完这个缓冲区，不能当作有效帧
+        std::cerr << "FrameReadback: " << (waitResult == GL_TIMEOUT_EXPIRED ? "timed out waiting for the GPU." : "waiting for the GPU failed.") << std::endl;
+        return false;
+    }
+
+    frame.create(m_height, m_width, CV_8UC3);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbos[index]);
+    const unsigned char *ptr = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_frameBytes, GL_MAP_READ_BIT);
+    bool ok = ptr != nullptr;
+    if (ok) {
+        // OpenGL 的第0行在底部，逐行倒序拷贝即完成垂直翻转
+        size_t rowBytes = (size_t)m_width * 3;
+        for (int r = 0; r < m_height; r++) {
+            memcpy(frame.ptr(m_height - 1 - r), ptr + r * rowBytes, rowBytes);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        std::cerr << "FrameReadback: cannot map pixel pack buffer." << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    double t2 = cv::getTickCount();
+
+    m_stats.frames++;
+    m_stats.totalWaitMs += (t1 - t0) * 1000.0 / cv::getTickFrequency();
+    m_stats.totalCopyMs += (t2 - t1) * 1000.0 / cv::getTickFrequency();
+    return ok;
+}
@@ -0,0 +1,66 @@
+/**
+* @file        :FrameReadback.h
+* @brief       :渲染结果的异步回读
+* @details     :glReadPixels 直接读到客户端内存时，CPU 必须等 GPU 画完这一帧才能返回。这里改为读到像素打包缓冲区（PBO）环中，
+*               调用立即返回，每个缓冲区附带一个 fence；等环满了再映射最早的那个缓冲区取数据，
+*               此时 GPU 通常早已完成，第 N 帧的回读与第 N+1 帧的渲染重叠。
+*               直接按 GL_BGR 读取，拷出时逐行上下翻转，不再需要 cv::flip 和 cv::cvtColor
+* @date        :2026/10/16 19:20:10
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef FRAMEREADBACK_H
+#define FRAMEREADBACK_H
+
+#include <deque>
+#include <vector>
+#include <GL/glew.h>
+#include <opencv2/opencv.hpp>
+
+class FrameReadback {
+   public:
+    // 等待 fence 和拷贝数据的耗时统计（CPU侧，毫秒）
+    struct Stats {
+        long frames = 0;
+        double totalWaitMs = 0.0;  // glClientWaitSync 阻塞的时间，环足够深时接近0
+        double totalCopyMs = 0.0;  // 从映射的缓冲区拷贝到 cv::Mat 的时间
+        double averageWaitMs() const { return frames > 0 ? totalWaitMs / frames : 0.0; }
+        double averageCopyMs() const { return frames > 0 ? totalCopyMs / frames : 0.0; }
+    };
+
+    FrameReadback();
+    FrameReadback(const FrameReadback &) = delete;
+    FrameReadback &operator=(const FrameReadback &) = delete;
+
+    // 分配PBO环，必须在有 OpenGL 上下文的线程调用
+    bool init(int width, int height, int bufferCount = 3);
+    // 释放PBO环和栅栏，持有者须在 OpenGL 上下文销毁前调用，析构函数不会代为释放
+    void release();
+
+    // 把当前读帧缓冲区的 width x height 区域异步读入下一个空闲的PBO，环已满时返回 false（先调用 popFrame）
+    bool readAsync();
+    // 取出最早一次 readAsync 的结果到 frame（CV_8UC3，BGR，行序已翻转为 OpenCV 坐标系）；
+    // frame 尺寸类型不对时重新分配；没有未取出的回读、等待 GPU 超时或失败、映射失败时返回 false，此时 frame 内容无效
+    bool popFrame(cv::Mat &frame);
+
+    int getPendingCount() const { return (int)m_pending.size(); }
+    bool isFull() const { return (int)m_pending.size() == m_bufferCount; }
+    const Stats &getStats() const { return m_stats; }
+
+   private:
+    int m_width;
+    int m_height;
+    size_t m_frameBytes;
+    int m_bufferCount;
+    int m_nextBuffer;
+    std::vector<GLuint> m_pbos;
+    std::vector<GLsync> m_fences;
+    std::deque<int> m_pending;  // 已发出回读、尚未取出的缓冲区下标，按发出顺序
+    Stats m_stats;
+};
+
+#endif  // FRAMEREADBACK_H
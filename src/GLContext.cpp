@@ -0,0 +1,334 @@
+/**
+* @file        :GLContext.cpp
+* @brief       :OpenGL 上下文后端实现
+* @details     :EGL 后端优先使用 EGL_MESA_platform_surfaceless 显示，其次 EGL_EXT_platform_device，最后默认显示；
+*               GLEW 按 GLX 编译时在无 X 显示的上下文中会返回 GLEW_ERROR_NO_GLX_DISPLAY，但核心函数已经加载，可以忽略
+* @date        :2026/10/16 14:20:10
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "GLContext.h"
+
+#include <iostream>
+
+#ifdef PANO_WITH_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#ifdef PANO_WITH_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+GLContext::GLContext()
+    : m_backend(Backend::GLFW_WINDOW), m_profile(Profile::CORE), m_window(nullptr), m_glfwInitialized(false), m_framebuffer(0), m_colorBuffer(0), m_depthBuffer(0), m_eglDisplay(nullptr), m_eglContext(nullptr), m_osmesaContext(nullptr), m_width(0), m_height(0) {
+}
+
+GLContext::~GLContext() {
+    destroy();
+}
+
+const char *GLContext::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::GLFW_WINDOW:
+            return "window";
+        case Backend::GLFW_HIDDEN:
+            return "hidden";
+        case Backend::EGL_SURFACELESS:
+            return "egl";
+        case Backend::OSMESA:
+            return "osmesa";
+    }
+    return "unknown";
+}
+
+bool GLContext::parseBackend(const std::string &name, Backend &backend) {
+    for (Backend b : {Backend::GLFW_WINDOW, Backend::GLFW_HIDDEN, Backend::EGL_SURFACELESS, Backend::OSMESA}) {
+        if (name == backendName(b)) {
+            backend = b;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *GLContext::profileName(Profile profile) {
+    return profile == Profile::CORE ? "core" : "compat";
+}
+
+bool GLContext::parseProfile(const std::string &name, Profile &profile) {
+    for (Profile p : {Profile::CORE, Profile::COMPATIBILITY}) {
+        if (name == profileName(p)) {
+            profile = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GLContext::create(Backend backend, int width, int height, const char *title, Profile profile) {
+    destroy();
+    m_backend = backend;
+    m_profile = profile;
+    m_width = width;
+    m_height = height;
+
+    bool ok = false;
+    switch (backend) {
+        case Backend::GLFW_WINDOW:
+            ok = createGlfw(true, width, height, title, profile);
+            break;
+        case Backend::GLFW_HIDDEN:
+            ok = createGlfw(false, width, height, title, profile);
+            break;
+        case Backend::EGL_SURFACELESS:
+            ok = createEgl(profile);
+            break;
+        case Backend::OSMESA:
+            ok = createOSMesa(width, height, profile);
+            break;
+    }
+    if (!ok || !initGlew()) {
+        destroy();
+        return false;
+    }
+
+    // 无表面的 EGL 上下文没有默认帧缓冲区，渲染到同尺寸的离屏帧缓冲区
+    if (backend == Backend::EGL_SURFACELESS && !createOffscreenFramebuffer(width, height)) {
+        destroy();
+        return false;
+    }
+    glViewport(0, 0, width, height);
+
+    std::cout << "OpenGL context (" << backendName(backend) << ", " << profileName(m_profile) << "): " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+    return true;
+}
+
+bool GLContext::createGlfw(bool visible, int width, int height, const char *title, Profile profile) {
+    if (!glfwInit()) {
+        std::cerr << "GLFW init failed!" << std::endl;
+        return false;
+    }
+    m_glfwInitialized = true;
+
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+    if (profile == Profile::CORE) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);  // macOS 只提供前向兼容的核心模式
+    }
+    m_window = glfwCreateWindow(width, height, title, nullptr, nullptr);
+    if (!m_window && profile == Profile::CORE) {
+        std::cerr << "OpenGL 3.3 core profile not available, fall back to the default context." << std::endl;
+        glfwDefaultWindowHints();
+        glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+        m_window = glfwCreateWindow(width, height, title, nullptr, nullptr);
+        m_profile = Profile::COMPATIBILITY;
+    }
+    if (!m_window) {
+        std::cerr << "create window failed!" << std::endl;
+        return false;
+    }
+    glfwMakeContextCurrent(m_window);
+    return true;
+}
+
+bool GLContext::createEgl(Profile profile) {
+#ifdef PANO_WITH_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        // 1. Mesa 的无表面平台，不需要任何显示服务或 DRM 设备
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        // 2. 直接使用第一个 EGL 设备（如无头服务器上的独立显卡）
+        if (display == EGL_NO_DISPLAY) {
+            PFNEGLQUERYDEVICESEXTPROC queryDevices = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+            EGLDeviceEXT device;
+            EGLint numDevices = 0;
+            if (queryDevices && queryDevices(1, &device, &numDevices) && numDevices > 0) {
+                display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+            }
+        }
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cerr << "EGL initialize failed!" << std::endl;
+        return false;
+    }
+    m_eglDisplay = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL does not support desktop OpenGL!" << std::endl;
+        return false;
+    }
+
+    EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+    // 请求 3.3 核心或兼容模式上下文，驱动不支持时退回默认上下文
+    EGLint profileMask = profile == Profile::CORE ? EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT : EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT;
+    EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3, EGL_CONTEXT_OPENGL_PROFILE_MASK, profileMask, EGL_NONE};
+    EGLContext context = eglCreateContext(display, numConfigs > 0 ? config : nullptr, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "OpenGL 3.3 " << profileName(profile) << " profile not available, fall back to the default context." << std::endl;
+        context = eglCreateContext(display, numConfigs > 0 ? config : nullptr, EGL_NO_CONTEXT, nullptr);
+        m_profile = Profile::COMPATIBILITY;
+    }
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "EGL create context failed! error: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        return false;
+    }
+    m_eglContext = context;
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cerr << "EGL surfaceless make current failed (EGL_KHR_surfaceless_context required)!" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    (void)profile;
+    std::cerr << "EGL backend not compiled in, rebuild with PANO_WITH_EGL." << std::endl;
+    return false;
+#endif
+}
+
+bool GLContext::createOSMesa(int width, int height, Profile profile) {
+#ifdef PANO_WITH_OSMESA
+    const int attribs[] = {OSMESA_FORMAT, OSMESA_RGBA, OSMESA_DEPTH_BITS, 24, OSMESA_STENCIL_BITS, 8, OSMESA_PROFILE, profile == Profile::CORE ? OSMESA_CORE_PROFILE : OSMESA_COMPAT_PROFILE, OSMESA_CONTEXT_MAJOR_VERSION, 3, OSMESA_CONTEXT_MINOR_VERSION, 3, 0};
+    OSMesaContext context = OSMesaCreateContextAttribs(attribs, nullptr);
+    if (!context) {
+        std::cerr << "OpenGL 3.3 " << profileName(profile) << " profile not available, fall back to the default context." << std::endl;
+        context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 8, 0, nullptr);
+        m_profile = Profile::COMPATIBILITY;
+    }
+    if (!context) {
+        std::cerr << "OSMesa create context failed!" << std::endl;
+        return false;
+    }
+    m_osmesaContext = context;
+
+    // OSMesa 直接渲染到这块内存，它就是默认帧缓冲区
+    m_osmesaBuffer.assign((size_t)width * height * 4, 0);
+    if (!OSMesaMakeCurrent(context, m_osmesaBuffer.data(), GL_UNSIGNED_BYTE, width, height)) {
+        std::cerr << "OSMesa make current failed!" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    (void)width;
+    (void)height;
+    (void)profile;
+    std::cerr << "OSMesa backend not compiled in, rebuild with PANO_WITH_OSMESA." << std::endl;
+    return false;
+#endif
+}
+
+bool GLContext::initGlew() {
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLX 版本的 GLEW 在没有 X 显示的上下文中会返回该错误，此时 OpenGL 函数已经加载完毕
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY && isHeadless()) {
+        err = GLEW_OK;
+    }
+#endif
+    if (err != GLEW_OK) {
+        std::cerr << "GLEW init failed: " << glewGetErrorString(err) << std::endl;
+        return false;
+    }
+    // 核心模式下 GLEW 用 glGetString(GL_EXTENSIONS) 查询扩展会留下 GL_INVALID_ENUM，清除掉以免干扰之后的错误检查
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    return true;
+}
+
+bool GLContext::createOffscreenFramebuffer(int width, int height) {
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer not complete! Error code: " << status << std::endl;
+        return false;
+    }
+    // 之后保持绑定，渲染代码把它当作默认帧缓冲区使用
+    return true;
+}
+
+void GLContext::makeCurrent() {
+    if (m_window) {
+        glfwMakeContextCurrent(m_window);
+    }
+#ifdef PANO_WITH_EGL
+    if (m_eglContext) {
+        eglMakeCurrent((EGLDisplay)m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext)m_eglContext);
+    }
+#endif
+#ifdef PANO_WITH_OSMESA
+    if (m_osmesaContext) {
+        OSMesaMakeCurrent((OSMesaContext)m_osmesaContext, m_osmesaBuffer.data(), GL_UNSIGNED_BYTE, m_width, m_height);
+    }
+#endif
+}
+
+void GLContext::swapBuffers() {
+    if (m_window) {
+        glfwSwapBuffers(m_window);
+    } else {
+        glFlush();  // 离屏渲染没有交换链，只需提交命令
+    }
+}
+
+void GLContext::destroy() {
+    if (m_framebuffer) {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        glDeleteRenderbuffers(1, &m_colorBuffer);
+        glDeleteRenderbuffers(1, &m_depthBuffer);
+        m_framebuffer = m_colorBuffer = m_depthBuffer = 0;
+    }
+    if (m_window) {
+        glfwDestroyWindow(m_window);
+        m_window = nullptr;
+    }
+    if (m_glfwInitialized) {
+        glfwTerminate();
+        m_glfwInitialized = false;
+    }
+#ifdef PANO_WITH_EGL
+    if (m_eglDisplay) {
+        eglMakeCurrent((EGLDisplay)m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (m_eglContext) eglDestroyContext((EGLDisplay)m_eglDisplay, (EGLContext)m_eglContext);
+        eglTerminate((EGLDisplay)m_eglDisplay);
+    }
+#endif
+    m_eglDisplay = nullptr;
+    m_eglContext = nullptr;
+#ifdef PANO_WITH_OSMESA
+    if (m_osmesaContext) {
+        OSMesaDestroyContext((OSMesaContext)m_osmesaContext);
+    }
+#endif
+    m_osmesaContext = nullptr;
+    m_osmesaBuffer.clear();
+}
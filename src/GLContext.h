@@ -0,0 +1,82 @@
+/**
+* @file        :GLContext.h
+* @brief       :OpenGL 上下文后端
+* @details     :统一创建 GLFW 窗口、GLFW 隐藏窗口、无表面的 EGL（如 Mesa llvmpipe）和 OSMesa 离屏上下文，
+*               无窗口后端渲染到离屏帧缓冲区，使导出和基准测试可以在没有显示器的服务器或CI上运行
+* @date        :2026/10/16 14:20:10
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef GLCONTEXT_H
+#define GLCONTEXT_H
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+class GLContext {
+   public:
+    enum class Backend { GLFW_WINDOW,      // 普通可见窗口（默认）
+                         GLFW_HIDDEN,      // 隐藏窗口，仍然需要显示服务
+                         EGL_SURFACELESS,  // 无表面 EGL 上下文，需要以 PANO_WITH_EGL 编译
+                         OSMESA };         // OSMesa 软件渲染，需要以 PANO_WITH_OSMESA 编译
+    enum class Profile { CORE,            // 3.3 核心模式，没有固定管线函数，驱动可以走更快的路径
+                         COMPATIBILITY };  // 兼容模式，PANO_LEGACY_GL 的立即模式绘制需要
+
+    GLContext();
+    ~GLContext();
+
+    // 创建上下文并设为当前，同时初始化 GLEW；无窗口后端会创建 width x height 的离屏帧缓冲区。
+    // 驱动不支持请求的核心模式时退回驱动默认的上下文
+    bool create(Backend backend, int width, int height, const char *title, Profile profile = Profile::CORE);
+    void destroy();
+
+    void makeCurrent();
+    void swapBuffers();
+
+    Backend getBackend() const { return m_backend; }
+    // 实际创建的上下文模式
+    Profile getProfile() const { return m_profile; }
+    // 无窗口后端返回nullptr
+    GLFWwindow *getWindow() const { return m_window; }
+    bool isHeadless() const { return m_window == nullptr; }
+    // 渲染到屏幕时应绑定的帧缓冲区：窗口后端为0，EGL 后端为离屏帧缓冲区
+    GLuint getFramebuffer() const { return m_framebuffer; }
+
+    static const char *backendName(Backend backend);
+    static bool parseBackend(const std::string &name, Backend &backend);
+    static const char *profileName(Profile profile);
+    static bool parseProfile(const std::string &name, Profile &profile);
+
+   private:
+    bool createGlfw(bool visible, int width, int height, const char *title, Profile profile);
+    bool createEgl(Profile profile);
+    bool createOSMesa(int width, int height, Profile profile);
+    bool initGlew();
+    bool createOffscreenFramebuffer(int width, int height);
+
+    Backend m_backend;
+    Profile m_profile;
+    GLFWwindow *m_window;
+    bool m_glfwInitialized;
+
+    // 离屏帧缓冲区（EGL 后端没有默认帧缓冲区）
+    GLuint m_framebuffer;
+    GLuint m_colorBuffer;
+    GLuint m_depthBuffer;
+
+    // 以 void* 保存平台句柄，避免在头文件中引入 EGL/OSMesa 头文件
+    void *m_eglDisplay;
+    void *m_eglContext;
+    void *m_osmesaContext;
+    std::vector<unsigned char> m_osmesaBuffer;  // OSMesa 渲染目标
+    int m_width;
+    int m_height;
+};
+
+#endif  // GLCONTEXT_H
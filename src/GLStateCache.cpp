@@ -0,0 +1,112 @@
+/**
+* @file        :GLStateCache.cpp
+* @brief       :OpenGL 绑定状态缓存实现
+* @details     :初始状态为未知，第一次绑定总会发出调用，因此不需要在构造时查询驱动的当前状态
+* @date        :2026/10/16 20:30:45
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "GLStateCache.h"
+
+GLStateCache::GLStateCache() : m_depthTest(false), m_blend(false) {
+    invalidate();
+}
+
+void GLStateCache::useProgram(GLuint program) {
+    if (m_programValid && m_program == program) {
+        m_stats.skipped++;
+        return;
+    }
+    glUseProgram(program);
+    m_program = program;
+    m_programValid = true;
+    m_stats.calls++;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+    if (m_vaoValid && m_vao == vao) {
+        m_stats.skipped++;
+        return;
+    }
+    glBindVertexArray(vao);
+    m_vao = vao;
+    m_vaoValid = true;
+    m_stats.calls++;
+}
+
+void GLStateCache::bindTexture2D(int unit, GLuint texture) {
+    if (unit < 0 || unit >= MAX_TEXTURE_UNITS) return;
+    if (m_texturesValid[unit] && m_textures[unit] == texture) {
+        m_stats.skipped++;
+        return;
+    }
+    if (m_activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_activeUnit = unit;
+        m_stats.calls++;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    m_textures[unit] = texture;
+    m_texturesValid[unit] = true;
+    m_stats.calls++;
+}
+
+void GLStateCache::primitiveRestartIndex(GLuint index) {
+    if (m_restartIndexValid && m_restartIndex == index) {
+        m_stats.skipped++;
+        return;
+    }
+    glPrimitiveRestartIndex(index);
+    m_restartIndex = index;
+    m_restartIndexValid = true;
+    m_stats.calls++;
+}
+
+void GLStateCache::setDepthTest(bool enabled) {
+    if (m_depthTest == enabled) {
+        m_stats.skipped++;
+        return;
+    }
+    if (enabled) {
+        glEnable(GL_DEPTH_TEST);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+    m_depthTest = enabled;
+    m_stats.calls++;
+}
+
+void GLStateCache::setBlend(bool enabled) {
+    if (m_blend == enabled) {
+        m_stats.skipped++;
+        return;
+    }
+    if (enabled) {
+        glEnable(GL_BLEND);
+    } else {
+        glDisable(GL_BLEND);
+    }
+    m_blend = enabled;
+    m_stats.calls++;
+}
+
+void GLStateCache::invalidate() {
+    m_program = 0;
+    m_vao = 0;
+    m_restartIndex = 0;
+    m_programValid = false;
+    m_vaoValid = false;
+    m_restartIndexValid = false;
+    invalidateTextures();
+}
+
+void GLStateCache::invalidateTextures() {
+    m_activeUnit = -1;
+    for (int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+        m_textures[i] = 0;
+        m_texturesValid[i] = false;
+    }
+}
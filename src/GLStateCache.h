@@ -0,0 +1,72 @@
+/**
+* @file        :GLStateCache.h
+* @brief       :OpenGL 绑定状态缓存
+* @details     :记录当前绑定的着色器程序、VAO、图元重启索引、活动纹理单元和各单元的2D纹理，绑定的对象没有变化时不再调用驱动；
+*               同时统计每帧实际发出和被跳过的 GL 调用次数，便于观察多视口渲染时的驱动调用开销。
+*               绕过本缓存直接修改这些绑定的代码（例如纹理上传）之后必须调用对应的 invalidate 函数。
+*               深度测试和混合的开关也记录在这里，初始为 GL 的默认值（关闭），只能经过本缓存修改，因此不需要 glIsEnabled 查询
+* @date        :2026/10/16 20:30:45
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef GLSTATECACHE_H
+#define GLSTATECACHE_H
+
+#include <GL/glew.h>
+
+class GLStateCache {
+   public:
+    enum { MAX_TEXTURE_UNITS = 8 };
+
+    // 每帧的 GL 调用统计
+    struct Stats {
+        long frames = 0;
+        long calls = 0;    // 实际发出的调用（绑定、uniform、绘制）
+        long skipped = 0;  // 因状态未变而省掉的绑定
+        double callsPerFrame() const { return frames > 0 ? (double)calls / frames : 0.0; }
+        double skippedPerFrame() const { return frames > 0 ? (double)skipped / frames : 0.0; }
+    };
+
+    GLStateCache();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindTexture2D(int unit, GLuint texture);
+    // 图元重启索引随索引类型变化（0xFFFF 或 0xFFFFFFFF），GL_PRIMITIVE_RESTART 需已启用
+    void primitiveRestartIndex(GLuint index);
+    void setDepthTest(bool enabled);
+    void setBlend(bool enabled);
+    bool isDepthTestEnabled() const { return m_depthTest; }
+    bool isBlendEnabled() const { return m_blend; }
+
+    // 绑定状态被外部代码修改后调用，下一次绑定一定会发出；深度测试和混合的开关不受影响
+    void invalidate();
+    void invalidateTextures();
+
+    // 记录不经过缓存的调用（uniform 上传、绘制等）
+    void countCalls(int count = 1) { m_stats.calls += count; }
+    // 一帧结束
+    void endFrame() { m_stats.frames++; }
+    const Stats &getStats() const { return m_stats; }
+    void resetStats() { m_stats = Stats(); }
+
+   private:
+    GLuint m_program;
+    GLuint m_vao;
+    int m_activeUnit;  // -1 表示未知
+    GLuint m_textures[MAX_TEXTURE_UNITS];
+    GLuint m_restartIndex;
+    bool m_depthTest;
+    bool m_blend;
+    bool m_programValid;
+    bool m_vaoValid;
+    bool m_restartIndexValid;
+    bool m_texturesValid[MAX_TEXTURE_UNITS];
+    Stats m_stats;
+};
+
+#endif  // GLSTATECACHE_H
@@ -0,0 +1,137 @@
+/**
+* @file        :GpuTimer.cpp
+* @brief       :GPU 计时查询池实现
+* @details     :同一组查询按发出的顺序完成，只要帧结束的时间戳可用，这一帧的其它查询也都可用，因此只检查最后一个
+* @date        :2026/10/17 13:10:25
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "GpuTimer.h"
+
+#include <cstdio>
+
+GpuTimer::GpuTimer()
+    : m_profiler(nullptr), m_supported(false), m_current(0), m_inFrame(false), m_stageOpen(false), m_droppedFrames(0) {
+}
+
+GpuTimer::~GpuTimer() {
+    // 查询对象需要在上下文销毁前由持有者调用 release() 释放
+}
+
+bool GpuTimer::init(FrameProfiler *profiler) {
+    release();
+    if (!profiler || !(GLEW_VERSION_3_3 || GLEW_ARB_timer_query)) {
+        return false;
+    }
+    m_profiler = profiler;
+    for (FrameQueries &frame : m_frames) {
+        glGenQueries(MAX_FRAME_QUERIES, frame.stageQueries);
+        glGenQueries(1, &frame.frameStart);
+        glGenQueries(1, &frame.frameEnd);
+    }
+    m_supported = true;
+    return true;
+}
+
+void GpuTimer::release() {
+    if (!m_supported) return;
+    for (FrameQueries &frame : m_frames) {
+        glDeleteQueries(MAX_FRAME_QUERIES, frame.stageQueries);
+        glDeleteQueries(1, &frame.frameStart);
+        glDeleteQueries(1, &frame.frameEnd);
+        frame = FrameQueries();
+    }
+    m_supported = false;
+    m_inFrame = false;
+    m_stageOpen = false;
+}
+
+void GpuTimer::beginFrame() {
+    if (!m_supported) return;
+    if (m_inFrame) endFrame(false);
+    // 上一帧被取消时继续用同一组，只有真正发出的帧才占用延迟的名额
+    if (m_frames[m_current].pending) {
+        m_current = (m_current + 1) % FRAME_LATENCY;
+    }
+    FrameQueries &frame = m_frames[m_current];
+    if (frame.pending && !harvest(frame, false)) {
+        m_droppedFrames++;  // 结果还没就绪，丢弃这一帧，查询对象直接复用
+    }
+    frame.pending = false;
+    frame.count = 0;
+    if (!isActive()) return;
+    glQueryCounter(frame.frameStart, GL_TIMESTAMP);
+    m_inFrame = true;
+}
+
+void GpuTimer::endFrame(bool recordFrame) {
+    if (!m_inFrame) return;
+    if (m_stageOpen) end();
+    m_inFrame = false;
+    FrameQueries &frame = m_frames[m_current];
+    if (!recordFrame && frame.count == 0) {
+        return;  // 没有可记录的结果，取消这一帧；已发出的开始时间戳下一帧重新发出即可
+    }
+    glQueryCounter(frame.frameEnd, GL_TIMESTAMP);
+    frame.recordFrame = recordFrame;
+    frame.pending = true;
+}
+
+bool GpuTimer::begin(FrameProfiler::Stage stage) {
+    FrameQueries &frame = m_frames[m_current];
+    if (!m_inFrame || m_stageOpen || frame.count >= MAX_FRAME_QUERIES) return false;
+    glBeginQuery(GL_TIME_ELAPSED, frame.stageQueries[frame.count]);
+    frame.stages[frame.count] = stage;
+    frame.count++;
+    m_stageOpen = true;
+    return true;
+}
+
+void GpuTimer::end() {
+    if (!m_stageOpen) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    m_stageOpen = false;
+}
+
+void GpuTimer::flush() {
+    if (!m_supported) return;
+    if (m_inFrame) endFrame(false);
+    // 从最早的一组开始，按发出的顺序取回
+    for (int i = 1; i <= FRAME_LATENCY; i++) {
+        FrameQueries &frame = m_frames[(m_current + i) % FRAME_LATENCY];
+        if (frame.pending) {
+            harvest(frame, true);
+            frame.pending = false;
+        }
+    }
+    if (m_droppedFrames > 0) {
+        printf("[gpu] timer results of %ld frames were not ready in time and dropped\n", m_droppedFrames);
+    }
+}
+
+bool GpuTimer::harvest(FrameQueries &frame, bool wait) {
+    if (!wait) {
+        GLint available = 0;
+        glGetQueryObjectiv(frame.frameEnd, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+    }
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(frame.frameStart, GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(frame.frameEnd, GL_QUERY_RESULT, &end);
+    GLuint64 span = end > start ? end - start : 0;
+    // 阶段都在帧的两个时间戳之间，超出跨度的结果无效（llvmpipe 的第一个 GL_TIME_ELAPSED 查询就是这样），丢弃
+    GLuint64 ns = 0;
+    for (int i = 0; i < frame.count; i++) {
+        glGetQueryObjectui64v(frame.stageQueries[i], GL_QUERY_RESULT, &ns);
+        if (ns <= span) {
+            m_profiler->record(frame.stages[i], ns * 1e-6);
+        }
+    }
+    if (frame.recordFrame) {
+        m_profiler->record(FrameProfiler::GPU_FRAME, span * 1e-6);
+    }
+    return true;
+}
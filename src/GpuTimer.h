@@ -0,0 +1,91 @@
+/**
+* @file        :GpuTimer.h
+* @brief       :GPU 计时查询池
+* @details     :每帧的阶段用 GL_TIME_ELAPSED 查询包围（同一时刻只能有一个，因此阶段之间不能嵌套），帧的起止各发一个 GL_TIMESTAMP 查询。
+*               查询对象按帧分成 FRAME_LATENCY 组循环使用，一组在 FRAME_LATENCY 帧之后再次轮到时才读取结果，
+*               读取前先检查 GL_QUERY_RESULT_AVAILABLE，结果还没准备好就丢弃这一帧，不会让CPU等待GPU。
+*               结果以 FrameProfiler 的 GPU_* 阶段记录，与CPU计时共用同一套统计、叠加层和输出文件
+* @date        :2026/10/17 13:10:25
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <GL/glew.h>
+
+#include "FrameProfiler.h"
+
+class GpuTimer {
+   public:
+    enum { FRAME_LATENCY = 4,         // 查询结果在几帧之后取回
+           MAX_FRAME_QUERIES = 16 };  // 每帧最多的阶段查询数，超出的阶段不计时
+
+    GpuTimer();
+    ~GpuTimer();
+
+    // 创建查询池，上下文不支持计时查询（GL 3.3 以下且没有 ARB_timer_query）时返回false，之后的调用都不做任何事
+    bool init(FrameProfiler *profiler);
+    void release();
+    // profiler 启用时才发出查询
+    bool isActive() const { return m_supported && m_profiler->isEnabled(); }
+
+    // 一帧开始：先取回 FRAME_LATENCY 帧之前同一组的结果，再发出帧开始的时间戳
+    void beginFrame();
+    // 一帧结束，recordFrame 为 false 时不记录 GPU_FRAME（例如按需渲染时跳过绘制的空闲帧），这样的帧没有阶段查询时直接取消
+    void endFrame(bool recordFrame = true);
+    // 开始一个阶段的计时，不在帧内、已有阶段在计时或本帧查询已用完时不发出查询并返回 false，此时不应调用 end()
+    bool begin(FrameProfiler::Stage stage);
+    void end();
+    // 阻塞等待并取回所有未取回的结果，只在导出结束和退出前调用
+    void flush();
+
+    // 因结果没有及时就绪而丢弃的帧数
+    long getDroppedFrames() const { return m_droppedFrames; }
+
+   private:
+    struct FrameQueries {
+        GLuint stageQueries[MAX_FRAME_QUERIES];
+        FrameProfiler::Stage stages[MAX_FRAME_QUERIES];
+        int count = 0;
+        GLuint frameStart = 0;  // GL_TIMESTAMP
+        GLuint frameEnd = 0;    // GL_TIMESTAMP
+        bool pending = false;   // 已发出、尚未取回
+        bool recordFrame = false;
+    };
+
+    // wait 为 false 时结果未就绪返回false
+    bool harvest(FrameQueries &frame, bool wait);
+
+    FrameProfiler *m_profiler;
+    bool m_supported;
+    FrameQueries m_frames[FRAME_LATENCY];
+    int m_current;      // 当前帧使用的组
+    bool m_inFrame;     // beginFrame 之后、endFrame 之前
+    bool m_stageOpen;   // 有一个 GL_TIME_ELAPSED 查询正在进行
+    long m_droppedFrames;
+};
+
+// 作用域GPU计时，计时器未启用、不在帧内或已有阶段在计时时什么也不做
+class ScopedGpuTimer {
+   public:
+    ScopedGpuTimer(GpuTimer &timer, FrameProfiler::Stage stage)
+        : m_timer(timer.isActive() ? &timer : nullptr) {
+        // 没有发出查询时析构也不结束，避免提前结束外层阶段的查询
+        if (m_timer && !m_timer->begin(stage)) m_timer = nullptr;
+    }
+    ~ScopedGpuTimer() {
+        if (m_timer) m_timer->end();
+    }
+    ScopedGpuTimer(const ScopedGpuTimer &) = delete;
+    ScopedGpuTimer &operator=(const ScopedGpuTimer &) = delete;
+
+   private:
+    GpuTimer *m_timer;
+};
+
+#endif  // GPUTIMER_H
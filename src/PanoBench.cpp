@@ -0,0 +1,432 @@
+/**
+* @file        :PanoBench.cpp
+* @brief       :核心热点路径的基准测试程序
+* @details     :每个用例先预热若干次，再计时若干次，输出均值、中位数、p95、最小、最大和标准差，可以写成 JSON 便于在版本之间对比。
+*               覆盖球体网格生成、图像解码（及 PanoViewer 的颜色转换和翻转）、视频解码和格式转换、照片动画师的参数插值、CPU 重投影（逐像素和查找表缓存），
+*               以及在离屏上下文中的视频纹理上传和各视角、各绘制方式的渲染加回读；只有CPU的机器可以用 egl/osmesa 后端（如 llvmpipe）运行
+* @date        :2026/10/17 16:45:10
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PanoramaRenderer.h"
+
+namespace {
+
+struct BenchConfig {
+    int warmup = 3;
+    int iterations = 20;
+    std::string imagePath = "data/360panorama.jpg";
+    std::string videoPath = "data/360panodemo.mp4";
+    std::string jsonPath;
+    std::string filter;  // 只运行名称包含该字符串的用例
+    bool gl = true;
+#if defined(PANO_WITH_EGL)
+    GLContext::Backend backend = GLContext::Backend::EGL_SURFACELESS;
+#elif defined(PANO_WITH_OSMESA)
+    GLContext::Backend backend = GLContext::Backend::OSMESA;
+#else
+    GLContext::Backend backend = GLContext::Backend::GLFW_HIDDEN;
+#endif
+    int renderWidth = 1280;
+    int renderHeight = 720;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string params;
+    int iterations = 0;
+    double meanMs = 0.0;
+    double medianMs = 0.0;
+    double p95Ms = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double stddevMs = 0.0;
+};
+
+class BenchRunner {
+   public:
+    explicit BenchRunner(const BenchConfig &config) : m_config(config) {}
+
+    bool selected(const std::string &name) const {
+        return m_config.filter.empty() || name.find(m_config.filter) != std::string::npos;
+    }
+
+    // prepare 在每次调用 body 之前执行，不计入耗时（例如视频播放到结尾时重新打开）
+    void run(const std::string &name, const std::string &params, const std::function<void()> &body, const std::function<void()> &prepare = nullptr) {
+        if (!selected(name)) return;
+        for (int i = 0; i < m_config.warmup; i++) {
+            if (prepare) prepare();
+            body();
+        }
+        std::vector<double> samples;
+        samples.reserve(m_config.iterations);
+        for (int i = 0; i < m_config.iterations; i++) {
+            if (prepare) prepare();
+            int64_t t0 = cv::getTickCount();
+            body();
+            samples.push_back((cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency());
+        }
+        m_results.push_back(summarize(name, params, samples));
+        print(m_results.back());
+    }
+
+    void addInfo(const std::string &key, const std::string &value) { m_info.push_back(std::make_pair(key, value)); }
+
+    bool writeJson(const std::string &path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Could not write benchmark results: " << path << std::endl;
+            return false;
+        }
+        out << std::fixed << std::setprecision(4);
+        out << "{\n  \"config\": {\"warmup\": " << m_config.warmup << ", \"iterations\": " << m_config.iterations << "},\n";
+        out << "  \"info\": {";
+        for (size_t i = 0; i < m_info.size(); i++) {
+            out << (i ? ", " : "") << "\"" << escape(m_info[i].first) << "\": \"" << escape(m_info[i].second) << "\"";
+        }
+        out << "},\n  \"results\": [\n";
+        for (size_t i = 0; i < m_results.size(); i++) {
+            const BenchResult &r = m_results[i];
+            out << "    {\"name\": \"" << escape(r.name) << "\", \"params\": \"" << escape(r.params) << "\", \"iterations\": " << r.iterations << ", \"mean_ms\": " << r.meanMs
+                << ", \"median_ms\": " << r.medianMs << ", \"p95_ms\": " << r.p95Ms << ", \"min_ms\": " << r.minMs << ", \"max_ms\": " << r.maxMs << ", \"stddev_ms\": " << r.stddevMs
+                << "}" << (i + 1 < m_results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        if (!out) {
+            std::cerr << "Could not write benchmark results: " << path << std::endl;
+            return false;
+        }
+        std::cout << "Benchmark results written to " << path << std::endl;
+        return true;
+    }
+
+    static void printHeader() {
+        printf("%-28s %-30s %10s %10s %10s %10s %10s\n", "benchmark", "params", "mean ms", "median", "p95", "min", "stddev");
+    }
+
+   private:
+    static BenchResult summarize(const std::string &name, const std::string &params, std::vector<double> samples) {
+        BenchResult r;
+        r.name = name;
+        r.params = params;
+        r.iterations = (int)samples.size();
+        if (samples.empty()) return r;
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for (double s : samples) sum += s;
+        r.meanMs = sum / samples.size();
+        double var = 0.0;
+        for (double s : samples) var += (s - r.meanMs) * (s - r.meanMs);
+        r.stddevMs = samples.size() > 1 ? std::sqrt(var / (samples.size() - 1)) : 0.0;
+        size_t n = samples.size();
+        r.medianMs = n % 2 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+        r.p95Ms = samples[std::min(n - 1, (size_t)std::ceil(0.95 * n) - 1)];
+        r.minMs = samples.front();
+        r.maxMs = samples.back();
+        return r;
+    }
+
+    static void print(const BenchResult &r) {
+        printf("%-28s %-30s %10.3f %10.3f %10.3f %10.3f %10.3f\n", r.name.c_str(), r.params.c_str(), r.meanMs, r.medianMs, r.p95Ms, r.minMs, r.stddevMs);
+        fflush(stdout);
+    }
+
+    static std::string escape(const std::string &text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            if ((unsigned char)c >= 0x20) out += c;
+        }
+        return out;
+    }
+
+    const BenchConfig &m_config;
+    std::vector<BenchResult> m_results;
+    std::vector<std::pair<std::string, std::string>> m_info;
+};
+
+void printUsage(const char *program) {
+    std::cout << "Usage: " << program << " [--image file] [--video file] [--warmup N] [--iterations N] [--json file] [--filter text] [--backend egl|osmesa|hidden|window] [--render-size WxH] [--no-gl]" << std::endl;
+    std::cout << "  --image file: Panorama image for the decode and render benchmarks (default: data/360panorama.jpg)." << std::endl;
+    std::cout << "  --video file: Video for the decode and upload benchmarks (default: data/360panodemo.mp4), skipped when it cannot be opened." << std::endl;
+    std::cout << "  --warmup N: Untimed runs before each benchmark (default: 3)." << std::endl;
+    std::cout << "  --iterations N: Timed runs of each benchmark (default: 20)." << std::endl;
+    std::cout << "  --json file: Also write the results as JSON, for comparing releases." << std::endl;
+    std::cout << "  --filter text: Only run benchmarks whose name contains text." << std::endl;
+    std::cout << "  --backend egl|osmesa|hidden|window: OpenGL context of the render benchmarks (default: egl, or osmesa/hidden when egl is not built)." << std::endl;
+    std::cout << "  --render-size WxH: Output size of the CPU render, GPU render and readback benchmarks (default: 1280x720)." << std::endl;
+    std::cout << "  --no-gl: Only run the CPU benchmarks, no OpenGL context is created." << std::endl;
+}
+
+const char *viewModeName(PanoramaRenderer::ViewMode mode) {
+    switch (mode) {
+        case PanoramaRenderer::ViewMode::PERSPECTIVE:
+            return "perspective";
+        case PanoramaRenderer::ViewMode::LITTLEPLANET:
+            return "littleplanet";
+        case PanoramaRenderer::ViewMode::CRYSTALBALL:
+            return "crystalball";
+    }
+    return "?";
+}
+
+void runSphereBenchmarks(BenchRunner &runner) {
+    const int sizes[][2] = {{32, 64}, {64, 128}, {128, 256}, {256, 512}};
+    const SphereIndexOrder orders[] = {SphereIndexOrder::ROW_MAJOR, SphereIndexOrder::STRIP, SphereIndexOrder::TIPSIFY};
+    const char *orderNames[] = {"list", "strip", "tipsify"};
+    for (const auto &size : sizes) {
+        for (int o = 0; o < 3; o++) {
+            char params[64];
+            std::snprintf(params, sizeof(params), "rings=%d sectors=%d %s", size[0], size[1], orderNames[o]);
+            runner.run("sphere generation", params, [&]() {
+                SphereData sphere(1.0f, size[0], size[1], orders[o]);
+                if (sphere.getNumIndices() == 0) std::cerr << "empty sphere" << std::endl;
+            });
+        }
+    }
+}
+
+void runImageBenchmarks(BenchRunner &runner, const BenchConfig &config) {
+    if (cv::imread(config.imagePath, cv::IMREAD_COLOR).empty()) {
+        std::cerr << "can not load image " << config.imagePath << ", image benchmarks skipped." << std::endl;
+        return;
+    }
+    // 360Viewer 的 loadTexture：保持 BGR，纵向翻转交给着色器
+    runner.run("image decode", config.imagePath, [&]() {
+        cv::Mat image = cv::imread(config.imagePath, cv::IMREAD_COLOR);
+    });
+    // PanoViewer 的 loadTexture：解码后在CPU上转RGB并上下翻转
+    runner.run("image decode+cvtColor+flip", config.imagePath, [&]() {
+        cv::Mat image = cv::imread(config.imagePath, cv::IMREAD_COLOR);
+        cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
+        cv::flip(image, image, 0);
+    });
+    // 渐进加载的预览
+    runner.run("image decode reduced", config.imagePath + " 1/4", [&]() {
+        cv::Mat image = ProgressiveImageLoader::decodePreview(config.imagePath);
+    });
+}
+
+void runVideoBenchmarks(BenchRunner &runner, const BenchConfig &config) {
+    std::unique_ptr<cv::VideoCapture> capture(new cv::VideoCapture(config.videoPath));
+    if (!capture->isOpened()) {
+        std::cerr << "can not open video " << config.videoPath << ", video decode benchmark skipped." << std::endl;
+        return;
+    }
+    // 与解码线程相同：grab() 解码，retrieve() 转换为BGR并拷贝到槽位；播放到结尾时在计时之外重新打开
+    long frameCount = (long)capture->get(cv::CAP_PROP_FRAME_COUNT);
+    long decoded = 0;
+    cv::Mat frame;
+    runner.run("video decode+convert", config.videoPath + " per frame", [&]() {
+        if (!capture->grab() || !capture->retrieve(frame)) {
+            std::cerr << "video decode failed" << std::endl;
+        }
+        decoded++;
+    }, [&]() {
+        if (frameCount > 0 && decoded >= frameCount - 1) {
+            capture.reset(new cv::VideoCapture(config.videoPath));
+            decoded = 0;
+        }
+    });
+}
+
+void runAnimationBenchmarks(BenchRunner &runner) {
+    const PanoramaRenderer::PanoAnimator animators[] = {PanoramaRenderer::PanoAnimator::ROTATE, PanoramaRenderer::PanoAnimator::SWIPE, PanoramaRenderer::PanoAnimator::SWIPE_ROTATE};
+    const char *names[] = {"rotate", "swipe", "swipe_rotate"};
+    const int samples = 10000;
+    for (int a = 0; a < 3; a++) {
+        AnimationEffect effect = PanoramaRenderer::makeAnimationEffect(animators[a]);
+        float duration = effect.getTotalDuration();
+        char params[64];
+        std::snprintf(params, sizeof(params), "%s %d samples", names[a], samples);
+        float sink = 0.0f;
+        runner.run("animation interpolation", params, [&]() {
+            glm::vec3 position;
+            glm::quat rotation;
+            float fov = 0.0f;
+            for (int i = 0; i < samples; i++) {
+                effect.getInterpolatedParams(duration * i / samples, position, rotation, fov);
+                sink += fov;
+            }
+        });
+        if (sink < 0.0f) std::cerr << sink << std::endl;  // 防止插值被优化掉
+    }
+}
+
+void runCpuRenderBenchmarks(BenchRunner &runner, const BenchConfig &config) {
+    CpuReprojector reprojector;
+    if (!reprojector.setSource(cv::imread(config.imagePath, cv::IMREAD_COLOR))) {
+        std::cerr << "can not load image " << config.imagePath << ", cpu render benchmarks skipped." << std::endl;
+        return;
+    }
+    // 与 --export-workers 的工作线程相同：逐像素重投影，或者按缓存的查找表取像素
+    glm::vec3 position;
+    glm::quat rotation;
+    float fov;
+    PanoramaRenderer::makeAnimationEffect(PanoramaRenderer::PanoAnimator::ROTATE).getInterpolatedParams(1.0f, position, rotation, fov);
+    int width = config.renderWidth, height = config.renderHeight;
+    glm::mat4 projection, view;
+    PanoramaRenderer::getAnimationMatrices(position, rotation, fov, (float)width / height, projection, view);
+    char params[64];
+    std::snprintf(params, sizeof(params), "%dx%d %s", width, height, CpuReprojector::kernelName(reprojector.getKernel()));
+    cv::Mat frame;
+    runner.run("cpu render", params, [&]() {
+        reprojector.render(projection, view, width, height, frame);
+    });
+    std::snprintf(params, sizeof(params), "%dx%d", width, height);
+    runner.run("cpu remap table build", params, [&]() {
+        std::shared_ptr<RemapTable> table = reprojector.buildRemapTable(projection, view, width, height);
+    });
+    RemapCache cache;
+    RemapCache::Key key = RemapCache::makeKey(position, rotation, fov, width, height, reprojector.getSourceWidth(), reprojector.getSourceHeight());
+    runner.run("cpu render cached", params, [&]() {
+        reprojector.renderCached(cache, key, projection, view, width, height, frame);
+    });
+    if (runner.selected("cpu render cached")) {
+        RemapCache::Stats stats = cache.getStats();
+        printf("remap cache: %ld hits, %ld misses, %ld evictions, %.1f MB\n", stats.hits, stats.misses, stats.evictions, stats.bytes / 1048576.0);
+    }
+}
+
+void runGLBenchmarks(BenchRunner &runner, const BenchConfig &config) {
+    // PanoramaRenderer 在上下文创建或图像加载失败时直接退出进程，先检查，失败时只跳过GPU部分，保留CPU的结果
+    if (cv::imread(config.imagePath, cv::IMREAD_COLOR).empty()) {
+        std::cerr << "can not load image " << config.imagePath << ", gpu benchmarks skipped." << std::endl;
+        return;
+    }
+    {
+        GLContext probe;
+        if (!probe.create(config.backend, config.renderWidth, config.renderHeight, "PanoBench")) {
+            std::cerr << "create OpenGL context failed, backend: " << GLContext::backendName(config.backend) << ", gpu benchmarks skipped." << std::endl;
+            return;
+        }
+    }
+    RendererOptions options;
+    options.contextBackend = config.backend;
+    options.viewportWidth = config.renderWidth;
+    options.viewportHeight = config.renderHeight;
+    options.progressiveLoad = false;  // 计时的必须是原图纹理，也不能有后台解码线程争用CPU（hidden/window 后端默认会先显示预览）
+    PanoramaRenderer renderer(config.imagePath, options);
+    runner.addInfo("gl_renderer", (const char *)glGetString(GL_RENDERER));
+    runner.addInfo("gl_version", (const char *)glGetString(GL_VERSION));
+    runner.addInfo("backend", GLContext::backendName(config.backend));
+
+    // 与 updateVideoFrame 相同的上传路径，计时为渲染线程上的耗时
+    cv::VideoCapture capture(config.videoPath);
+    cv::Mat frame;
+    if (capture.isOpened() && capture.read(frame)) {
+        const TextureStreamer::UploadMode modes[] = {TextureStreamer::UploadMode::DIRECT, TextureStreamer::UploadMode::PBO, TextureStreamer::UploadMode::PERSISTENT};
+        for (TextureStreamer::UploadMode mode : modes) {
+            if (!runner.selected("video upload")) break;
+            TextureStreamer streamer;
+            if (!streamer.init(frame.cols, frame.rows, VideoPixelFormat::BGR, mode, 3)) continue;
+            char params[64];
+            std::snprintf(params, sizeof(params), "%dx%d %s", frame.cols, frame.rows, TextureStreamer::modeName(streamer.getMode()));
+            runner.run("video upload", params, [&]() {
+                streamer.upload(frame);
+            });
+            glFinish();
+            streamer.release();
+        }
+    }
+
+    // 各视角和绘制方式：离屏渲染加同步回读，包括等待GPU完成
+    RenderTarget target;
+    FrameReadback readback;
+    if (!target.create(config.renderWidth, config.renderHeight) || !readback.init(config.renderWidth, config.renderHeight, 1)) {
+        std::cerr << "can not create the offscreen target, render benchmarks skipped." << std::endl;
+        return;
+    }
+    const PanoramaRenderer::ViewMode views[] = {PanoramaRenderer::ViewMode::PERSPECTIVE, PanoramaRenderer::ViewMode::LITTLEPLANET, PanoramaRenderer::ViewMode::CRYSTALBALL};
+    const PanoramaRenderMode renderModes[] = {PanoramaRenderMode::MESH, PanoramaRenderMode::RAYCAST};
+    cv::Mat image;
+    for (PanoramaRenderer::ViewMode view : views) {
+        for (PanoramaRenderMode renderMode : renderModes) {
+            char params[64];
+            std::snprintf(params, sizeof(params), "%dx%d %s %s", config.renderWidth, config.renderHeight, viewModeName(view), renderMode == PanoramaRenderMode::MESH ? "mesh" : "raycast");
+            bool ok = true;
+            runner.run("render+readback", params, [&]() {
+                ok = renderer.renderViewOffscreen(view, renderMode, target, readback, image) && ok;
+            });
+            if (!ok) std::cerr << "frame readback failed: " << params << std::endl;
+        }
+    }
+    readback.release();
+    target.release();
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--image" && i + 1 < argc) {
+            config.imagePath = argv[++i];
+        } else if (arg == "--video" && i + 1 < argc) {
+            config.videoPath = argv[++i];
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            config.warmup = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            config.iterations = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--json" && i + 1 < argc) {
+            config.jsonPath = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            config.filter = argv[++i];
+        } else if (arg == "--backend" && i + 1 < argc) {
+            if (!GLContext::parseBackend(argv[++i], config.backend)) {
+                std::cerr << "Invalid backend: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--render-size" && i + 1 < argc) {
+            int w = 0, h = 0;
+            if (sscanf(argv[++i], "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) {
+                std::cerr << "Invalid render size: " << argv[i] << std::endl;
+                return 1;
+            }
+            config.renderWidth = w;
+            config.renderHeight = h;
+        } else if (arg == "--no-gl") {
+            config.gl = false;
+        } else {
+            std::cerr << "Invalid arguments: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    BenchRunner runner(config);
+    runner.addInfo("image", config.imagePath);
+    runner.addInfo("video", config.videoPath);
+    BenchRunner::printHeader();
+    runSphereBenchmarks(runner);
+    runImageBenchmarks(runner, config);
+    runVideoBenchmarks(runner, config);
+    runAnimationBenchmarks(runner);
+    runCpuRenderBenchmarks(runner, config);
+    if (config.gl && (runner.selected("render+readback") || runner.selected("video upload"))) {
+        runGLBenchmarks(runner, config);
+    }
+    if (!config.jsonPath.empty() && !runner.writeJson(config.jsonPath)) {
+        return 1;
+    }
+    return 0;
+}
@@ -64,6 +64,7 @@ GLuint PanoramaRenderer::createProgram(const char *vertexSource, const char *fra
 }
 
 void PanoramaRenderer::initPanoramaRenderer() {
+    // 纹理按图像原始的自上而下行序上传，在这里翻转纵向纹理坐标，省去CPU上的 cv::flip
     const char *vertexShaderSource = R"(
     #version 330 core
     layout(location = 0) in vec3 aPos;
@@ -72,53 +73,110 @@ void PanoramaRenderer::initPanoramaRenderer() {
     uniform mat4 m_projection;
     uniform mat4 m_view;
     void main() {
-        TexCoord = aTexCoord;
+        TexCoord = vec2(aTexCoord.x, 1.0 - aTexCoord.y);
         gl_Position = m_projection * m_view * vec4(aPos, 1.0);
     }
 )";
 
-    const char *fragmentShaderSource = R"(
-    #version 330 core
+    // 两种绘制方式共用的采样函数：BGR 纹理以 GL_BGR 格式上传，采样结果已经是RGB；NV12 视频在这里做YUV到RGB的转换。
+    // 显式传入纹理坐标的屏幕空间导数，光线投射时可以去掉经度接缝处的跳变，避免接缝上选到最小的 mipmap 层；
+    // 虚拟纹理按同样的导数选择页的层级
+    const char *samplingSource = R"(
+    uniform sampler2D texture1;   // RGB 纹理，或 NV12 的Y平面，或虚拟纹理的物理页缓存
+    uniform sampler2D textureUV;  // NV12 的交错UV平面
+    uniform int m_pixelFormat;    // 0: BGR, 1: NV12
+    uniform mat3 m_yuvToRgb;      // 有限范围YUV到RGB的转换矩阵
+    uniform int m_virtualTexture; // 1: texture1 为虚拟纹理的物理页缓存
+    vec4 samplePanorama(vec2 uv, vec2 uvDx, vec2 uvDy) {
+        if (m_virtualTexture == 1) {
+            return sampleVirtual(texture1, uv, uvDx, uvDy);
+        }
+        if (m_pixelFormat == 1) {
+            float y = (textureGrad(texture1, uv, uvDx, uvDy).r - 16.0 / 255.0) * (255.0 / 219.0);
+            vec2 c = (textureGrad(textureUV, uv, uvDx, uvDy).rg - 128.0 / 255.0) * (255.0 / 224.0);
+            return vec4(clamp(m_yuvToRgb * vec3(y, c), 0.0, 1.0), 1.0);
+        }
+        return textureGrad(texture1, uv, uvDx, uvDy);
+    }
+)";
+
+    const char *fragmentShaderMain = R"(
     in vec2 TexCoord;
     out vec4 FragColor;
-    uniform sampler2D texture1;
     void main() {
-        FragColor = texture(texture1, TexCoord);
+        FragColor = samplePanorama(TexCoord, dFdx(TexCoord), dFdy(TexCoord));
     }
 )";
 
-    // 创建着色器程序
-    m_shaderProgram = createProgram(vertexShaderSource, fragmentShaderSource);
-
-    // 生成 VAO 和 VBO
-    glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vboVertices);
-    glGenBuffers(1, &m_vboIndices);
-    glGenBuffers(1, &m_vboTexCoords);
-
-    // 绑定 VAO
-    glBindVertexArray(m_vao);
-
-    // 顶点数据
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboVertices);
-    glBufferData(GL_ARRAY_BUFFER, m_sphereData->getNumVertices() * sizeof(GLfloat), m_sphereData->getVertices(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), nullptr);
-    glEnableVertexAttribArray(0);
+    // 光线投射：一个覆盖全屏的三角形，不需要顶点属性，顶点位置由 gl_VertexID 生成
+    const char *raycastVertexSource = R"(
+    #version 330 core
+    out vec2 NdcPos;
+    void main() {
+        // 三个顶点 (-1,-1) (3,-1) (-1,3)，裁剪后正好是整个屏幕
+        NdcPos = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+        gl_Position = vec4(NdcPos, 0.0, 1.0);
+    }
+)";
 
-    // 纹理坐标数据
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboTexCoords);
-    glBufferData(GL_ARRAY_BUFFER, m_sphereData->getNumTexs() * sizeof(GLfloat), m_sphereData->getTexCoords(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), nullptr);
-    glEnableVertexAttribArray(1);
+    // 由逆投影视图矩阵求每个像素的视线，与单位球求交后解析地计算经纬度。相机位置与网格绘制相同，
+    // 因此透视（球心）、小行星（球面上，即球极投影）和水晶球（球外）三种视角都由同一个公式得到
+    const char *raycastFragmentMain = R"(
+    in vec2 NdcPos;
+    out vec4 FragColor;
+    uniform mat4 m_invViewProj;
+    uniform vec3 m_eye;
+    const float PI = 3.14159265358979;
+    void main() {
+        vec4 nearPoint = m_invViewProj * vec4(NdcPos, -1.0, 1.0);
+        vec4 farPoint = m_invViewProj * vec4(NdcPos, 1.0, 1.0);
+        vec3 dir = normalize(farPoint.xyz / farPoint.w - nearPoint.xyz / nearPoint.w);
+
+        // |eye + t*dir| = 1，相机在球外时取较近的交点，与网格绘制的深度测试一致
+        float b = dot(m_eye, dir);
+        float disc = b * b - (dot(m_eye, m_eye) - 1.0);
+        float s = sqrt(max(disc, 0.0));
+        float t = -b - s;
+        if (t <= 1e-4) t = -b + s;
+        bool hit = disc >= 0.0 && t > 1e-4;
+        vec3 p = m_eye + max(t, 0.0) * dir;
+
+        // 与 SphereData 的参数化一致：经度 u = atan(z, x) / 2π，纬度从北极（图像第0行）开始 v = acos(y) / π
+        vec2 uv = vec2(fract(atan(p.z, p.x) / (2.0 * PI)), acos(clamp(p.y, -1.0, 1.0)) / PI);
+        // 导数在 discard 之前计算（保持一致的控制流），经度跨过接缝时的 ±1 跳变去掉
+        vec2 uvDx = dFdx(uv);
+        vec2 uvDy = dFdy(uv);
+        uvDx.x -= floor(uvDx.x + 0.5);
+        uvDy.x -= floor(uvDy.x + 0.5);
+        if (!hit) discard;
+        FragColor = samplePanorama(uv, uvDx, uvDy);
+    }
+)";
 
-    // 索引数据
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vboIndices);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_sphereData->getNumIndices() * sizeof(GLushort), m_sphereData->getIndices(), GL_STATIC_DRAW);
+    // 创建着色器程序
+    const std::string version = "#version 330 core\n";
+    std::string fragmentShaderSource = version + VirtualTexture::getShaderSource() + samplingSource + fragmentShaderMain;
+    std::string raycastFragmentSource = version + VirtualTexture::getShaderSource() + samplingSource + raycastFragmentMain;
+    m_shaderProgram = createProgram(vertexShaderSource, fragmentShaderSource.c_str());
+    resolveUniforms(m_shaderProgram, m_uniforms);
+    m_raycastProgram = createProgram(raycastVertexSource, raycastFragmentSource.c_str());
+    resolveUniforms(m_raycastProgram, m_raycastUniforms);
+    glGenVertexArrays(1, &m_raycastVao);  // 核心模式下绘制必须绑定一个VAO，即使没有顶点属性
+    m_gpuTimer.init(&m_profiler);
+    if (m_window) {
+        m_hud.init(createProgram(ProfilerHud::getVertexSource(), ProfilerHud::getFragmentSource()));
+    }
 
-    // 解绑 VAO
-    glBindVertexArray(0);
+    // 最粗的球体网格级别提前生成，更细的级别在缩放到需要时才生成
+    m_sphereMeshes.setIndexOrder(m_options.sphereIndexOrder);
+    m_sphereMeshes.setReport(m_options.printGLStats);
+    m_sphereMeshes.build(0);
+    // 三角形带用索引类型的最大值分隔。重启索引的默认值是0，启用后必须立即设置，否则三角形列表中的0号顶点也会被当作重启
+    glEnable(GL_PRIMITIVE_RESTART);
+    m_glState.primitiveRestartIndex(m_sphereMeshes.getMesh(0).restartIndex);
 }
 
+#ifdef PANO_LEGACY_GL
 // 绘制球体，该函数是传统的立即模式渲染函数glBegin/glEnd，现代OpenGL中不推荐使用
 void PanoramaRenderer::renderSphere(float radius, int slices, int stacks) {
     for (int i = 0; i < stacks; ++i) {
@@ -143,6 +201,14 @@ void PanoramaRenderer::renderSphere(float radius, int slices, int stacks) {
     }
 }
 
+void PanoramaRenderer::loadLegacyMatrices(const glm::mat4 &projection, const glm::mat4 &view) {
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(glm::value_ptr(projection));
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(glm::value_ptr(view));
+}
+#endif
+
 // 处理用户输入
 void PanoramaRenderer::processInput() {
     if (glfwGetKey(m_window, GLFW_KEY_W) == GLFW_PRESS) m_pitch += 0.5f;
@@ -176,155 +242,15 @@ void PanoramaRenderer::processInput() {
         m_fov = 85.0f;
     }
 
-    // 加入键盘快捷键，保存导出的全景照片动画师效果,但不影响主线程运行
-    if (glfwGetKey(m_window, GLFW_KEY_P) == GLFW_PRESS) {
-        double t1 = cv::getTickCount();
-        exportAnimationEffect("panoAnimator.mp4", 1920, 1080, 30);
-        // startExportAnimationEffect("panoAnimator.mp4", 1920, 1080, 30); // 多线程导出还存在一些bug
-        printf("it take time:%f seconds.\n", (cv::getTickCount() - t1) / cv::getTickFrequency());
-    }
-
     // 处理全景照片动画师功能
     if (m_panoMode == SwitchMode::PANORAMAIMAGE)  // 照片动画师功能
     {
         if (glfwGetKey(m_window, GLFW_KEY_F1) == GLFW_PRESS) {
-            // 启动第一种动画效果，360度四周变化
-            m_animationTime = 0.0f;  // 重置动画时间
-
-            m_panoAnimator = PanoramaRenderer::PanoAnimator::ROTATE;
-
-            // 创建一个6节点、5个阶段的动画效果
-            glm::vec3 eulerAngles0(0.0f, glm::radians(0.0f), 0.0f);  // 0度绕X, 0度绕Y, 0度绕Z
-            glm::quat rotationQuaternion0(eulerAngles0);             // 创建旋转四元数
-
-            glm::vec3 eulerAngles1(0.0f, glm::radians(180.0f), 0.0f);  // 旋转180度绕Y轴
-            glm::quat rotationQuaternion1(eulerAngles1);               // 创建旋转四元数
-
-            glm::vec3 eulerAngles2(0.0f, glm::radians(360.0f), 0.0f);  // 旋转360度绕Y轴
-            glm::quat rotationQuaternion2(eulerAngles2);               // 创建旋转四元数
-
-            glm::vec3 eulerAngles3(-glm::radians(45.0f), glm::radians(180.0f), 0.0f);
-            glm::quat rotationQuaternion3(eulerAngles3);  // 创建旋转四元数
-
-            glm::vec3 eulerAngles4(-glm::radians(90.0f), glm::radians(360.0f), 0.0f);
-            glm::quat rotationQuaternion4(eulerAngles4);  // 创建旋转四元数
-
-            glm::vec3 eulerAngles5(0.0f, glm::radians(0.0f), 0.0f);  // 回到起始点
-            glm::quat rotationQuaternion5(eulerAngles5);             // 创建旋转四元数
-
-            m_animationEffect.CameraPosNodes = {
-                // 节点的相机位置
-                glm::vec3(0.0f, 0.0f, 0.0f),  // 第1个节点
-                glm::vec3(0.0f, 0.0f, 0.0f),  // 第2个节点
-                glm::vec3(0.0f, 0.0f, 0.0f),  // 第3个节点
-                glm::vec3(0.0f, 0.5f, 0.0f),  // 第4个节点
-                glm::vec3(0.0f, 1.0f, 0.0f),  // 第5个节点
-                glm::vec3(0.0f, 0.0f, 0.0f)   // 第6个节点
-            };
-
-            m_animationEffect.CameraRotNodes = {
-                // 节点的相机朝向四元数
-                rotationQuaternion0,  // 第1个节点的旋转
-                rotationQuaternion1,  // 第2个节点的旋转
-                rotationQuaternion2,  // 第3个节点的旋转
-                rotationQuaternion3,  // 第4个节点的旋转
-                rotationQuaternion4,  // 第5个节点的旋转
-                rotationQuaternion5   // 第6个节点的旋转
-            };
-
-            m_animationEffect.FovNodes = {                                             // 节点的FOV
-                                          60.0f, 60.0f, 60.0f, 90.0f, 120.0f, 60.0f};  // FOV值为60, 60, 120, 60度
-
-            m_animationEffect.stagesDuration = {                                // 每个阶段的时长
-                                                4.0f, 4.0f, 1.0f, 1.0f, 1.0f};  // 阶段1：10秒，阶段2：2秒，阶段3：3秒
+            setPanoAnimator(PanoramaRenderer::PanoAnimator::ROTATE);
         } else if (glfwGetKey(m_window, GLFW_KEY_F2) == GLFW_PRESS) {
-            // 启动第二种动画效果，地变天视图
-            m_animationTime = 0.0f;  // 重置动画时间
-
-            m_panoAnimator = PanoramaRenderer::PanoAnimator::SWIPE;
-
-            // 创建一个4节点、3个阶段的动画效果
-            glm::vec3 eulerAngles0(-glm::radians(90.0f), glm::radians(0.0f), 0.0f);  // 0度绕X, 0度绕Y, 0度绕Z
-            glm::quat rotationQuaternion0(eulerAngles0);                             // 创建旋转四元数
-
-            glm::vec3 eulerAngles1(0.0f, glm::radians(180.0f), 0.0f);  // 旋转90度绕Y轴
-            glm::quat rotationQuaternion1(eulerAngles1);               // 创建旋转四元数
-
-            glm::vec3 eulerAngles2(glm::radians(90.0f), glm::radians(360.0f), 0.0f);  // 旋转360度绕Y轴
-            glm::quat rotationQuaternion2(eulerAngles2);                              // 创建旋转四元数
-
-            glm::vec3 eulerAngles3(0.0f, glm::radians(0.0f), 0.0f);  // 旋转270度绕Y轴
-            glm::quat rotationQuaternion3(eulerAngles3);             // 创建旋转四元数
-
-            m_animationEffect.CameraPosNodes = {
-                // 节点的相机位置
-                glm::vec3(0.0f, 1.0f, 0.0f),   // 第1个节点
-                glm::vec3(0.0f, 0.0f, 0.0f),   // 第2个节点
-                glm::vec3(0.0f, -1.0f, 0.0f),  // 第3个节点
-                glm::vec3(0.0f, 0.0f, 0.0f)    // 第4个节点
-            };
-
-            m_animationEffect.CameraRotNodes = {
-                // 节点的相机朝向四元数
-
-                rotationQuaternion0,  // 第1个节点的旋转
-                rotationQuaternion1,  // 第2个节点的旋转
-                rotationQuaternion2,  // 第3个节点的旋转
-                rotationQuaternion3   // 第4个节点的旋转
-            };
-
-            m_animationEffect.FovNodes = {                                // 节点的FOV
-                                          120.0f, 60.0f, 120.0f, 80.0f};  // FOV值为60, 60, 120, 60度
-
-            m_animationEffect.stagesDuration = {                    // 每个阶段的时长
-                                                5.0f, 2.0f, 2.0f};  // 阶段1：10秒，阶段2：2秒，阶段3：3秒
-
+            setPanoAnimator(PanoramaRenderer::PanoAnimator::SWIPE);
         } else if (glfwGetKey(m_window, GLFW_KEY_F3) == GLFW_PRESS) {
-            // 启动第三种动画效果,天变地视图
-            m_animationTime = 0.0f;  // 重置动画时间
-
-            m_panoAnimator = PanoramaRenderer::PanoAnimator::SWIPE_ROTATE;
-
-            // 创建一个4节点、3个阶段的动画效果
-            glm::vec3 eulerAngles0(glm::radians(90.0f), glm::radians(0.0f), 0.0f);  // 0度绕X, 90度绕Y, 0度绕Z
-            glm::quat rotationQuaternion0(eulerAngles0);                            // 创建旋转四元数
-
-            glm::vec3 eulerAngles1(glm::radians(90.0f), glm::radians(0.0f), 0.0f);  //
-            glm::quat rotationQuaternion1(eulerAngles1);                            // 创建旋转四元数
-
-            glm::vec3 eulerAngles2(0.0f, glm::radians(180.0f), 0.0f);  // 旋转90度绕Y轴
-            glm::quat rotationQuaternion2(eulerAngles2);               // 创建旋转四元数
-
-            glm::vec3 eulerAngles3(-glm::radians(90.0f), glm::radians(360.0f), 0.0f);  //
-            glm::quat rotationQuaternion3(eulerAngles3);                               // 创建旋转四元数
-
-            glm::vec3 eulerAngles4(0.0f, glm::radians(0.0f), 0.0f);  //
-            glm::quat rotationQuaternion4(eulerAngles4);             // 创建旋转四元数
-
-            m_animationEffect.CameraPosNodes = {
-                // 节点的相机位置
-                glm::vec3(0.0f, -1.0f, 0.0f),  // 第1个节点
-                glm::vec3(0.0f, -1.0f, 0.0f),  // 第2个节点
-                glm::vec3(0.0f, 0.0f, 0.0f),   // 第3个节点
-                glm::vec3(0.0f, 1.0f, 0.0f),   // 第4个节点
-                glm::vec3(0.0f, 0.0f, 0.0f)    // 第5个节点
-            };
-
-            m_animationEffect.CameraRotNodes = {
-                // 节点的相机朝向四元数
-
-                rotationQuaternion0,  // 第1个节点的旋转
-                rotationQuaternion1,  // 第2个节点的旋转
-                rotationQuaternion2,  // 第3个节点的旋转
-                rotationQuaternion3,  // 第4个节点的旋转
-                rotationQuaternion4   // 第5个节点的旋转
-            };
-
-            m_animationEffect.FovNodes = {                                        // 节点的FOV
-                                          120.0f, 110.0f, 60.0f, 120.0f, 60.0f};  // FOV值为120, 110, 60, 60, 120, 60度
-
-            m_animationEffect.stagesDuration = {                          // 每个阶段的时长
-                                                1.5f, 3.0f, 2.0f, 2.0f};  // 阶段1：10秒，阶段2：2秒，阶段3：3秒
+            setPanoAnimator(PanoramaRenderer::PanoAnimator::SWIPE_ROTATE);
         }
     }
 
@@ -335,6 +261,145 @@ void PanoramaRenderer::processInput() {
     m_yaw = glm::mod(m_yaw, 360.0f);
 }
 
+// 设置照片动画师效果，交互时由 F1/F2/F3 键触发，无窗口导出时直接调用
+void PanoramaRenderer::setPanoAnimator(PanoAnimator animator) {
+    m_animationTime = 0.0f;  // 重置动画时间
+    m_lastFrameTime = (float)cv::getTickCount();  // 按需渲染时上一帧可能是很久以前
+    m_panoAnimator = animator;
+    m_animationEffect = makeAnimationEffect(animator);
+}
+
+AnimationEffect PanoramaRenderer::makeAnimationEffect(PanoAnimator animator) {
+    AnimationEffect effect;
+    if (animator == PanoramaRenderer::PanoAnimator::ROTATE) {
+        // 启动第一种动画效果，360度四周变化
+        // 创建一个6节点、5个阶段的动画效果
+        glm::vec3 eulerAngles0(0.0f, glm::radians(0.0f), 0.0f);  // 0度绕X, 0度绕Y, 0度绕Z
+        glm::quat rotationQuaternion0(eulerAngles0);             // 创建旋转四元数
+
+        glm::vec3 eulerAngles1(0.0f, glm::radians(180.0f), 0.0f);  // 旋转180度绕Y轴
+        glm::quat rotationQuaternion1(eulerAngles1);               // 创建旋转四元数
+
+        glm::vec3 eulerAngles2(0.0f, glm::radians(360.0f), 0.0f);  // 旋转360度绕Y轴
+        glm::quat rotationQuaternion2(eulerAngles2);               // 创建旋转四元数
+
+        glm::vec3 eulerAngles3(-glm::radians(45.0f), glm::radians(180.0f), 0.0f);
+        glm::quat rotationQuaternion3(eulerAngles3);  // 创建旋转四元数
+
+        glm::vec3 eulerAngles4(-glm::radians(90.0f), glm::radians(360.0f), 0.0f);
+        glm::quat rotationQuaternion4(eulerAngles4);  // 创建旋转四元数
+
+        glm::vec3 eulerAngles5(0.0f, glm::radians(0.0f), 0.0f);  // 回到起始点
+        glm::quat rotationQuaternion5(eulerAngles5);             // 创建旋转四元数
+
+        effect.CameraPosNodes = {
+            // 节点的相机位置
+            glm::vec3(0.0f, 0.0f, 0.0f),  // 第1个节点
+            glm::vec3(0.0f, 0.0f, 0.0f),  // 第2个节点
+            glm::vec3(0.0f, 0.0f, 0.0f),  // 第3个节点
+            glm::vec3(0.0f, 0.5f, 0.0f),  // 第4个节点
+            glm::vec3(0.0f, 1.0f, 0.0f),  // 第5个节点
+            glm::vec3(0.0f, 0.0f, 0.0f)   // 第6个节点
+        };
+
+        effect.CameraRotNodes = {
+            // 节点的相机朝向四元数
+            rotationQuaternion0,  // 第1个节点的旋转
+            rotationQuaternion1,  // 第2个节点的旋转
+            rotationQuaternion2,  // 第3个节点的旋转
+            rotationQuaternion3,  // 第4个节点的旋转
+            rotationQuaternion4,  // 第5个节点的旋转
+            rotationQuaternion5   // 第6个节点的旋转
+        };
+
+        effect.FovNodes = {                                  // 节点的FOV
+                           60.0f, 60.0f, 60.0f, 90.0f, 120.0f, 60.0f};  // FOV值为60, 60, 120, 60度
+
+        effect.stagesDuration = {                     // 每个阶段的时长
+                                 4.0f, 4.0f, 1.0f, 1.0f, 1.0f};  // 阶段1：10秒，阶段2：2秒，阶段3：3秒
+    } else if (animator == PanoramaRenderer::PanoAnimator::SWIPE) {
+        // 启动第二种动画效果，地变天视图
+        // 创建一个4节点、3个阶段的动画效果
+        glm::vec3 eulerAngles0(-glm::radians(90.0f), glm::radians(0.0f), 0.0f);  // 0度绕X, 0度绕Y, 0度绕Z
+        glm::quat rotationQuaternion0(eulerAngles0);                             // 创建旋转四元数
+
+        glm::vec3 eulerAngles1(0.0f, glm::radians(180.0f), 0.0f);  // 旋转90度绕Y轴
+        glm::quat rotationQuaternion1(eulerAngles1);               // 创建旋转四元数
+
+        glm::vec3 eulerAngles2(glm::radians(90.0f), glm::radians(360.0f), 0.0f);  // 旋转360度绕Y轴
+        glm::quat rotationQuaternion2(eulerAngles2);                              // 创建旋转四元数
+
+        glm::vec3 eulerAngles3(0.0f, glm::radians(0.0f), 0.0f);  // 旋转270度绕Y轴
+        glm::quat rotationQuaternion3(eulerAngles3);             // 创建旋转四元数
+
+        effect.CameraPosNodes = {
+            // 节点的相机位置
+            glm::vec3(0.0f, 1.0f, 0.0f),   // 第1个节点
+            glm::vec3(0.0f, 0.0f, 0.0f),   // 第2个节点
+            glm::vec3(0.0f, -1.0f, 0.0f),  // 第3个节点
+            glm::vec3(0.0f, 0.0f, 0.0f)    // 第4个节点
+        };
+
+        effect.CameraRotNodes = {
+            // 节点的相机朝向四元数
+
+            rotationQuaternion0,  // 第1个节点的旋转
+            rotationQuaternion1,  // 第2个节点的旋转
+            rotationQuaternion2,  // 第3个节点的旋转
+            rotationQuaternion3   // 第4个节点的旋转
+        };
+
+        effect.FovNodes = {                     // 节点的FOV
+                           120.0f, 60.0f, 120.0f, 80.0f};  // FOV值为60, 60, 120, 60度
+
+        effect.stagesDuration = {         // 每个阶段的时长
+                                 5.0f, 2.0f, 2.0f};  // 阶段1：10秒，阶段2：2秒，阶段3：3秒
+    } else if (animator == PanoramaRenderer::PanoAnimator::SWIPE_ROTATE) {
+        // 启动第三种动画效果,天变地视图
+        // 创建一个4节点、3个阶段的动画效果
+        glm::vec3 eulerAngles0(glm::radians(90.0f), glm::radians(0.0f), 0.0f);  // 0度绕X, 90度绕Y, 0度绕Z
+        glm::quat rotationQuaternion0(eulerAngles0);                            // 创建旋转四元数
+
+        glm::vec3 eulerAngles1(glm::radians(90.0f), glm::radians(0.0f), 0.0f);  //
+        glm::quat rotationQuaternion1(eulerAngles1);                            // 创建旋转四元数
+
+        glm::vec3 eulerAngles2(0.0f, glm::radians(180.0f), 0.0f);  // 旋转90度绕Y轴
+        glm::quat rotationQuaternion2(eulerAngles2);               // 创建旋转四元数
+
+        glm::vec3 eulerAngles3(-glm::radians(90.0f), glm::radians(360.0f), 0.0f);  //
+        glm::quat rotationQuaternion3(eulerAngles3);                               // 创建旋转四元数
+
+        glm::vec3 eulerAngles4(0.0f, glm::radians(0.0f), 0.0f);  //
+        glm::quat rotationQuaternion4(eulerAngles4);             // 创建旋转四元数
+
+        effect.CameraPosNodes = {
+            // 节点的相机位置
+            glm::vec3(0.0f, -1.0f, 0.0f),  // 第1个节点
+            glm::vec3(0.0f, -1.0f, 0.0f),  // 第2个节点
+            glm::vec3(0.0f, 0.0f, 0.0f),   // 第3个节点
+            glm::vec3(0.0f, 1.0f, 0.0f),   // 第4个节点
+            glm::vec3(0.0f, 0.0f, 0.0f)    // 第5个节点
+        };
+
+        effect.CameraRotNodes = {
+            // 节点的相机朝向四元数
+
+            rotationQuaternion0,  // 第1个节点的旋转
+            rotationQuaternion1,  // 第2个节点的旋转
+            rotationQuaternion2,  // 第3个节点的旋转
+            rotationQuaternion3,  // 第4个节点的旋转
+            rotationQuaternion4   // 第5个节点的旋转
+        };
+
+        effect.FovNodes = {                             // 节点的FOV
+                           120.0f, 110.0f, 60.0f, 120.0f, 60.0f};  // FOV值为120, 110, 60, 60, 120, 60度
+
+        effect.stagesDuration = {               // 每个阶段的时长
+                                 1.5f, 3.0f, 2.0f, 2.0f};  // 阶段1：10秒，阶段2：2秒，阶段3：3秒
+    }
+    return effect;
+}
+
 bool PanoramaRenderer::hasDivisibleNode(float previousPitch, float m_pitch) {
     // 确保 previousPitch 小于 m_pitch
     if (previousPitch > m_pitch) std::swap(previousPitch, m_pitch);
@@ -350,6 +415,13 @@ bool PanoramaRenderer::hasDivisibleNode(float previousPitch, float m_pitch) {
     return start > lowerBound && start < upperBound;
 }
 
+// 透视视角：相机位于球心，朝向由偏航和俯仰角决定
+void PanoramaRenderer::getPerspectiveMatrices(float fov, float yaw, float pitch, float aspect, glm::mat4 &projection, glm::mat4 &view) {
+    projection = glm::perspective(glm::radians(fov), aspect, 0.1f, 100.0f);
+    glm::vec3 direction(sin(glm::radians(yaw)) * cos(glm::radians(pitch)), sin(glm::radians(pitch)), cos(glm::radians(yaw)) * cos(glm::radians(pitch)));
+    view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), direction, glm::vec3(0, 1, 0));
+}
+
 // 根据手动交互得到的m_pitch,m_yaw得到视图矩阵
 void PanoramaRenderer::getViewMatrixForStatic(glm::mat4 &projection, glm::mat4 &view) {
     static glm::vec3 upCamera = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -360,9 +432,7 @@ void PanoramaRenderer::getViewMatrixForStatic(glm::mat4 &projection, glm::mat4 &
     glm::vec3 movingPosition(sin(glm::radians(m_yaw)) * cos(glm::radians(m_pitch)), sin(glm::radians(m_pitch)), cos(glm::radians(m_yaw)) * cos(glm::radians(m_pitch)));  // 移动视角位置
     glm::vec3 cameraPosition;
     if (m_viewOrientation == PanoramaRenderer::ViewMode::PERSPECTIVE) {
-        cameraPosition = glm::vec3(0.0f, 0.0f, 0.0f);
-        view = glm::lookAt(cameraPosition, movingPosition,
-                           glm::vec3(0, 1, 0));
+        getPerspectiveMatrices(m_fov, m_yaw, m_pitch, (float)m_widthScreen / m_heightScreen, projection, view);
     } else if (m_viewOrientation == PanoramaRenderer::ViewMode::LITTLEPLANET) {
         cameraPosition = movingPosition;  // 在单位球表面
 
@@ -381,17 +451,12 @@ void PanoramaRenderer::getViewMatrixForStatic(glm::mat4 &projection, glm::mat4 &
 
         m_prevPitch = m_pitch;
     }
-
-    glMatrixMode(GL_PROJECTION);
-    glLoadMatrixf(glm::value_ptr(projection));
-    glMatrixMode(GL_MODELVIEW);
-    glLoadMatrixf(glm::value_ptr(view));
 }
 
-// 获取动态视图矩阵,照片动画师功能
-void PanoramaRenderer::getViewMatrixForAnimation(glm::vec3 cameraPos, glm::quat cameraRot, float fov, glm::mat4 &projection, glm::mat4 &view) {
+// 由相机位置、朝向和fov计算投影和视图矩阵
+void PanoramaRenderer::getAnimationMatrices(glm::vec3 cameraPos, glm::quat cameraRot, float fov, float aspect, glm::mat4 &projection, glm::mat4 &view) {
     // 计算投影矩阵
-    projection = glm::perspective(glm::radians(fov), (float)m_widthScreen / m_heightScreen, 0.1f, 100.0f);
+    projection = glm::perspective(glm::radians(fov), aspect, 0.1f, 100.0f);
 
     // 计算视图矩阵
     // 获取相机的前向、右向和上向向量
@@ -402,50 +467,164 @@ void PanoramaRenderer::getViewMatrixForAnimation(glm::vec3 cameraPos, glm::quat
     // 视图矩阵：使用 lookAt 来创建视图矩阵
     glm::vec3 target = cameraPos + forward;     // 目标点是当前相机位置加上朝向向量
     view = glm::lookAt(cameraPos, target, up);  // 计算视图矩阵
+}
 
-    // 将视图矩阵应用于OpenGL
-    glMatrixMode(GL_PROJECTION);
-    glLoadMatrixf(glm::value_ptr(projection));
-    glMatrixMode(GL_MODELVIEW);
-    glLoadMatrixf(glm::value_ptr(view));
+// 获取动态视图矩阵,照片动画师功能
+void PanoramaRenderer::getViewMatrixForAnimation(glm::vec3 cameraPos, glm::quat cameraRot, float fov, float aspect, glm::mat4 &projection, glm::mat4 &view) {
+    getAnimationMatrices(cameraPos, cameraRot, fov, aspect, projection, view);
+}
+
+void PanoramaRenderer::resolveUniforms(GLuint program, ShaderUniforms &uniforms) {
+    uniforms.projection = glGetUniformLocation(program, "m_projection");
+    uniforms.view = glGetUniformLocation(program, "m_view");
+    uniforms.invViewProj = glGetUniformLocation(program, "m_invViewProj");
+    uniforms.eye = glGetUniformLocation(program, "m_eye");
+    uniforms.texture1 = glGetUniformLocation(program, "texture1");
+    uniforms.textureUV = glGetUniformLocation(program, "textureUV");
+    uniforms.pixelFormat = glGetUniformLocation(program, "m_pixelFormat");
+    uniforms.yuvToRgb = glGetUniformLocation(program, "m_yuvToRgb");
+    uniforms.virtualTexture = glGetUniformLocation(program, "m_virtualTexture");
 }
 
-void PanoramaRenderer::renderPanorama(SphereData *sphereData, glm::mat4 projection, glm::mat4 view) {
-    glUseProgram(m_shaderProgram);
+void PanoramaRenderer::updateFormatUniforms() {
+    // 高清视频按 BT.709，标清按 BT.601，矩阵按列存放：Y、U、V 三列的系数
+    static const glm::mat3 bt709(1.0f, 1.0f, 1.0f, 0.0f, -0.1873f, 1.8556f, 1.5748f, -0.4681f, 0.0f);
+    static const glm::mat3 bt601(1.0f, 1.0f, 1.0f, 0.0f, -0.3441f, 1.772f, 1.402f, -0.7141f, 0.0f);
+    const std::pair<GLuint, const ShaderUniforms *> programs[] = {{m_shaderProgram, &m_uniforms}, {m_raycastProgram, &m_raycastUniforms}};
+    for (const auto &program : programs) {
+        const ShaderUniforms &uniforms = *program.second;
+        m_glState.useProgram(program.first);
+        // 纹理单元固定：0 为RGB纹理或Y平面，1 为UV平面
+        glUniform1i(uniforms.texture1, 0);
+        glUniform1i(uniforms.textureUV, 1);
+        glUniform1i(uniforms.pixelFormat, m_pixelFormat == VideoPixelFormat::NV12 ? 1 : 0);
+        glUniform1i(uniforms.virtualTexture, m_useVirtualTexture ? 1 : 0);
+        // 页表是整数采样器，不使用虚拟纹理时也要指向单独的单元，不能与 texture1 同在单元0
+        m_virtualTexture.applyUniforms(program.first);
+        if (m_pixelFormat == VideoPixelFormat::NV12) {
+            glUniformMatrix3fv(uniforms.yuvToRgb, 1, GL_FALSE, glm::value_ptr(m_videoDecoder.getHeight() >= 720 ? bt709 : bt601));
+        }
+    }
+}
 
-    // 设置 uniform 矩阵
-    GLuint projLoc = glGetUniformLocation(m_shaderProgram, "m_projection");
-    GLuint viewLoc = glGetUniformLocation(m_shaderProgram, "m_view");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+bool PanoramaRenderer::updateVirtualTexture(const glm::mat4 &projection, const glm::mat4 &view, int viewportWidth, int viewportHeight, bool complete) {
+    if (!m_useVirtualTexture) return false;
+    ScopedStageTimer timer(&m_profiler, FrameProfiler::VIRTUAL_TEXTURE);
+    ScopedGpuTimer gpuTimer(m_gpuTimer, FrameProfiler::GPU_VIRTUAL_TEXTURE);
+    bool pending = m_virtualTexture.update(projection, view, viewportWidth, viewportHeight, complete, m_options.virtualTextureUploads);
+    m_glState.invalidate();  // 反馈绘制和页上传绕过了绑定缓存
+    return pending;
+}
 
-    // 绑定纹理
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_texture);
-    glUniform1i(glGetUniformLocation(m_shaderProgram, "texture1"), 0);
+void PanoramaRenderer::renderPanorama(glm::mat4 projection, glm::mat4 view, int viewportHeight) {
+    m_glState.bindTexture2D(0, m_texture);
+    if (m_pixelFormat == VideoPixelFormat::NV12) {
+        m_glState.bindTexture2D(1, m_textureUV);
+    }
+    if (m_useVirtualTexture) {
+        m_glState.bindTexture2D(VirtualTexture::PAGE_TABLE_UNIT, m_virtualTexture.getPageTableTexture());
+    }
 
-    // 绘制球体
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, sphereData->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    glBindVertexArray(0);
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    // 程序、纹理和VAO没有变化时不会重复绑定，绘制后也不再解绑；采样器等不变的 uniform 已在初始化时设置
+    if (m_renderMode == PanoramaRenderMode::RAYCAST) {
+        glm::mat4 invViewProj = glm::inverse(projection * view);
+        m_glState.useProgram(m_raycastProgram);
+        glUniformMatrix4fv(m_raycastUniforms.invViewProj, 1, GL_FALSE, glm::value_ptr(invViewProj));
+        glUniform3fv(m_raycastUniforms.eye, 1, glm::value_ptr(eye));
+        m_glState.bindVertexArray(m_raycastVao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    } else {
+        m_glState.useProgram(m_shaderProgram);
+        glUniformMatrix4fv(m_uniforms.projection, 1, GL_FALSE, glm::value_ptr(projection));
+        glUniformMatrix4fv(m_uniforms.view, 1, GL_FALSE, glm::value_ptr(view));
+        // 按视场角选择球体网格的细节级别，垂直视场角由投影矩阵还原；新生成的级别绕过了绑定缓存，需要让缓存失效
+        float fovY = 2.0f * atan(1.0f / projection[1][1]);
+        int level = SphereMeshCache::selectLevel(fovY, viewportHeight, glm::length(eye));
+        if (!m_sphereMeshes.isBuilt(level)) {
+            m_sphereMeshes.build(level);
+            m_glState.invalidate();
+        }
+        // 绘制球体
+        const SphereMeshCache::Mesh &mesh = m_sphereMeshes.getMesh(level);
+        m_glState.bindVertexArray(mesh.vao);
+        // 各级别的索引类型可能不同，重启索引要跟着变；三角形列表中不会出现索引类型的最大值
+        m_glState.primitiveRestartIndex(mesh.restartIndex);
+        glDrawElements(mesh.primitiveType, mesh.numIndices, mesh.indexType, 0);
+    }
+    m_glState.countCalls(3);
+}
 
-    glUseProgram(0);
+void PanoramaRenderer::reportGLStats() {
+    double now = cv::getTickCount() / cv::getTickFrequency();
+    if (now - m_lastGLStatsTime < 2.0) return;
+
+    const GLStateCache::Stats &stats = m_glState.getStats();
+    printf("[gl] %.1f calls/frame, %.1f redundant binds skipped/frame (%ld frames)\n", stats.callsPerFrame(), stats.skippedPerFrame(), stats.frames);
+    m_glState.resetStats();
+    if (m_useVirtualTexture) {
+        const VirtualTexture::Stats &vt = m_virtualTexture.getStats();
+        printf("[vt] %.1f tiles requested/frame, %ld uploads, %d/%d slots resident (%ld frames)\n", vt.frames > 0 ? (double)vt.requested / vt.frames : 0.0, vt.uploads, vt.resident, vt.capacity, vt.frames);
+        m_virtualTexture.resetStats();
+    }
+    m_lastGLStatsTime = now;
 }
 
 // 渲染循环
 void PanoramaRenderer::renderLoop() {
+    if (m_context.isHeadless()) {
+        std::cerr << "renderLoop needs a window, backend " << GLContext::backendName(m_context.getBackend()) << " is headless." << std::endl;
+        return;
+    }
+    double loopStart = cv::getTickCount();
+    bool rendered = true;
+    m_needsRedraw = true;
+    m_iconified = glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) != 0;
     while (!glfwWindowShouldClose(m_window)) {
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // step0, 等待事件：上一轮没有绘制且没有需要推进的工作时阻塞，直到有输入事件或到期
+        {
+            TraceScope trace("wait events");
+            waitForEvents(rendered);
+        }
+        rendered = false;
+        if (m_iconified) {
+            // 最小化时不解码上传、不绘制，恢复时窗口刷新回调会要求重绘
+            m_loopStats.hidden++;
+            reportLoopStats();
+            continue;
+        }
+        double frameStart = cv::getTickCount();
+        m_gpuTimer.beginFrame();
 
         // step1, 处理用户输入
-        processInput();
+        {
+            ScopedStageTimer timer(&m_profiler, FrameProfiler::INPUT);
+            processInput();
+        }
         if (m_panoMode == SwitchMode::PANORAMAVIDEO) {
-            updateVideoFrame();
+            m_needsRedraw |= updateVideoFrame();
+        } else {
+            m_needsRedraw |= updateProgressiveLoad(false);
         }
 
+        // 按需渲染：相机、显示方式都没有变化，也没有新的视频帧、纹理和动画时跳过这一帧
+        DrawnState state = captureDrawnState();
+        if (m_options.renderOnDemand && !m_needsRedraw && !isAnimating() && state == m_drawnState) {
+            m_loopStats.idle++;
+            m_gpuTimer.endFrame(false);
+            reportLoopStats();
+            continue;
+        }
+        m_needsRedraw = false;
+        m_drawnState = state;
+        rendered = true;
+        m_loopStats.rendered++;
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
         // 计算projection和view矩阵
         // step2 获取动画进度和当前相机参数 // step3 设置视图矩阵
         glm::mat4 projection, view;
+        ScopedStageTimer matricesTimer(&m_profiler, FrameProfiler::MATRICES);
         if ((m_panoMode == SwitchMode::PANORAMAIMAGE) && (m_panoAnimator != PanoramaRenderer::PanoAnimator::NONE)) {
             float currentFrameTime = cv::getTickCount();                                      // 获取当前时间
             float deltaTime = (currentFrameTime - m_lastFrameTime) / cv::getTickFrequency();  // 计算帧间时间
@@ -459,21 +638,115 @@ void PanoramaRenderer::renderLoop() {
             float fov;
             m_animationEffect.getInterpolatedParams(m_animationTime, cameraPosition, cameraOrientation, fov);
 
-            getViewMatrixForAnimation(cameraPosition, cameraOrientation, fov, projection, view);  // 获取投影和视角矩阵, 动画视角
+            getViewMatrixForAnimation(cameraPosition, cameraOrientation, fov, (float)m_widthScreen / m_heightScreen, projection, view);  // 获取投影和视角矩阵, 动画视角
         } else {
             getViewMatrixForStatic(projection, view);  // 获取投影和视角矩阵, 静态视角
         }
+        matricesTimer.stop();
 
 // step4 渲染
-#if USE_GL_BEGIN_END
+#if defined(PANO_LEGACY_GL) && USE_GL_BEGIN_END
+        loadLegacyMatrices(projection, view);
         renderSphere(1.0f, 50, 50);
 #else
-        renderPanorama(m_sphereData, projection, view);
+        // 页还在加载时即使相机不动也要继续画，直到需要的页都驻留
+        m_needsRedraw |= updateVirtualTexture(projection, view, m_widthScreen, m_heightScreen, false);
+        {
+            ScopedStageTimer timer(&m_profiler, FrameProfiler::RENDER);
+            ScopedGpuTimer gpuTimer(m_gpuTimer, FrameProfiler::GPU_RENDER);
+            renderPanorama(projection, view, m_heightScreen);
+        }
 #endif
+        drawProfilerHud();
+        m_gpuTimer.endFrame();
+
+        {
+            ScopedStageTimer timer(&m_profiler, FrameProfiler::SWAP);
+            m_context.swapBuffers();
+        }
+        if (!m_firstFrameShown) {
+            printf("First frame shown %.1f ms after start\n", (cv::getTickCount() / cv::getTickFrequency() - m_startTime) * 1000.0);
+            m_firstFrameShown = true;
+        }
+
+        m_glState.endFrame();
+        if (m_options.printGLStats) {
+            reportGLStats();
+        }
+
+        double frameMs = (cv::getTickCount() - frameStart) * 1000.0 / cv::getTickFrequency();
+        if (m_profiler.isEnabled()) {
+            m_profiler.record(FrameProfiler::FRAME, frameMs);
+        }
+        if (TraceRecorder::isRecording()) {
+            TraceRecorder::instance().addEvent(FrameProfiler::stageName(FrameProfiler::FRAME), (int64_t)frameStart, cv::getTickCount());
+        }
+        if (m_panoMode == SwitchMode::PANORAMAVIDEO && (m_options.printGLStats || !m_options.profileFile.empty())) {
+            reportVideoStats(frameMs);
+        }
+        reportLoopStats();
+    }
+    printf("[loop] %ld frames rendered, %ld idle wakeups, %ld iconified wakeups in %.1f s\n", m_loopStats.rendered, m_loopStats.idle, m_loopStats.hidden,
+           (cv::getTickCount() - loopStart) / cv::getTickFrequency());
+}
 
-        glfwSwapBuffers(m_window);
+bool PanoramaRenderer::isAnimating() const {
+    // 越过总时长的那一帧已按最后一个关键帧绘制，之后不再需要重绘
+    return m_panoMode == SwitchMode::PANORAMAIMAGE && m_panoAnimator != PanoAnimator::NONE && m_animationTime < m_animationEffect.getTotalDuration();
+}
+
+PanoramaRenderer::DrawnState PanoramaRenderer::captureDrawnState() const {
+    DrawnState state;
+    state.yaw = m_yaw;
+    state.pitch = m_pitch;
+    state.fov = m_fov;
+    state.viewOrientation = m_viewOrientation;
+    state.animator = m_panoAnimator;
+    state.renderMode = m_renderMode;
+    return state;
+}
+
+void PanoramaRenderer::waitForEvents(bool rendered) {
+    // 最小化时只需定期醒来检查关闭和恢复，连续渲染模式下同样暂停
+    if (m_iconified) {
+        glfwWaitEventsTimeout(0.25);
+        return;
+    }
+    // 上一轮绘制过（例如按住方向键时没有新事件但相机每轮都在动），或有动画、纹理上传时不等待
+    if (!m_options.renderOnDemand || rendered || m_needsRedraw || isAnimating() || m_progressiveLoad == ProgressiveLoad::UPLOADING) {
         glfwPollEvents();
+        return;
+    }
+    double timeout = 0.5;  // 完全静止时也定期醒来，打印统计
+    if (m_panoMode == SwitchMode::PANORAMAVIDEO) {
+        // 按两倍帧率醒来查看播放时钟是否到了下一帧
+        double fps = m_videoDecoder.getFps();
+        timeout = fps > 0.0 ? 0.5 / fps : 0.01;
+    } else if (m_progressiveLoad == ProgressiveLoad::DECODING) {
+        timeout = 0.02;  // 后台解码完成时没有窗口事件，需要轮询
     }
+    glfwWaitEventsTimeout(timeout);
+}
+
+void PanoramaRenderer::reportLoopStats() {
+    if (!m_options.printGLStats) return;
+    double now = cv::getTickCount() / cv::getTickFrequency();
+    if (now - m_lastLoopStatsTime < 2.0) return;
+    printf("[loop] %ld frames rendered, %ld idle wakeups, %ld iconified wakeups\n", m_loopStats.rendered - m_reportedLoopStats.rendered, m_loopStats.idle - m_reportedLoopStats.idle,
+           m_loopStats.hidden - m_reportedLoopStats.hidden);
+    m_reportedLoopStats = m_loopStats;
+    m_lastLoopStatsTime = now;
+}
+
+void PanoramaRenderer::drawProfilerHud() {
+    if (!m_hud.isVisible()) return;
+    ScopedStageTimer timer(&m_profiler, FrameProfiler::HUD);
+    double now = cv::getTickCount() / cv::getTickFrequency();
+    if (now - m_lastHudTime >= 0.5) {
+        m_hud.setText(m_glState, m_profiler.formatTable());
+        m_lastHudTime = now;
+    }
+    m_hud.draw(m_glState, m_widthScreen, m_heightScreen);
 }
 
 void PanoramaRenderer::mouse_callback(double xpos, double ypos) {
@@ -510,6 +783,48 @@ void PanoramaRenderer::scroll_callback(double xoffset, double yoffset) {
     m_fov = glm::clamp(m_fov, 1.0f, 120.0f);      // 限制 FOV 的范围
 }
 
+void PanoramaRenderer::key_callback(int key, int scancode, int action, int mods) {
+    if (action != GLFW_PRESS) return;
+
+    // P 键在后台导出全景照片动画师效果，不影响主线程运行；C 键取消导出
+    if (key == GLFW_KEY_P) {
+        startExportAnimationEffect("panoAnimator.mp4", 1920, 1080, 30);
+    } else if (key == GLFW_KEY_C) {
+        cancelExportAnimationEffect();
+    }
+
+    // R 键在球体网格和全屏光线投射两种绘制方式之间切换
+    if (key == GLFW_KEY_R) {
+        m_renderMode = m_renderMode == PanoramaRenderMode::MESH ? PanoramaRenderMode::RAYCAST : PanoramaRenderMode::MESH;
+        printf("render mode: %s\n", m_renderMode == PanoramaRenderMode::MESH ? "mesh" : "raycast");
+    }
+
+    // H 键显示或隐藏各阶段耗时的叠加层，第一次显示时开始记录
+    if (key == GLFW_KEY_H) {
+        m_hud.setVisible(!m_hud.isVisible());
+        if (m_hud.isVisible()) {
+            m_profiler.setEnabled(true);
+            m_lastHudTime = 0.0;  // 立即刷新文字
+        }
+        m_needsRedraw = true;
+        printf("profiler hud: %s\n", m_hud.isVisible() ? "on" : "off");
+    }
+
+    // U 键循环切换视频纹理上传方式：DIRECT -> PBO -> PERSISTENT
+    if (key == GLFW_KEY_U && m_panoMode == SwitchMode::PANORAMAVIDEO) {
+        TextureStreamer::UploadMode mode = m_textureStreamer.getMode();
+        if (mode == TextureStreamer::UploadMode::DIRECT) {
+            mode = TextureStreamer::UploadMode::PBO;
+        } else if (mode == TextureStreamer::UploadMode::PBO) {
+            mode = TextureStreamer::UploadMode::PERSISTENT;
+        } else {
+            mode = TextureStreamer::UploadMode::DIRECT;
+        }
+        m_textureStreamer.setMode(mode);
+        printf("video upload mode: %s\n", TextureStreamer::modeName(m_textureStreamer.getMode()));
+    }
+}
+
 bool PanoramaRenderer::isImageFile(const std::string &filepath) {
     std::string extensions[] = {".jpg", ".jpeg", ".png", ".bmp", ".tga"};
     for (const auto &ext : extensions) {
@@ -532,21 +847,47 @@ bool PanoramaRenderer::isVideoFile(const std::string &filepath) {
 
 // 加载全景图像
 GLuint PanoramaRenderer::loadTexture(const char *path) {
-    cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+    cv::Mat image;
+    {
+        TraceScope trace("image decode");
+        image = cv::imread(path, cv::IMREAD_COLOR);
+    }
     if (image.empty()) {
         std::cerr << "can not load image: " << path << std::endl;
         exit(1);
     }
 
     std::cout << "Loaded image with size: " << image.cols << "x" << image.rows << std::endl;
+    m_panoramaImage = image;  // 保留原图，后台CPU导出时使用
+
+    // 超过纹理尺寸上限的图像切成金字塔的页，按需上传到固定大小的物理页缓存
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    bool tooLarge = image.cols > maxSize || image.rows > maxSize;
+    if (m_options.virtualTexture || tooLarge) {
+        if (m_virtualTexture.init(std::make_shared<ImageTileSource>(image), m_options.virtualTextureCache)) {
+            m_useVirtualTexture = true;
+            return m_virtualTexture.getAtlasTexture();
+        }
+        if (tooLarge) {
+            std::cerr << "image " << image.cols << "x" << image.rows << " exceeds GL_MAX_TEXTURE_SIZE " << maxSize << " and the virtual texture failed." << std::endl;
+            exit(1);
+        }
+    }
+    return createImageTexture(image);
+}
 
-    cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
-    cv::flip(image, image, 0);
+GLuint PanoramaRenderer::createImageTexture(const cv::Mat &image) {
+    // 按 OpenCV 原生的BGR布局和自上而下的行序直接上传，颜色通道由 GL_BGR 交换，纵向翻转在着色器中完成
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.cols, image.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // 每行 cols*3 字节，不一定是4字节对齐
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(image.step / image.elemSize()));
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.cols, image.rows, 0, GL_BGR, GL_UNSIGNED_BYTE, image.data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -554,64 +895,199 @@ GLuint PanoramaRenderer::loadTexture(const char *path) {
 
     return textureID;
 }
-void PanoramaRenderer::updateVideoFrame() {
-    if (m_panoMode != SwitchMode::PANORAMAVIDEO || !m_videoCapture.isOpened()) return;
-
-    cv::Mat frame;
-    if (!m_videoCapture.read(frame)) {
-        // 视频读取结束，循环播放
-        m_videoCapture.set(cv::CAP_PROP_POS_FRAMES, 0);
-        m_videoCapture.read(frame);
+GLuint PanoramaRenderer::loadPreviewTexture(const std::string &path) {
+    double t0 = cv::getTickCount();
+    cv::Mat preview = ProgressiveImageLoader::decodePreview(path);
+    if (preview.empty()) {
+        return loadTexture(path.c_str());  // 由同步加载报告错误
     }
+    // 预览本身也可能超过纹理尺寸上限（64K 以上的原图），缩小到放得下
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (preview.cols > maxSize || preview.rows > maxSize) {
+        double scale = std::min((double)maxSize / preview.cols, (double)maxSize / preview.rows);
+        cv::resize(preview, preview, cv::Size(std::min(maxSize, (int)(preview.cols * scale)), std::min(maxSize, (int)(preview.rows * scale))), 0, 0, cv::INTER_AREA);
+    }
+    m_imageLoader.start(path, m_options.virtualTexture, maxSize);
+    m_progressiveLoad = ProgressiveLoad::DECODING;
+    printf("Preview %dx%d decoded in %.1f ms, decoding the full image in the background\n", preview.cols, preview.rows, (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency());
+    return createImageTexture(preview);
+}
 
-    // 转换为 OpenGL 纹理格式
-    cv::cvtColor(frame, frame, cv::COLOR_BGR2RGB);
-    cv::flip(frame, frame, 0);
+bool PanoramaRenderer::updateProgressiveLoad(bool wait) {
+    if (m_progressiveLoad == ProgressiveLoad::NONE) return false;
+    if (m_progressiveLoad == ProgressiveLoad::DECODING) {
+        if (!wait && !m_imageLoader.isReady()) return false;
+        cv::Mat image = m_imageLoader.wait();
+        if (image.empty()) {
+            std::cerr << "can not decode the full image, keep the preview." << std::endl;
+            m_progressiveLoad = ProgressiveLoad::NONE;
+            return false;
+        }
+        m_panoramaImage = image;
+
+        // 金字塔已在后台建好，初始化虚拟纹理只上传最粗的一层，直接替换
+        std::shared_ptr<TileSource> tiles = m_imageLoader.getTileSource();
+        if (tiles) {
+            if (m_virtualTexture.init(tiles, m_options.virtualTextureCache)) {
+                glDeleteTextures(1, &m_texture);
+                m_texture = m_virtualTexture.getAtlasTexture();
+                m_useVirtualTexture = true;
+                m_glState.invalidate();
+                updateFormatUniforms();
+                printf("Full image %dx%d decoded in %.1f ms, switched to the virtual texture\n", image.cols, image.rows, m_imageLoader.getDecodeMs());
+                m_progressiveLoad = ProgressiveLoad::NONE;
+                return true;
+            }
+            std::cerr << "can not create the virtual texture, keep the preview." << std::endl;
+            m_progressiveLoad = ProgressiveLoad::NONE;
+            return false;
+        }
 
-    glBindTexture(GL_TEXTURE_2D, m_texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, frame.cols, frame.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, frame.data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-}
-PanoramaRenderer::PanoramaRenderer(std::string filepath)
-    : m_window(nullptr), m_vao(0), m_vboVertices(0), m_vboIndices(0), m_vboTexCoords(0), m_shaderProgram(0), m_texture(0), m_viewOrientation(ViewMode::PERSPECTIVE), m_panoAnimator(PanoAnimator::NONE), m_panoMode(SwitchMode::PANORAMAIMAGE), m_widthScreen(1920), m_heightScreen(1080), m_pitch(0.0f), m_yaw(0.0f), m_prevPitch(0.0f), m_fov(60.0f), m_isDragging(false), m_lastX(0), m_lastY(0), m_sphereData(new SphereData(1.0f, 50, 50)), m_lastFrameTime((float)cv::getTickCount()), m_exporting(false) {
-    if (!glfwInit()) {
-        std::cerr << "GLFW init failed!" << std::endl;
-        exit(-1);
+        // 新纹理先分配存储，内容分帧上传，上传期间继续显示预览
+        glGenTextures(1, &m_pendingTexture);
+        glBindTexture(GL_TEXTURE_2D, m_pendingTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.cols, image.rows, 0, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        m_pendingRow = 0;
+        m_pendingFrames = 0;
+        m_progressiveLoad = ProgressiveLoad::UPLOADING;
     }
 
-    m_window = glfwCreateWindow(m_widthScreen, m_heightScreen, "360 Panorama Viewer", nullptr, m_window);
-    if (!m_window) {
-        std::cerr << "create window failed!" << std::endl;
-        glfwTerminate();
-        exit(-1);
+    // 每帧最多上传约 8MB，8K 全景约12帧传完，单帧不会因为整张上传而卡顿
+    ScopedStageTimer timer(&m_profiler, FrameProfiler::TEXTURE_LOAD);
+    ScopedGpuTimer gpuTimer(m_gpuTimer, FrameProfiler::GPU_TEXTURE_LOAD);
+    const size_t uploadBytesPerFrame = 8 << 20;
+    const cv::Mat &image = m_panoramaImage;
+    int rows = image.rows - m_pendingRow;
+    if (!wait) {
+        rows = std::min(rows, std::max(1, (int)(uploadBytesPerFrame / (image.cols * image.elemSize()))));
+    }
+    glBindTexture(GL_TEXTURE_2D, m_pendingTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(image.step / image.elemSize()));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, m_pendingRow, image.cols, rows, GL_BGR, GL_UNSIGNED_BYTE, image.ptr(m_pendingRow));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    m_pendingRow += rows;
+    m_pendingFrames++;
+    bool swapped = m_pendingRow >= image.rows;
+    if (swapped) {
+        // 缩小过滤为 GL_LINEAR，与 createImageTexture 相同，不采样 mipmap，替换时不再生成，避免这一帧卡顿和额外约1/3的显存
+        glDeleteTextures(1, &m_texture);
+        m_texture = m_pendingTexture;
+        m_pendingTexture = 0;
+        m_progressiveLoad = ProgressiveLoad::NONE;
+        printf("Full image %dx%d decoded in %.1f ms, uploaded over %d frames\n", image.cols, image.rows, m_imageLoader.getDecodeMs(), m_pendingFrames);
     }
+    m_glState.invalidateTextures();  // 上传时直接绑定了纹理
+    return swapped;
+}
+
+GLuint PanoramaRenderer::loadTileCache(const char *path) {
+    double t0 = cv::getTickCount();
+    std::shared_ptr<TileCacheFile> cache = std::make_shared<TileCacheFile>();
+    if (!cache->open(path)) {
+        exit(1);
+    }
+    // 只映射文件，不解码整张图像；初始化时只读入最粗的一层
+    if (!m_virtualTexture.init(cache, m_options.virtualTextureCache)) {
+        std::cerr << "can not create the virtual texture for: " << path << std::endl;
+        exit(1);
+    }
+    m_useVirtualTexture = true;
+    printf("Opened tile cache %s: %dx%d, %s tiles, in %.2f ms\n", path, cache->getWidth(), cache->getHeight(), TileCacheFile::compressionName(cache->getCompression()),
+           (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency());
+    return m_virtualTexture.getAtlasTexture();
+}
+
+bool PanoramaRenderer::updateVideoFrame() {
+    if (m_panoMode != SwitchMode::PANORAMAVIDEO || !m_videoDecoder.isOpened()) return false;
+
+    // 按播放时钟选择当前应显示的帧：解码尚未跟上或下一帧还没到显示时间时沿用上一帧纹理，不阻塞渲染，
+    // 因此上传次数只与视频帧率有关，与显示器刷新率无关
+    const VideoFrame *frame = m_videoDecoder.acquireCurrentFrame();
+    if (!frame) return false;
+    ScopedStageTimer timer(&m_profiler, FrameProfiler::VIDEO_UPLOAD);
+    ScopedGpuTimer gpuTimer(m_gpuTimer, FrameProfiler::GPU_VIDEO_UPLOAD);
+
+    // 纹理存储已经预先分配，这里只通过PBO环更新内容
+    m_textureStreamer.upload(frame->image);
+    m_glState.invalidateTextures();  // 上传时直接绑定了纹理
+
+    // 上传完成后立即归还槽位
+    m_videoDecoder.releaseFrame();
+    return true;
+}
+
+void PanoramaRenderer::reportVideoStats(double frameMs) {
+    m_frameTimeTotalMs += frameMs;
+    m_frameTimeCount++;
+
+    double now = cv::getTickCount() / cv::getTickFrequency();
+    if (now - m_lastStatsTime < 2.0) return;
+
+    const TextureStreamer::Stats &stats = m_textureStreamer.getStats();
+    printf("[video] upload=%s uploads=%ld upload avg=%.3f ms max=%.3f ms | frame avg=%.3f ms (%ld frames) | skipped=%ld dropped=%ld\n",
+           TextureStreamer::modeName(m_textureStreamer.getMode()), stats.frames, stats.averageUploadMs(), stats.maxUploadMs,
+           m_frameTimeCount > 0 ? m_frameTimeTotalMs / m_frameTimeCount : 0.0, m_frameTimeCount,
+           m_videoDecoder.getSkippedFrames(), m_videoDecoder.getDroppedFrames());
 
-    glfwMakeContextCurrent(m_window);
-    glewInit();
+    m_textureStreamer.resetStats();
+    m_frameTimeTotalMs = 0.0;
+    m_frameTimeCount = 0;
+    m_lastStatsTime = now;
+}
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_TEXTURE_2D);
+PanoramaRenderer::PanoramaRenderer(std::string filepath, const RendererOptions &options)
+    : m_window(nullptr), m_shaderProgram(0), m_texture(0), m_textureUV(0), m_pixelFormat(VideoPixelFormat::BGR), m_raycastProgram(0), m_raycastVao(0), m_viewOrientation(ViewMode::PERSPECTIVE), m_panoAnimator(PanoAnimator::NONE), m_panoMode(SwitchMode::PANORAMAIMAGE), m_widthScreen(options.viewportWidth), m_heightScreen(options.viewportHeight), m_pitch(0.0f), m_yaw(0.0f), m_prevPitch(0.0f), m_fov(60.0f), m_isDragging(false), m_lastX(0), m_lastY(0), m_options(options), m_renderMode(options.renderMode), m_videoDecoder(options.videoRingCapacity, options.videoLoopMode, options.videoPrerollFrames), m_lastFrameTime((float)cv::getTickCount()) {
+    m_startTime = cv::getTickCount() / cv::getTickFrequency();
+    // 解码线程也记录耗时，必须在打开视频之前设置
+    m_profiler.setEnabled(!m_options.profileFile.empty() || m_options.showProfilerHud);
+    m_hud.setVisible(m_options.showProfilerHud);
+    m_videoDecoder.setProfiler(&m_profiler);
+    // 窗口或离屏上下文由 GLContext 按后端创建，GLEW 也在其中初始化
+    if (!m_context.create(m_options.contextBackend, m_widthScreen, m_heightScreen, "360 Panorama Viewer", m_options.contextProfile)) {
+        std::cerr << "create OpenGL context failed, backend: " << GLContext::backendName(m_options.contextBackend) << std::endl;
+        exit(-1);
+    }
+    m_window = m_context.getWindow();
 
-    // 初始化 SphereData
-    m_sphereData = new SphereData(1.0f, 50, 50);
+    m_glState.setDepthTest(true);
 
     initPanoramaRenderer();
 
     // 检测文件类型
-    if (isImageFile(filepath)) {
-        // 处理全景图片
+    if (TileCacheFile::isTileCacheFile(filepath)) {
+        // 预处理的全景图像分页缓存
+        m_panoMode = SwitchMode::PANORAMAIMAGE;
+        m_texture = loadTileCache(filepath.c_str());
+    } else if (isImageFile(filepath)) {
+        // 处理全景图片；有窗口时先显示预览，缩短打开大图时的黑屏时间，导出时原图总要完整加载，直接同步解码
         m_panoMode = SwitchMode::PANORAMAIMAGE;
-        m_texture = loadTexture(filepath.c_str());
+        if (m_options.progressiveLoad && !m_context.isHeadless() && ProgressiveImageLoader::supportsPreview(filepath)) {
+            m_texture = loadPreviewTexture(filepath);
+        } else {
+            m_texture = loadTexture(filepath.c_str());
+        }
     } else if (isVideoFile(filepath)) {
         // 处理全景视频
         m_panoMode = SwitchMode::PANORAMAVIDEO;
-        m_videoCapture.open(filepath);
-        if (!m_videoCapture.isOpened()) {
+        if (!m_videoDecoder.open(filepath, m_options.videoPixelFormat)) {
             std::cerr << "Cannot open video file: " << filepath << std::endl;
             exit(1);
         }
-        // 提取第一帧作为初始纹理
+        // 视频纹理和上传缓冲区只分配一次，按解码器实际输出的布局创建
+        m_pixelFormat = m_videoDecoder.getPixelFormat();
+        m_textureStreamer.init(m_videoDecoder.getWidth(), m_videoDecoder.getHeight(), m_pixelFormat, m_options.videoUploadMode, m_options.videoUploadBuffers);
+        m_texture = m_textureStreamer.getTexture(0);
+        m_textureUV = m_textureStreamer.getTexture(1);
+
+        // 等待解码线程准备好第一帧，作为初始纹理
+        m_videoDecoder.waitForFrame(5000);
         updateVideoFrame();
     } else {
         std::cerr << "Unknow file type: " << filepath << std::endl;
@@ -620,15 +1096,19 @@ PanoramaRenderer::PanoramaRenderer(std::string filepath)
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);  // 解绑 VBO,360全景图像最好需要
     glBindVertexArray(0);              // 解绑VAO,360全景图像最好需要
-    if (m_panoMode == SwitchMode::PANORAMAIMAGE) {
-        glGenerateMipmap(GL_TEXTURE_2D);  // 全景图像需要 mipmap,但是视频渲染不使用 glGenerateMipmap,较少性能开销
-    }
+    // 图像纹理（包括预览）的缩小过滤都是 GL_LINEAR，不采样 mipmap，因此不生成
+    // 以上初始化绕过了状态缓存，之后的绑定都经过 m_glState
+    m_glState.invalidate();
+    updateFormatUniforms();
 
     // 启用深度测试，防止遮挡影响
-    glEnable(GL_DEPTH_TEST);
+    m_glState.setDepthTest(true);
     // 设置深度测试函数
     glDepthFunc(GL_LESS);
 
+    // 无窗口后端没有输入事件，只用于导出
+    if (!m_window) return;
+
     // 设置回调函数,设置当前实例为窗口的用户指针
     glfwSetWindowUserPointer(m_window, this);
 
@@ -647,167 +1127,218 @@ PanoramaRenderer::PanoramaRenderer(std::string filepath)
         auto *renderer = static_cast<PanoramaRenderer *>(glfwGetWindowUserPointer(m_window));
         renderer->scroll_callback(xoffset, yoffset);
     });
-}
-
-// 启动后台导出线程
-void PanoramaRenderer::startExportAnimationEffect(const std::string &outputFile, int width, int height, int fps) {
-    if (m_exporting.load()) {
-        std::cerr << "Export already in progress!" << std::endl;
-        return;
-    }
-    m_exporting.store(true);  // 设置导出标志
-
-    // 启动后台线程进行导出
-    m_exportThread = std::thread(&PanoramaRenderer::exportAnimationEffectThread, this, outputFile, width, height, fps);
-    m_exportThread.detach();  // 分离线程，避免阻塞主线程
-}
 
-// 后台导出视频的实现
-void PanoramaRenderer::exportAnimationEffectThread(const std::string &outputFile, int width, int height, int fps) {
-    // 在后台线程中，确保使用主窗口的 OpenGL 上下文
-    glfwMakeContextCurrent(m_window);  // 确保当前线程使用主上下文
-
-    // 创建 FBO
-    GLuint fbo;
-    glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-    // 创建纹理并绑定到 FBO 的颜色附件
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_widthScreen, m_heightScreen, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
-
-    // 创建深度缓冲区并绑定到 FBO 的深度附件
-    GLuint rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_widthScreen, m_heightScreen);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+    glfwSetKeyCallback(m_window, [](GLFWwindow *m_window, int key, int scancode, int action, int mods) {
+        auto *renderer = static_cast<PanoramaRenderer *>(glfwGetWindowUserPointer(m_window));
+        renderer->key_callback(key, scancode, action, mods);
+    });
 
-    // 检查 FBO 完整性
-    GLenum framebufferStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (framebufferStatus != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "Framebuffer not complete! Error code: " << framebufferStatus << std::endl;
+    // 最小化时暂停绘制；窗口内容需要刷新（恢复、被遮挡后重新露出）时重绘一帧
+    glfwSetWindowIconifyCallback(m_window, [](GLFWwindow *m_window, int iconified) {
+        auto *renderer = static_cast<PanoramaRenderer *>(glfwGetWindowUserPointer(m_window));
+        renderer->m_iconified = iconified != 0;
+        renderer->m_needsRedraw = true;
+    });
 
-        m_exporting.store(false);  // 重置导出标志
-        return;
-    }
+    glfwSetWindowRefreshCallback(m_window, [](GLFWwindow *m_window) {
+        auto *renderer = static_cast<PanoramaRenderer *>(glfwGetWindowUserPointer(m_window));
+        renderer->m_needsRedraw = true;
+    });
+}
 
-    // 创建并打开视频编码器
-    cv::VideoWriter videoWriter(outputFile, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps, cv::Size(width, height));
-    if (!videoWriter.isOpened()) {
-        std::cerr << "Cannot open video file for writing: " << outputFile << std::endl;
+// 启动后台导出：拷贝当前动画和原图，多个线程在CPU上渲染，编码线程按顺序写入视频
+void PanoramaRenderer::startExportAnimationEffect(const std::string &outputFile, int width, int height, int fps) {
+    if (m_panoMode != SwitchMode::PANORAMAIMAGE || m_panoAnimator == PanoramaRenderer::PanoAnimator::NONE) {
+        std::cerr << "No animation effect to export!" << std::endl;
         return;
     }
-
-    // 渲染和写入帧
-    float totalTime = m_animationEffect.getTotalDuration();
-    for (float t = 0.0f; t < totalTime; t += 1.0f / fps) {
-        glm::vec3 cameraPosition;
-        glm::quat cameraOrientation;
-        float fov;
-        m_animationEffect.getInterpolatedParams(t, cameraPosition, cameraOrientation, fov);
-
-        // 获取视图矩阵
-        glm::mat4 projection, view;
-        getViewMatrixForAnimation(cameraPosition, cameraOrientation, fov, projection, view);
-
-        // 渲染到 FBO
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-        glViewport(0, 0, m_widthScreen, m_heightScreen);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        renderPanorama(m_sphereData, projection, view);
-
-        // 读取渲染结果
-        cv::Mat renderFrame(m_heightScreen, m_widthScreen, CV_8UC3);
-        glReadPixels(0, 0, m_widthScreen, m_heightScreen, GL_RGB, GL_UNSIGNED_BYTE, renderFrame.data);
-
-        // OpenGL 坐标系和 OpenCV 坐标系不同，需要翻转
-        cv::flip(renderFrame, renderFrame, 0);
-
-        // 将 BGR 顺序转换为 RGB 顺序
-        cv::cvtColor(renderFrame, renderFrame, cv::COLOR_BGR2RGB);
-
-        // 调整大小到指定的输出参数宽和高
-        cv::Mat frame;
-        cv::resize(renderFrame, frame, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
-
-        // 写入视频文件
-        videoWriter.write(frame);
+    // CPU 导出需要原图，预览阶段按下时等待后台解码完成
+    updateProgressiveLoad(true);
+    AnimationExporter::Job job;
+    job.outputFile = outputFile;
+    job.width = width;
+    job.height = height;
+    job.fps = fps;
+    job.effect = m_animationEffect;
+    job.remapCacheBytes = (size_t)m_options.remapCacheMB << 20;
+    // 从分页缓存打开时没有原图，由导出线程从页拼出一层足够清晰的图像（导出器保留，再次导出时不重新拼）
+    if (m_panoramaImage.empty() && m_useVirtualTexture) {
+        job.tileSource = m_virtualTexture.getSource();
+        job.tileLevel = job.tileSource->findLevel(TileSource::CPU_LEVEL_MAX_WIDTH);
+    } else {
+        job.panorama = m_panoramaImage;
     }
+    m_exporter.start(job);
+}
 
-    // 删除帧缓冲对象和纹理
-    glDeleteFramebuffers(1, &fbo);
-    glDeleteTextures(1, &texture);
-    glDeleteRenderbuffers(1, &rbo);
-
-    // 销毁 OpenGL 上下文
-    glfwMakeContextCurrent(nullptr);  // 销毁 OpenGL 上下文
-
-    // 导出结束，重置标志
-    m_exporting.store(false);
+void PanoramaRenderer::cancelExportAnimationEffect() {
+    m_exporter.cancel();
 }
 
-void PanoramaRenderer::exportAnimationEffect(const std::string &outputFile, int width, int height, int fps) {
+bool PanoramaRenderer::exportAnimationEffect(const std::string &outputFile, int width, int height, int fps) {
     if (m_panoMode != SwitchMode::PANORAMAIMAGE || m_panoAnimator == PanoramaRenderer::PanoAnimator::NONE) {
         std::cerr << "No animation effect to export!" << std::endl;
-        return;
+        return false;
     }
+    updateProgressiveLoad(true);
 
     // 创建一个视频编码器
     cv::VideoWriter videoWriter(outputFile, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps, cv::Size(width, height));
     if (!videoWriter.isOpened()) {
         std::cerr << "Cannot open video file for writing: " << outputFile << std::endl;
-        return;
+        return false;
     }
 
+    // 直接在输出尺寸（超采样时为其整数倍）的离屏帧缓冲区中渲染，与窗口大小无关
+    RenderTarget target;
+    if (!target.create(width, height, m_options.exportSupersample)) {
+        return false;
+    }
+    GLint savedViewport[4];
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+
+    // 回读走PBO环：第N帧的数据在GPU渲染后续帧时才取出；帧内存来自帧池，不再逐帧分配
+    FrameReadback readback;
+    readback.init(width, height, m_options.exportReadbackBuffers);
+    FramePool framePool(2);
+    framePool.setFormat(height, width, CV_8UC3);
+
+    // 取出最早的一帧回读结果写入视频文件，尺寸已经是输出尺寸
+    auto writeOldestFrame = [&]() {
+        cv::Mat frame = framePool.acquire();
+        bool ok = readback.popFrame(frame);
+        if (ok) {
+            TraceScope trace("encode frame");
+            videoWriter.write(frame);
+        }
+        framePool.release(frame);
+        return ok;
+    };
+
     // 获取当前动画模式的结构体，根据时刻0到总时间T，快速生成渲染帧，然后写入视频文件
+    double t0 = cv::getTickCount();
+    int frameCount = 0;
     float totalTime = m_animationEffect.getTotalDuration();
+    bool failed = false;
     for (float t = 0.0f; t < totalTime; t += 1.0f / fps) {
+        ScopedStageTimer frameTimer(&m_profiler, FrameProfiler::FRAME);
+        m_gpuTimer.beginFrame();
+        ScopedStageTimer matricesTimer(&m_profiler, FrameProfiler::MATRICES);
         glm::vec3 cameraPosition;
         glm::quat cameraOrientation;
         float fov;
         m_animationEffect.getInterpolatedParams(t, cameraPosition, cameraOrientation, fov);
 
-        // 获取视图矩阵
+        // 获取视图矩阵，按输出的宽高比
         glm::mat4 projection, view;
-        getViewMatrixForAnimation(cameraPosition, cameraOrientation, fov, projection, view);
-
-        // 渲染
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        renderPanorama(m_sphereData, projection, view);
+        getViewMatrixForAnimation(cameraPosition, cameraOrientation, fov, (float)width / height, projection, view);
+        matricesTimer.stop();
+
+        // 渲染，超采样时在GPU上缩小到输出尺寸；虚拟纹理同步加载本帧需要的全部页
+        updateVirtualTexture(projection, view, width * target.getSupersample(), height * target.getSupersample(), true);
+        {
+            ScopedStageTimer timer(&m_profiler, FrameProfiler::RENDER);
+            ScopedGpuTimer gpuTimer(m_gpuTimer, FrameProfiler::GPU_RENDER);
+            target.bind();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderPanorama(projection, view, height * target.getSupersample());
+            target.resolve();
+        }
 
-        // 读取渲染结果
-        cv::Mat renderFrame(m_heightScreen, m_widthScreen, CV_8UC3);
-        glReadPixels(0, 0, m_widthScreen, m_heightScreen, GL_RGB, GL_UNSIGNED_BYTE, renderFrame.data);
+        // 环满时先取出最早的一帧，再发出本帧的异步回读
+        ScopedStageTimer readbackTimer(&m_profiler, FrameProfiler::READBACK);
+        if (readback.isFull() && !writeOldestFrame()) {
+            failed = true;
+            m_gpuTimer.endFrame();
+            break;
+        }
+        {
+            ScopedGpuTimer gpuTimer(m_gpuTimer, FrameProfiler::GPU_READBACK);
+            readback.readAsync();
+        }
+        m_gpuTimer.endFrame();
+        frameCount++;
+    }
+    while (!failed && readback.getPendingCount() > 0) {
+        failed = !writeOldestFrame();
+    }
 
-        // OpenGL 坐标系和 OpenCV 坐标系不同，需要翻转
-        cv::flip(renderFrame, renderFrame, 0);
-        cv::cvtColor(renderFrame, renderFrame, cv::COLOR_BGR2RGB);
+    if (failed) {
+        // 剩余的回读由 release() 丢弃，不完整的输出文件删除
+        std::cerr << "[export] " << outputFile << ": frame readback failed, export aborted." << std::endl;
+        videoWriter.release();
+        std::remove(outputFile.c_str());
+    } else {
+        double seconds = (cv::getTickCount() - t0) / cv::getTickFrequency();
+        const FrameReadback::Stats &stats = readback.getStats();
+        printf("[export] %s: %d frames %dx%d (supersample x%d) in %.2f s (%.1f fps), readback wait %.2f ms + copy %.2f ms per frame\n", outputFile.c_str(), frameCount, width, height,
+               target.getSupersample(), seconds, seconds > 0 ? frameCount / seconds : 0.0, stats.averageWaitMs(), stats.averageCopyMs());
+    }
+    readback.release();
+    target.release();
 
-        // 调整大小到指定的输出参数宽和高
-        cv::Mat frame;
-        cv::resize(renderFrame, frame, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
+    // 恢复屏幕（或 GLContext 的离屏）帧缓冲区和视口
+    glBindFramebuffer(GL_FRAMEBUFFER, m_context.getFramebuffer());
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    return !failed;
+}
 
-        // 写入视频文件
-        videoWriter.write(frame);
-    }
+bool PanoramaRenderer::renderViewOffscreen(ViewMode viewMode, PanoramaRenderMode renderMode, RenderTarget &target, FrameReadback &readback, cv::Mat &image) {
+    // 视角和宽高比取自成员变量，渲染期间临时替换，结束后恢复
+    ViewMode savedView = m_viewOrientation;
+    PanoramaRenderMode savedMode = m_renderMode;
+    int savedWidth = m_widthScreen, savedHeight = m_heightScreen;
+    m_viewOrientation = viewMode;
+    m_renderMode = renderMode;
+    m_widthScreen = target.getWidth();
+    m_heightScreen = target.getHeight();
+    GLint savedViewport[4];
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+    m_glState.invalidate();  // 调用方可能绕过绑定缓存直接绑定过纹理
+
+    glm::mat4 projection, view;
+    getViewMatrixForStatic(projection, view);
+    int supersample = target.getSupersample();
+    updateVirtualTexture(projection, view, m_widthScreen * supersample, m_heightScreen * supersample, true);
+    target.bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderPanorama(projection, view, m_heightScreen * supersample);
+    target.resolve();
+    readback.readAsync();
+    bool ok = readback.popFrame(image);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_context.getFramebuffer());
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    m_viewOrientation = savedView;
+    m_renderMode = savedMode;
+    m_widthScreen = savedWidth;
+    m_heightScreen = savedHeight;
+    return ok;
 }
 
 PanoramaRenderer::~PanoramaRenderer() {
-    delete m_sphereData;
+    m_videoDecoder.close();
+    m_gpuTimer.flush();
+    if (!m_options.profileFile.empty()) {
+        m_profiler.dump(m_options.profileFile);
+    }
+    m_gpuTimer.release();
+    m_hud.release();
     glDeleteProgram(m_shaderProgram);
-    glDeleteTextures(1, &m_texture);
+    glDeleteProgram(m_raycastProgram);
+    if (m_panoMode == SwitchMode::PANORAMAVIDEO) {
+        m_textureStreamer.release();  // 视频纹理由 m_textureStreamer 持有
+    } else if (m_useVirtualTexture) {
+        m_virtualTexture.release();  // 物理页缓存由 m_virtualTexture 持有
+    } else {
+        glDeleteTextures(1, &m_texture);
+    }
+    if (m_pendingTexture) {
+        glDeleteTextures(1, &m_pendingTexture);
+    }
     // glDeleteTextures(1, &videoTexture);
-    glDeleteBuffers(1, &m_vboVertices);
-    glDeleteBuffers(1, &m_vboTexCoords);
-    glDeleteBuffers(1, &m_vboIndices);
-    glDeleteVertexArrays(1, &m_vao);
+    m_sphereMeshes.release();
+    glDeleteVertexArrays(1, &m_raycastVao);
 
-    glfwDestroyWindow(m_window);
-    glfwTerminate();
+    m_context.destroy();
 }
@@ -24,61 +24,61 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "Sphere.h"
+#include "AnimationEffect.h"
+#include "AnimationExporter.h"
+#include "FrameReadback.h"
+#include "FramePool.h"
+#include "RenderTarget.h"
+#include "SphereMeshCache.h"
+#include "GLContext.h"
+#include "GLStateCache.h"
+#include "VideoDecoder.h"
+#include "TextureStreamer.h"
+#include "VirtualTexture.h"
+#include "TileCacheFile.h"
+#include "ProgressiveImageLoader.h"
+#include "FrameProfiler.h"
+#include "ProfilerHud.h"
+#include "GpuTimer.h"
 
+// 传统固定管线代码（立即模式绘制球体）只在以 PANO_LEGACY_GL 编译时保留，需要兼容模式上下文
+#ifdef PANO_LEGACY_GL
 #define USE_GL_BEGIN_END 0
+#endif
 
-// 照片动画N个节点，N-1个区间段，如果首尾节点数据保持一致，表示回到原处状态
-struct AnimationEffect {
-    std::vector<glm::vec3> CameraPosNodes;  // 动画在N个节点上的相机位置
-    std::vector<glm::quat> CameraRotNodes;  // 动画在N个节点上的相机朝向四元数
-    std::vector<float> FovNodes;            // 动画在N个节点上的fov角度
+// 全景的绘制方式
+enum class PanoramaRenderMode { MESH,      // 纹理映射的球体网格
+                                RAYCAST };  // 全屏三角形，逐像素由视线解析计算经纬度，没有网格近似带来的接缝和极点变形
 
-    std::vector<float> stagesDuration;  // 每个阶段的时长（N-1个阶段）,长度比上面数组少1
-
-    // 计算动画的总时长
-    float getTotalDuration() const {
-        float totalDuration = 0.0f;
-        for (size_t i = 0; i < stagesDuration.size(); i++) {
-            totalDuration += stagesDuration[i];
-        }
-        return totalDuration;
-    }
-
-    // 获取当前阶段的插值进度
-    float getStageProgress(float currentTime) const {
-        float accumulatedTime = 0.0f;
-
-        for (size_t i = 0; i < stagesDuration.size(); i++) {
-            accumulatedTime += stagesDuration[i];
-            if (currentTime <= accumulatedTime) {
-                float stageStartTime = accumulatedTime - stagesDuration[i];
-                return glm::clamp((currentTime - stageStartTime) / stagesDuration[i], 0.0f, 1.0f);
-            }
-        }
-        return 1.0f;  // 动画结束
-    }
-
-    // 获取当前阶段的参数（例如：相机位置，方向，fov）
-    void getInterpolatedParams(float currentTime, glm::vec3 &cameraPos, glm::quat &cameraRot, float &fov) const {
-        float progress = getStageProgress(currentTime);
-
-        // 处理插值
-        float accumulatedStageTime = 0.0f;
-        for (size_t i = 0; i < stagesDuration.size(); i++) {
-            float stageStartTime = accumulatedStageTime;
-            accumulatedStageTime += stagesDuration[i];  // 累加前面的阶段时长
-
-            if (currentTime <= stageStartTime + stagesDuration[i]) {
-                // 线性插值计算相机位置和fov
-                cameraPos = glm::mix(CameraPosNodes[i], CameraPosNodes[i + 1], progress);
-                fov = glm::mix(FovNodes[i], FovNodes[i + 1], progress);
-
-                // 使用slerp对四元数进行插值，计算相机朝向
-                cameraRot = glm::slerp(CameraRotNodes[i], CameraRotNodes[i + 1], progress);
-                break;
-            }
-        }
-    }
+// 渲染器启动参数
+struct RendererOptions {
+    GLContext::Backend contextBackend = GLContext::Backend::GLFW_WINDOW;             // OpenGL 上下文后端，无窗口后端只能导出不能交互
+#ifdef PANO_LEGACY_GL
+    GLContext::Profile contextProfile = GLContext::Profile::COMPATIBILITY;           // 上下文模式
+#else
+    GLContext::Profile contextProfile = GLContext::Profile::CORE;                    // 上下文模式
+#endif
+    PanoramaRenderMode renderMode = PanoramaRenderMode::MESH;                        // 绘制方式，交互时按R键切换
+    SphereIndexOrder sphereIndexOrder = SphereIndexOrder::STRIP;                     // 球体网格的索引组织方式
+    int viewportWidth = 1920;                                                        // 窗口或离屏帧缓冲区的宽
+    int viewportHeight = 1080;                                                       // 窗口或离屏帧缓冲区的高
+    TextureStreamer::UploadMode videoUploadMode = TextureStreamer::UploadMode::PBO;  // 视频纹理上传方式
+    int videoUploadBuffers = 3;                                                      // 视频上传PBO环的缓冲区个数
+    int videoRingCapacity = 4;                                                       // 视频解码帧环形缓冲区容量
+    VideoPixelFormat videoPixelFormat = VideoPixelFormat::BGR;                       // 请求的解码输出布局，NV12 在着色器中转换为RGB
+    VideoDecoder::LoopMode videoLoopMode = VideoDecoder::LoopMode::GAPLESS;          // 视频循环播放方式
+    int videoPrerollFrames = 8;                                                      // 无缝循环时预读缓存的开头帧数
+    int exportReadbackBuffers = 3;                                                   // 同步导出时异步回读PBO环的缓冲区个数
+    int exportSupersample = 1;                                                       // 同步导出时每个方向的超采样倍数（1、2、4）
+    int remapCacheMB = 256;                                                          // CPU 导出的重投影查找表缓存预算（MB），0 表示不缓存
+    bool printGLStats = false;                                                       // 定期打印每帧的 GL 调用次数，以及每个网格级别的顶点缓存 ACMR
+    bool renderOnDemand = true;                                                      // 交互时画面没有变化就不重绘，等待输入事件
+    bool progressiveLoad = true;                                                     // 交互时 JPEG 先显示缩小解码的预览，原图在后台解码后替换
+    bool virtualTexture = false;                                                     // 全景图像强制使用分页虚拟纹理，超过 GL_MAX_TEXTURE_SIZE 时总是使用
+    int virtualTextureCache = 16;                                                    // 虚拟纹理物理页缓存每边的页数（每页256像素）
+    int virtualTextureUploads = 16;                                                  // 交互时每帧最多上传的页数
+    std::string profileFile;                                                         // 非空时记录各阶段耗时，退出时把统计写入该文件
+    bool showProfilerHud = false;                                                    // 启动时显示耗时叠加层（同时开始记录），交互时按H键切换
 };
 
 class PanoramaRenderer {
@@ -93,51 +93,150 @@ class PanoramaRenderer {
                               ROTATE,
                               SWIPE,
                               SWIPE_ROTATE };  //全景动画类型,仅仅全景照片适用
-    PanoramaRenderer(std::string filepath);
-    // 渲染循环
+    PanoramaRenderer(std::string filepath, const RendererOptions &options = RendererOptions());
+    // 渲染循环，需要窗口后端
     void renderLoop();
 
+    // 透视视角（1键）的投影和视图矩阵，CPU 重投影与 GL 渲染共用
+    static void getPerspectiveMatrices(float fov, float yaw, float pitch, float aspect, glm::mat4 &projection, glm::mat4 &view);
+    // 照片动画师某一时刻的投影和视图矩阵，这三个相机参数也是 RemapCache 的键
+    static void getAnimationMatrices(glm::vec3 cameraPos, glm::quat cameraRot, float fov, float aspect, glm::mat4 &projection, glm::mat4 &view);
+
+    // 各动画类型的关键帧
+    static AnimationEffect makeAnimationEffect(PanoAnimator animator);
+    // 设置并从头开始“照片动画师”效果，对应交互时的 F1/F2/F3 键
+    void setPanoAnimator(PanoAnimator animator);
+
     // 导出“照片动画师”为视频
-    void exportAnimationEffectThread(const std::string &outputFile, int width, int height, int fps);  // 导出动画视频函数声明
-    void exportAnimationEffect(const std::string &outputFile, int width, int height, int fps);        // 导出动画视频函数声明
-    void startExportAnimationEffect(const std::string &outputFile, int width, int height, int fps);   // 启动后台线程导出
+    bool exportAnimationEffect(const std::string &outputFile, int width, int height, int fps);       // 在渲染线程上用 OpenGL 同步导出，回读失败时中止
+    void startExportAnimationEffect(const std::string &outputFile, int width, int height, int fps);  // 后台多线程CPU渲染导出，不阻塞窗口
+    void cancelExportAnimationEffect();                                                              // 取消后台导出
+
+    // 按当前的 yaw/pitch/fov 和给定的视角、绘制方式，在 target 中离屏渲染一帧静态画面，并经 readback（与 target 同尺寸）同步读回到 image；
+    // 与交互时的绘制路径相同，基准测试使用；回读失败时返回 false
+    bool renderViewOffscreen(ViewMode viewMode, PanoramaRenderMode renderMode, RenderTarget &target, FrameReadback &readback, cv::Mat &image);
 
     // 析构函数
     ~PanoramaRenderer();
 
    private:
+    // 渐进加载的阶段：后台解码原图，之后分若干帧上传到新纹理
+    enum class ProgressiveLoad { NONE,
+                                 DECODING,
+                                 UPLOADING };
+
+    // 上一次绘制时的相机和显示方式，按需渲染时与当前状态比较
+    struct DrawnState {
+        float yaw = 0.0f;
+        float pitch = 0.0f;
+        float fov = 0.0f;
+        ViewMode viewOrientation = ViewMode::PERSPECTIVE;
+        PanoAnimator animator = PanoAnimator::NONE;
+        PanoramaRenderMode renderMode = PanoramaRenderMode::MESH;
+        bool operator==(const DrawnState &other) const {
+            return yaw == other.yaw && pitch == other.pitch && fov == other.fov && viewOrientation == other.viewOrientation && animator == other.animator && renderMode == other.renderMode;
+        }
+    };
+
+    // 渲染循环的帧计数
+    struct LoopStats {
+        long rendered = 0;  // 实际绘制的帧
+        long idle = 0;      // 醒来后发现没有变化、跳过绘制的次数
+        long hidden = 0;    // 窗口最小化期间醒来的次数
+    };
+
+    // 着色器的 uniform 位置，创建程序时解析一次，渲染时不再查询
+    struct ShaderUniforms {
+        GLint projection = -1;
+        GLint view = -1;
+        GLint invViewProj = -1;  // 光线投射程序
+        GLint eye = -1;          // 光线投射程序
+        GLint texture1 = -1;
+        GLint textureUV = -1;
+        GLint pixelFormat = -1;
+        GLint yuvToRgb = -1;
+        GLint virtualTexture = -1;
+    };
+
     bool isImageFile(const std::string &filepath);
     bool isVideoFile(const std::string &filepath);
-    void updateVideoFrame();
+    // 返回是否上传了新的一帧
+    bool updateVideoFrame();
+    // 定期打印视频上传耗时和帧时间统计，只在 --gl-stats 或 --profile 时调用
+    void reportVideoStats(double frameMs);
 
     // Function to create a shader program
     GLuint createProgram(const char *vertexSource, const char *fragmentSource);
+    // 解析着色器的 uniform 位置，创建程序后调用一次
+    void resolveUniforms(GLuint program, ShaderUniforms &uniforms);
+    // 设置只与纹理格式有关、每帧不变的 uniform（采样器单元、像素格式、YUV矩阵）
+    void updateFormatUniforms();
+    // 定期打印 GL 调用统计
+    void reportGLStats();
 
     void initPanoramaRenderer();
 
     // 加载全景图像
     GLuint loadTexture(const char *path);
+    // 打开预处理的分页缓存文件（.ptc），以虚拟纹理绘制
+    GLuint loadTileCache(const char *path);
+    // 由解码好的图像创建纹理
+    GLuint createImageTexture(const cv::Mat &image);
+    // 显示缩小解码的预览并启动后台完整解码
+    GLuint loadPreviewTexture(const std::string &path);
+    // 推进渐进加载：原图解码完成后每帧上传一部分，全部上传后替换预览纹理；wait 为 true 时等待并一次完成（导出前）。
+    // 返回显示的纹理是否被替换
+    bool updateProgressiveLoad(bool wait);
+#ifdef PANO_LEGACY_GL
     // 绘制球体，该函数是传统的立即模式渲染函数glBegin/glEnd，现代OpenGL中不推荐使用
     void renderSphere(float radius, int slices, int stacks);
+    // 把投影和视图矩阵加载到固定管线，只有 renderSphere 需要
+    void loadLegacyMatrices(const glm::mat4 &projection, const glm::mat4 &view);
+#endif
     // 处理用户输入
     void processInput();
+    // 照片动画师正在播放，每帧画面都在变化；播放到最后一个关键帧后画面静止，返回 false
+    bool isAnimating() const;
+    DrawnState captureDrawnState() const;
+    // 按需渲染时没有待处理的变化就阻塞等待事件，rendered 为上一轮是否绘制了
+    void waitForEvents(bool rendered);
+    // 定期打印绘制和空闲的帧数
+    void reportLoopStats();
+    // 叠加层可见时按固定间隔刷新文字并绘制
+    void drawProfilerHud();
     bool hasDivisibleNode(float previousPitch, float pitch);
     // 获取视图矩阵
     void getViewMatrixForStatic(glm::mat4 &projection, glm::mat4 &view);
-    // 由当前的相机位置，方向，fov获取视图矩阵
-    void getViewMatrixForAnimation(glm::vec3 cameraPos, glm::quat cameraRot, float fov, glm::mat4 &projection, glm::mat4 &view);
-    void renderPanorama(SphereData *sphereData, glm::mat4 projection, glm::mat4 view);
+    // 由当前的相机位置，方向，fov和画面宽高比获取视图矩阵
+    void getViewMatrixForAnimation(glm::vec3 cameraPos, glm::quat cameraRot, float fov, float aspect, glm::mat4 &projection, glm::mat4 &view);
+    // viewportHeight 为当前渲染目标的像素高度，网格模式下用于选择球体网格的细节级别
+    void renderPanorama(glm::mat4 projection, glm::mat4 view, int viewportHeight);
+    // 使用虚拟纹理时按本帧相机加载缺少的页，complete 为 true 时同步加载全部（导出）；返回是否还需要再画一帧
+    bool updateVirtualTexture(const glm::mat4 &projection, const glm::mat4 &view, int viewportWidth, int viewportHeight, bool complete);
     // 鼠标按下和移动回调函数
     void mouse_callback(double xpos, double ypos);
     // 鼠标按下回调函数
     void mouse_button_callback(int button, int action, int mods);
     // 滚轮回调函数（用于调整 FOV）
     void scroll_callback(double xoffset, double yoffset);
+    // 键盘回调函数（用于只在按下瞬间触发一次的切换类按键）
+    void key_callback(int key, int scancode, int action, int mods);
 
-    GLFWwindow *m_window;  // 主线程中的窗口
+    GLContext m_context;   // OpenGL 上下文，最先构造、最后销毁
+    GLFWwindow *m_window;  // 主线程中的窗口，无窗口后端为nullptr
     // 全景图片和视频渲染
-    GLuint m_vao, m_vboVertices, m_vboIndices, m_vboTexCoords;  // 顶点数组对象和缓冲对象
+    SphereMeshCache m_sphereMeshes;                             // 按视场角选择的各细节级别球体网格
     GLuint m_shaderProgram, m_texture;                          // 着色器程序和纹理对象
+    GLuint m_textureUV;                                         // NV12 视频的UV平面纹理，其它情况为0
+    VideoPixelFormat m_pixelFormat;                             // m_texture 中像素的布局
+    ShaderUniforms m_uniforms;                                  // 球体网格程序的 uniform 位置
+    GLuint m_raycastProgram;                                    // 全屏光线投射程序
+    GLuint m_raycastVao;                                        // 光线投射用的空VAO
+    ShaderUniforms m_raycastUniforms;                           // 光线投射程序的 uniform 位置
+    GLStateCache m_glState;                                     // 程序、VAO、纹理的绑定缓存，深度测试和混合开关，以及 GL 调用计数
+    VirtualTexture m_virtualTexture;                            // 超大全景图像的分页纹理，m_texture 为其物理页缓存
+    bool m_useVirtualTexture = false;                           // 全景图像是否以虚拟纹理绘制
+    double m_lastGLStatsTime = 0.0;                             // 上次打印 GL 调用统计的时间戳
 
     ViewMode m_viewOrientation;   // 透视图，小行星，水晶球
     PanoAnimator m_panoAnimator;  // 全景动画类型,仅仅全景照片适用
@@ -151,17 +250,47 @@ class PanoramaRenderer {
     float m_fov;                        // 初始视野角度,适合手动交互时候使用的变量
     bool m_isDragging;                  // 是否正在拖动鼠标,适合手动交互时候使用的变量
     double m_lastX, m_lastY;            // 上次鼠标的位置,适合手动交互时候使用的变量
-    SphereData *m_sphereData;
-    cv::VideoCapture m_videoCapture;
+    RendererOptions m_options;
+    PanoramaRenderMode m_renderMode;    // 当前绘制方式
+    VideoDecoder m_videoDecoder;        // 后台视频解码线程及其帧环形缓冲区
+    TextureStreamer m_textureStreamer;  // 视频纹理流式上传
+
+    // 视频帧时间统计
+    double m_frameTimeTotalMs = 0.0;  // 统计周期内的帧时间累计
+    long m_frameTimeCount = 0;        // 统计周期内的帧数
+    double m_lastStatsTime = 0.0;     // 上次打印统计的时间戳
 
     // 照片动画师
     AnimationEffect m_animationEffect;  // 三阶段的动画效果
     float m_animationTime = 0.0f;       // 当前动画的计时器
     float m_lastFrameTime;              // 上一帧的时间戳
 
-    // 导出视频的后台线程
-    std::atomic<bool> m_exporting;  // 用于检测是否正在导出
-    std::thread m_exportThread;     // 后台导出线程
+    // 按需渲染
+    DrawnState m_drawnState;
+    bool m_needsRedraw = true;          // 纹理内容变化、窗口需要刷新等，相机之外的重绘原因
+    bool m_iconified = false;           // 窗口已最小化，暂停绘制
+    LoopStats m_loopStats;
+    LoopStats m_reportedLoopStats;      // 上次打印时的计数
+    double m_lastLoopStatsTime = 0.0;
+
+    // 分阶段耗时
+    FrameProfiler m_profiler;
+    GpuTimer m_gpuTimer;                // 与 m_profiler 同时启用，GPU 阶段的结果几帧后取回
+    ProfilerHud m_hud;
+    double m_lastHudTime = 0.0;         // 上次刷新叠加层文字的时间戳
+
+    // 渐进加载
+    ProgressiveImageLoader m_imageLoader;                      // 原图的后台解码
+    ProgressiveLoad m_progressiveLoad = ProgressiveLoad::NONE;
+    GLuint m_pendingTexture = 0;                               // 正在分帧上传的原图纹理
+    int m_pendingRow = 0;                                      // 已上传的行数
+    int m_pendingFrames = 0;                                   // 上传用了几帧
+    double m_startTime = 0.0;                                  // 构造开始的时间戳，用于统计首帧时间
+    bool m_firstFrameShown = false;
+
+    // 后台导出
+    cv::Mat m_panoramaImage;        // 全景图像原图，CPU 导出时作为重投影的源图
+    AnimationExporter m_exporter;   // 后台导出任务
 };
 
 #endif  // PANORAMARENDERER_H
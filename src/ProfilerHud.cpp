@@ -0,0 +1,140 @@
+/**
+* @file        :ProfilerHud.cpp
+* @brief       :帧耗时统计的屏幕叠加层实现
+* @details     :纹理按图像的自上而下行序上传，在顶点着色器中翻转纵向纹理坐标；采样用最近邻，按像素一一对应地画出
+* @date        :2026/10/17 11:30:20
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "ProfilerHud.h"
+
+#include <algorithm>
+
+namespace {
+const int MARGIN = 8;        // 距离视口边缘和文字到底色边缘的像素
+const int LINE_HEIGHT = 16;  // FONT_HERSHEY_PLAIN 字号1的行高
+}  // namespace
+
+ProfilerHud::ProfilerHud()
+    : m_program(0), m_vao(0), m_texture(0), m_rectLocation(-1), m_width(0), m_height(0), m_visible(false) {
+}
+
+const char *ProfilerHud::getVertexSource() {
+    return R"(
+    #version 330 core
+    uniform vec4 m_rect;  // 叠加层在NDC中的 x0, y0, x1, y1
+    out vec2 TexCoord;
+    void main() {
+        // 三角形带的4个顶点：左下、右下、左上、右上
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        TexCoord = vec2(corner.x, 1.0 - corner.y);
+        gl_Position = vec4(mix(m_rect.xy, m_rect.zw, corner), 0.0, 1.0);
+    }
+)";
+}
+
+const char *ProfilerHud::getFragmentSource() {
+    return R"(
+    #version 330 core
+    in vec2 TexCoord;
+    out vec4 FragColor;
+    uniform sampler2D m_text;
+    void main() {
+        FragColor = texture(m_text, TexCoord);
+    }
+)";
+}
+
+bool ProfilerHud::init(GLuint program) {
+    release();
+    if (!program) return false;
+    m_program = program;
+    m_rectLocation = glGetUniformLocation(m_program, "m_rect");
+    glUseProgram(m_program);
+    glUniform1i(glGetUniformLocation(m_program, "m_text"), 0);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &m_vao);
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void ProfilerHud::release() {
+    if (m_program) {
+        glDeleteProgram(m_program);
+        m_program = 0;
+    }
+    if (m_vao) {
+        glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
+    if (m_texture) {
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+    }
+    m_width = 0;
+    m_height = 0;
+}
+
+void ProfilerHud::setText(GLStateCache &state, const std::vector<std::string> &lines) {
+    if (!m_texture) return;
+    int textWidth = 0;
+    for (const std::string &line : lines) {
+        int baseline = 0;
+        textWidth = std::max(textWidth, cv::getTextSize(line, cv::FONT_HERSHEY_PLAIN, 1.0, 1, &baseline).width);
+    }
+    int width = textWidth + 2 * MARGIN;
+    int height = (int)lines.size() * LINE_HEIGHT + 2 * MARGIN;
+    if (m_canvas.cols != width || m_canvas.rows != height) {
+        m_canvas.create(height, width, CV_8UC4);
+    }
+    m_canvas.setTo(cv::Scalar(0, 0, 0, 160));
+    for (size_t i = 0; i < lines.size(); i++) {
+        cv::Point origin(MARGIN, MARGIN + (int)(i + 1) * LINE_HEIGHT - 4);
+        cv::putText(m_canvas, lines[i], origin, cv::FONT_HERSHEY_PLAIN, 1.0, cv::Scalar(255, 255, 255, 255), 1, cv::LINE_AA);
+    }
+
+    state.bindTexture2D(0, m_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (width != m_width || height != m_height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, m_canvas.data);
+        m_width = width;
+        m_height = height;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, m_canvas.data);
+    }
+    state.countCalls(2);
+}
+
+void ProfilerHud::draw(GLStateCache &state, int viewportWidth, int viewportHeight) {
+    if (!m_visible || !m_program || m_width == 0 || viewportWidth <= 0 || viewportHeight <= 0) return;
+    float x0 = -1.0f + 2.0f * MARGIN / viewportWidth;
+    float y1 = 1.0f - 2.0f * MARGIN / viewportHeight;
+    float x1 = x0 + 2.0f * m_width / viewportWidth;
+    float y0 = y1 - 2.0f * m_height / viewportHeight;
+
+    bool depthTest = state.isDepthTestEnabled();
+    bool blend = state.isBlendEnabled();
+    state.setDepthTest(false);
+    state.setBlend(true);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    state.useProgram(m_program);
+    glUniform4f(m_rectLocation, x0, y0, x1, y1);
+    state.bindVertexArray(m_vao);
+    state.bindTexture2D(0, m_texture);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    state.countCalls(2);
+
+    state.setBlend(blend);
+    state.setDepthTest(depthTest);
+}
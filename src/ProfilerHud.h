@@ -0,0 +1,58 @@
+/**
+* @file        :ProfilerHud.h
+* @brief       :帧耗时统计的屏幕叠加层
+* @details     :文字用 cv::putText 画在一张带半透明底色的 BGRA 图像上，上传为纹理后以混合方式画在视口左上角；
+*               文字只在 setText 时更新，绘制本身只有一次程序、VAO、纹理绑定和一次4顶点的绘制
+* @date        :2026/10/17 11:30:20
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef PROFILERHUD_H
+#define PROFILERHUD_H
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <opencv2/opencv.hpp>
+
+#include "GLStateCache.h"
+
+class ProfilerHud {
+   public:
+    ProfilerHud();
+    ProfilerHud(const ProfilerHud &) = delete;
+    ProfilerHud &operator=(const ProfilerHud &) = delete;
+
+    // 叠加层着色器源码，由渲染器编译
+    static const char *getVertexSource();
+    static const char *getFragmentSource();
+
+    // 创建纹理和VAO，program 由渲染器用上面的源码创建，之后由本类持有
+    bool init(GLuint program);
+    // 删除纹理、VAO和着色器程序；GL 对象不在析构时释放，由渲染器在销毁上下文前调用
+    void release();
+
+    // 重画文字并上传，纹理尺寸随行数和最长的一行变化
+    void setText(GLStateCache &state, const std::vector<std::string> &lines);
+    // 画在 viewportWidth x viewportHeight 视口的左上角，深度测试和混合的开关经过 state 切换，画完后恢复原状态
+    void draw(GLStateCache &state, int viewportWidth, int viewportHeight);
+
+    bool isVisible() const { return m_visible; }
+    void setVisible(bool visible) { m_visible = visible; }
+
+   private:
+    GLuint m_program;
+    GLuint m_vao;      // 顶点位置由 gl_VertexID 生成，核心模式下仍需绑定VAO
+    GLuint m_texture;
+    GLint m_rectLocation;
+    int m_width;       // 纹理像素尺寸
+    int m_height;
+    bool m_visible;
+    cv::Mat m_canvas;  // 文字画布，尺寸不变时复用
+};
+
+#endif  // PROFILERHUD_H
@@ -0,0 +1,78 @@
+/**
+* @file        :ProgressiveImageLoader.cpp
+* @brief       :全景图像的渐进加载实现
+* @details     :结果只由工作线程写入，m_ready 置位之后渲染线程才读取，join 保证可见性
+* @date        :2026/10/17 10:05:30
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "ProgressiveImageLoader.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "TraceRecorder.h"
+
+ProgressiveImageLoader::ProgressiveImageLoader()
+    : m_ready(false), m_decodeMs(0.0) {
+}
+
+ProgressiveImageLoader::~ProgressiveImageLoader() {
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+bool ProgressiveImageLoader::supportsPreview(const std::string &path) {
+    std::string lower = path;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    const std::string extensions[] = {".jpg", ".jpeg"};
+    for (const auto &ext : extensions) {
+        if (lower.size() >= ext.size() && lower.compare(lower.size() - ext.size(), ext.size(), ext) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+cv::Mat ProgressiveImageLoader::decodePreview(const std::string &path) {
+    return cv::imread(path, PREVIEW_FLAGS);
+}
+
+void ProgressiveImageLoader::start(const std::string &path, bool forceTiles, int maxTextureSize) {
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+    m_ready = false;
+    m_image.release();
+    m_tiles.reset();
+    m_worker = std::thread(&ProgressiveImageLoader::decode, this, path, forceTiles, maxTextureSize);
+}
+
+cv::Mat ProgressiveImageLoader::wait() {
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+    return m_image;
+}
+
+void ProgressiveImageLoader::decode(std::string path, bool forceTiles, int maxTextureSize) {
+    TraceRecorder::instance().setThreadName("image decoder");
+    double t0 = cv::getTickCount();
+    cv::Mat image;
+    {
+        TraceScope trace("full image decode");
+        image = cv::imread(path, cv::IMREAD_COLOR);
+    }
+    // 金字塔的 cv::resize 也很耗时，同样放在后台完成
+    if (!image.empty() && (forceTiles || image.cols > maxTextureSize || image.rows > maxTextureSize)) {
+        TraceScope trace("build tile pyramid");
+        m_tiles = std::make_shared<ImageTileSource>(image);
+    }
+    m_image = image;
+    m_decodeMs = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+    m_ready = true;
+}
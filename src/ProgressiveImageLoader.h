@@ -0,0 +1,61 @@
+/**
+* @file        :ProgressiveImageLoader.h
+* @brief       :全景图像的渐进加载：先显示缩小的预览，原图在后台线程解码
+* @details     :JPEG 可以在 DCT 域按 1/2、1/4、1/8 缩小解码（IMREAD_REDUCED_COLOR_*），只需要完整解码的一小部分时间，
+*               因此窗口打开后很快就能显示预览；完整解码（需要虚拟纹理时连同金字塔）在工作线程中进行，
+*               渲染线程每帧查询一次是否完成，不等待
+* @date        :2026/10/17 10:05:30
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef PROGRESSIVEIMAGELOADER_H
+#define PROGRESSIVEIMAGELOADER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+#include "TileSource.h"
+
+class ProgressiveImageLoader {
+   public:
+    enum { PREVIEW_FLAGS = cv::IMREAD_REDUCED_COLOR_4 };  // 预览按每边1/4解码
+
+    ProgressiveImageLoader();
+    // 析构时等待后台解码结束
+    ~ProgressiveImageLoader();
+
+    // 只有 JPEG 能在解码时缩小，其它格式缩小解码并不比完整解码快，不做预览
+    static bool supportsPreview(const std::string &path);
+    // 同步解码预览，失败时返回空图像
+    static cv::Mat decodePreview(const std::string &path);
+
+    // 启动后台完整解码。图像超过 maxTextureSize 或 forceTiles 为 true 时同时在后台建立虚拟纹理的金字塔
+    void start(const std::string &path, bool forceTiles, int maxTextureSize);
+    bool isActive() const { return m_worker.joinable(); }
+    // 后台解码已经完成（无论成功与否），之后调用 wait() 不会阻塞
+    bool isReady() const { return m_ready.load(); }
+    // 等待后台解码结束，返回完整图像，失败时为空
+    cv::Mat wait();
+    // 金字塔，图像不需要虚拟纹理时为空；wait() 之后有效
+    std::shared_ptr<TileSource> getTileSource() const { return m_tiles; }
+    // 完整解码（及建立金字塔）的耗时，毫秒
+    double getDecodeMs() const { return m_decodeMs; }
+
+   private:
+    void decode(std::string path, bool forceTiles, int maxTextureSize);
+
+    std::thread m_worker;
+    std::atomic<bool> m_ready;
+    cv::Mat m_image;
+    std::shared_ptr<TileSource> m_tiles;
+    double m_decodeMs;
+};
+
+#endif  // PROGRESSIVEIMAGELOADER_H
@@ -0,0 +1,135 @@
+/**
+* @file        :RemapCache.cpp
+* @brief       :重投影查找表（LUT）缓存实现
+* @details     :unordered_map 保存查找表，std::list 维护最近使用顺序，命中时把键移到表头，淘汰时从表尾删除
+* @date        :2026/10/16 17:10:05
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "RemapCache.h"
+
+#include <cmath>
+
+static int32_t quantize(float value, float scale) {
+    return (int32_t)std::lround((double)value * scale);
+}
+
+bool RemapCache::Key::operator==(const Key &other) const {
+    for (int i = 0; i < 8; i++) {
+        if (camera[i] != other.camera[i]) return false;
+    }
+    return width == other.width && height == other.height && srcWidth == other.srcWidth && srcHeight == other.srcHeight;
+}
+
+size_t RemapCache::KeyHash::operator()(const Key &key) const {
+    // FNV-1a
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](int32_t value) {
+        hash ^= (uint32_t)value;
+        hash *= 1099511628211ull;
+    };
+    for (int i = 0; i < 8; i++) mix(key.camera[i]);
+    mix(key.width);
+    mix(key.height);
+    mix(key.srcWidth);
+    mix(key.srcHeight);
+    return (size_t)hash;
+}
+
+RemapCache::RemapCache(size_t budgetBytes)
+    : m_budget(budgetBytes), m_bytes(0), m_hits(0), m_misses(0), m_evictions(0) {
+}
+
+RemapCache::Key RemapCache::makeKey(const glm::vec3 &cameraPos, const glm::quat &cameraRot, float fov, int width, int height, int srcWidth, int srcHeight) {
+    // q 与 -q 表示同一个旋转，统一为 w>=0 的一半
+    glm::quat rot = glm::normalize(cameraRot);
+    if (rot.w < 0.0f) rot = -rot;
+
+    Key key;
+    key.camera[0] = quantize(cameraPos.x, 1e4f);
+    key.camera[1] = quantize(cameraPos.y, 1e4f);
+    key.camera[2] = quantize(cameraPos.z, 1e4f);
+    key.camera[3] = quantize(rot.w, 1e5f);
+    key.camera[4] = quantize(rot.x, 1e5f);
+    key.camera[5] = quantize(rot.y, 1e5f);
+    key.camera[6] = quantize(rot.z, 1e5f);
+    key.camera[7] = quantize(fov, 1e3f);
+    key.width = width;
+    key.height = height;
+    key.srcWidth = srcWidth;
+    key.srcHeight = srcHeight;
+    return key;
+}
+
+std::shared_ptr<const RemapTable> RemapCache::find(const Key &key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_tables.find(key);
+    if (it == m_tables.end()) {
+        m_misses++;
+        return nullptr;
+    }
+    m_hits++;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return it->second.table;
+}
+
+void RemapCache::insert(const Key &key, std::shared_ptr<const RemapTable> table) {
+    if (!table || table->bytes() > m_budget) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_tables.find(key);
+    if (it != m_tables.end()) {
+        // 多个线程同时未命中并各自建表时，保留先插入的那个
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+        return;
+    }
+    m_lru.push_front(key);
+    Slot slot;
+    slot.table = table;
+    slot.lru = m_lru.begin();
+    m_tables[key] = slot;
+    m_bytes += table->bytes();
+    evictLocked();
+}
+
+void RemapCache::evictLocked() {
+    while (m_bytes > m_budget && !m_lru.empty()) {
+        auto it = m_tables.find(m_lru.back());
+        m_bytes -= it->second.table->bytes();
+        m_tables.erase(it);
+        m_lru.pop_back();
+        m_evictions++;
+    }
+}
+
+void RemapCache::setBudget(size_t budgetBytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = budgetBytes;
+    evictLocked();
+}
+
+void RemapCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tables.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+RemapCache::Stats RemapCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    stats.entries = m_tables.size();
+    stats.bytes = m_bytes;
+    return stats;
+}
+
+void RemapCache::resetStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hits = m_misses = m_evictions = 0;
+}
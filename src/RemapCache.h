@@ -0,0 +1,105 @@
+/**
+* @file        :RemapCache.h
+* @brief       :重投影查找表（LUT）缓存
+* @details     :同一相机参数和输出尺寸下，每个输出像素对应的源图位置是固定的。查找表保存每个像素的定点源坐标（两行的像素索引）
+*               和8位双线性权重，命中后渲染只剩一次按表取像素的过程，不再做三角函数运算（在只有标量或 SSE 内核的机器上收益最大）。
+*               缓存按 getAnimationMatrices 的输入（相机位置、朝向、fov）加输出和源图尺寸作键，按最近最少使用淘汰，
+*               总内存不超过预算；查找表以 shared_ptr 交出，被淘汰时正在使用它的线程不受影响。所有接口线程安全
+* @date        :2026/10/16 17:10:05
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef REMAPCACHE_H
+#define REMAPCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+// 一个输出像素的采样信息，12字节
+struct RemapEntry {
+    enum { WRAP = 1,       // 右侧像素在经度接缝另一侧（x1 = 0）
+           INVALID = 2 };  // 视线与球无交点，输出背景色
+    uint32_t offset0;  // 左上像素在源图中的索引
+    uint32_t offset1;  // 左下像素的索引（下一行，在最后一行时钳位为同一行）
+    uint8_t fx;        // 水平权重，x1 的权重为 fx/256
+    uint8_t fy;        // 垂直权重，下一行的权重为 fy/256
+    uint8_t flags;
+    uint8_t reserved;
+};
+
+struct RemapTable {
+    int width = 0;      // 输出宽
+    int height = 0;     // 输出高
+    int srcWidth = 0;   // 建表时的源图宽，WRAP 像素的右侧偏移为 1 - srcWidth
+    std::vector<RemapEntry> entries;
+    size_t bytes() const { return entries.size() * sizeof(RemapEntry); }
+};
+
+class RemapCache {
+   public:
+    // 量化后的相机参数和尺寸，量化步长远小于一个像素对应的角度，因此相同键的查找表可以通用
+    struct Key {
+        int32_t camera[8];  // 位置 x,y,z（1e-4），朝向四元数 w,x,y,z（1e-5，w>=0），fov（1e-3 度）
+        int width, height;
+        int srcWidth, srcHeight;
+        bool operator==(const Key &other) const;
+    };
+
+    struct Stats {
+        long hits = 0;
+        long misses = 0;
+        long evictions = 0;
+        size_t entries = 0;  // 当前缓存的查找表个数
+        size_t bytes = 0;    // 当前占用的内存
+        double hitRate() const { return hits + misses > 0 ? (double)hits / (hits + misses) : 0.0; }
+    };
+
+    explicit RemapCache(size_t budgetBytes = 256u << 20);
+
+    static Key makeKey(const glm::vec3 &cameraPos, const glm::quat &cameraRot, float fov, int width, int height, int srcWidth, int srcHeight);
+
+    // 查找并标记为最近使用，未命中返回空指针；命中与未命中都会计数
+    std::shared_ptr<const RemapTable> find(const Key &key);
+    // 插入新建的查找表，超出预算时从最久未使用的开始淘汰（单个超过预算的表不缓存）
+    void insert(const Key &key, std::shared_ptr<const RemapTable> table);
+
+    void setBudget(size_t budgetBytes);
+    size_t getBudget() const { return m_budget; }
+    void clear();
+    Stats getStats() const;
+    void resetStats();
+
+   private:
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+    typedef std::list<Key> LruList;  // 表头为最近使用
+    struct Slot {
+        std::shared_ptr<const RemapTable> table;
+        LruList::iterator lru;
+    };
+
+    void evictLocked();
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<Key, Slot, KeyHash> m_tables;
+    LruList m_lru;
+    size_t m_budget;
+    size_t m_bytes;
+    long m_hits;
+    long m_misses;
+    long m_evictions;
+};
+
+#endif  // REMAPCACHE_H
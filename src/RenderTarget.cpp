@@ -0,0 +1,95 @@
+/**
+* @file        :RenderTarget.cpp
+* @brief       :按输出尺寸离屏渲染的帧缓冲区实现
+* @details     :线性过滤的 blit 在源尺寸恰好是目标两倍时，每个目标像素的采样点落在四个源像素中心之间，等价于2x2盒式滤波；
+*               4倍超采样分两级完成，避免一次缩小4倍时只采到16个像素中的4个
+* @date        :2026/10/16 19:55:30
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "RenderTarget.h"
+
+#include <iostream>
+
+RenderTarget::RenderTarget()
+    : m_depthBuffer(0), m_width(0), m_height(0), m_supersample(1) {
+}
+
+bool RenderTarget::create(int width, int height, int supersample) {
+    release();
+
+    if (supersample < 1) supersample = 1;
+    int factor = 1;
+    while (factor * 2 <= supersample && factor < 4) factor *= 2;
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+    while (factor > 1 && (width * factor > maxSize || height * factor > maxSize)) factor /= 2;
+    if (factor != supersample) {
+        std::cerr << "Supersample x" << supersample << " not available for " << width << "x" << height << ", use x" << factor << "." << std::endl;
+    }
+    m_width = width;
+    m_height = height;
+    m_supersample = factor;
+
+    for (int scale = factor; scale >= 1; scale /= 2) {
+        Level level;
+        level.width = width * scale;
+        level.height = height * scale;
+        glGenFramebuffers(1, &level.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, level.framebuffer);
+        glGenRenderbuffers(1, &level.colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, level.colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, level.width, level.height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, level.colorBuffer);
+        if (m_levels.empty()) {
+            glGenRenderbuffers(1, &m_depthBuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, level.width, level.height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+        }
+        m_levels.push_back(level);
+
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Export framebuffer not complete! Error code: " << status << std::endl;
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+            release();
+            return false;
+        }
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    return true;
+}
+
+void RenderTarget::release() {
+    for (Level &level : m_levels) {
+        glDeleteFramebuffers(1, &level.framebuffer);
+        glDeleteRenderbuffers(1, &level.colorBuffer);
+    }
+    m_levels.clear();
+    if (m_depthBuffer) {
+        glDeleteRenderbuffers(1, &m_depthBuffer);
+        m_depthBuffer = 0;
+    }
+}
+
+void RenderTarget::bind() {
+    if (m_levels.empty()) return;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_levels[0].framebuffer);
+    glViewport(0, 0, m_levels[0].width, m_levels[0].height);
+}
+
+void RenderTarget::resolve() {
+    if (m_levels.empty()) return;
+    for (size_t i = 1; i < m_levels.size(); i++) {
+        const Level &src = m_levels[i - 1];
+        const Level &dst = m_levels[i];
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, src.framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dst.framebuffer);
+        glBlitFramebuffer(0, 0, src.width, src.height, 0, 0, dst.width, dst.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_levels.back().framebuffer);
+}
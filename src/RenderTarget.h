@@ -0,0 +1,58 @@
+/**
+* @file        :RenderTarget.h
+* @brief       :按输出尺寸离屏渲染的帧缓冲区
+* @details     :导出视频时不再依赖窗口大小：直接在输出尺寸（或其整数倍的超采样尺寸）的帧缓冲区中渲染，
+*               超采样时在GPU上用线性过滤的 glBlitFramebuffer 逐级缩小一半（每级正好是2x2的平均），
+*               最终得到输出尺寸的图像，CPU 只回读一次，不需要再 cv::resize
+* @date        :2026/10/16 19:55:30
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef RENDERTARGET_H
+#define RENDERTARGET_H
+
+#include <vector>
+#include <GL/glew.h>
+
+class RenderTarget {
+   public:
+    RenderTarget();
+    RenderTarget(const RenderTarget &) = delete;
+    RenderTarget &operator=(const RenderTarget &) = delete;
+
+    // 创建 width x height 的输出帧缓冲区；supersample 为每个方向的超采样倍数，只支持 1、2、4，
+    // 其它值取不超过它的2的幂，超出 GL_MAX_RENDERBUFFER_SIZE 时自动降低
+    bool create(int width, int height, int supersample = 1);
+    // 删除帧缓冲区和渲染缓冲区；析构函数不做这件事，必须在上下文还有效时显式调用
+    void release();
+
+    // 绑定渲染用的帧缓冲区（超采样尺寸，带深度）并设置视口
+    void bind();
+    // 把渲染结果缩小到输出尺寸，之后输出帧缓冲区绑定为 GL_READ_FRAMEBUFFER，可直接 glReadPixels
+    void resolve();
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    int getSupersample() const { return m_supersample; }
+
+   private:
+    // 每一级是一个只有颜色附件的帧缓冲区，第0级为渲染尺寸并带深度附件，最后一级为输出尺寸
+    struct Level {
+        GLuint framebuffer;
+        GLuint colorBuffer;
+        int width;
+        int height;
+    };
+
+    std::vector<Level> m_levels;
+    GLuint m_depthBuffer;
+    int m_width;
+    int m_height;
+    int m_supersample;
+};
+
+#endif  // RENDERTARGET_H
@@ -1,79 +1,282 @@
 #include "Sphere.h"
+#include <algorithm>
 #include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include "SphereTables.h"
 
-SphereData::SphereData(float radius, unsigned int rings, unsigned int sectors) {
+// 三角形带中的重启标记，转换为16位索引时变为 0xFFFF
+static const GLuint RESTART_INDEX = 0xFFFFFFFF;
+
+// Tipsify（Sander 等, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007）：
+// 以一个顶点为扇心输出它所有未输出的三角形，再从刚进入缓存、且剩余三角形还能在缓存中处理完的顶点里选下一个扇心，
+// 找不到时回退到最近输出过且仍有剩余三角形的顶点，线性时间
+static std::vector<GLuint> tipsify(const std::vector<GLuint>& indices, int numVertices, int cacheSize) {
+    int numTriangles = (int)indices.size() / 3;
+
+    // 每个顶点所属的三角形列表
+    std::vector<int> offsets(numVertices + 1, 0);
+    for (GLuint index : indices) offsets[index + 1]++;
+    for (int v = 0; v < numVertices; v++) offsets[v + 1] += offsets[v];
+    std::vector<int> adjacency(indices.size());
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int t = 0; t < numTriangles; t++) {
+        for (int k = 0; k < 3; k++) adjacency[fill[indices[3 * t + k]]++] = t;
+    }
+
+    std::vector<int> liveTriangles(numVertices);
+    for (int v = 0; v < numVertices; v++) liveTriangles[v] = offsets[v + 1] - offsets[v];
+    std::vector<int> cacheTime(numVertices, 0);
+    std::vector<char> emitted(numTriangles, 0);
+    std::vector<int> deadEnd;
+    std::vector<int> candidates;
+    std::vector<GLuint> output;
+    output.reserve(indices.size());
+
+    int fanning = 0;
+    int timeStamp = cacheSize + 1;
+    int cursor = 1;
+    while (fanning >= 0) {
+        candidates.clear();
+        for (int i = offsets[fanning]; i < offsets[fanning + 1]; i++) {
+            int t = adjacency[i];
+            if (emitted[t]) continue;
+            for (int k = 0; k < 3; k++) {
+                int v = indices[3 * t + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (timeStamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timeStamp++;
+                }
+            }
+            emitted[t] = 1;
+        }
+
+        // 优先选在缓存中停留最久、但剩余三角形仍能在被挤出前处理完的候选顶点
+        int next = -1;
+        int bestPriority = -1;
+        for (int v : candidates) {
+            if (liveTriangles[v] <= 0) continue;
+            int priority = 0;
+            if (timeStamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = timeStamp - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+        if (next == -1) {
+            while (!deadEnd.empty()) {
+                int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0) {
+                    next = v;
+                    break;
+                }
+            }
+        }
+        while (next == -1 && cursor < numVertices) {
+            if (liveTriangles[cursor] > 0) next = cursor;
+            cursor++;
+        }
+        fanning = next;
+    }
+    return output;
+}
+
+SphereData::SphereData(float radius, unsigned int rings, unsigned int sectors, SphereIndexOrder order) {
     m_rings = rings;
     m_sectors = sectors;
-    numVertices = rings * sectors * 3;
-    numTexs = rings * sectors * 2;
-    numIndices = (rings - 1) * (sectors - 1) * 6;
+    m_order = order;
+    m_vertices.resize((size_t)rings * sectors);
 
-    vertices = new GLfloat[numVertices];
-    texCoords = new GLfloat[numTexs];
-    indices = new GLushort[numIndices];
+    // 经纬方向可分离：每个纬线和经线的正余弦只算一次，常用配置直接取编译期生成的表
+    sphere_tables::TrigTable table;
+    std::vector<float> trig;
+    if (!sphere_tables::findTrigTable(rings, sectors, table)) {
+        trig.resize(2 * (rings + sectors));
+        float* ringSin = trig.data();
+        float* ringCos = ringSin + rings;
+        float* sectorSin = ringCos + rings;
+        float* sectorCos = sectorSin + sectors;
+        for (unsigned int r = 0; r < rings; r++) {
+            ringSin[r] = sin(PI * r / (float)(rings - 1));
+            ringCos[r] = cos(PI * r / (float)(rings - 1));
+        }
+        for (unsigned int s = 0; s < sectors; s++) {
+            sectorSin[s] = sin(2 * PI * s / (float)(sectors - 1));
+            sectorCos[s] = cos(2 * PI * s / (float)(sectors - 1));
+        }
+        table = sphere_tables::TrigTable{ringSin, ringCos, sectorSin, sectorCos};
+    }
 
     float const R = 1.0f / (float)(rings - 1);
     float const S = 1.0f / (float)(sectors - 1);
-    int v = 0, t = 0, i = 0;
+    size_t v = 0;
     for (unsigned int r = 0; r < rings; r++) {
         for (unsigned int s = 0; s < sectors; s++) {
-            float y = sin(-PI / 2.0f + PI * r * R);
-            float x = cos(2 * PI * s * S) * sin(PI * r * R);
-            float z = sin(2 * PI * s * S) * sin(PI * r * R);
+            // y = sin(-PI/2 + PI*r*R) = -cos(PI*r*R)
+            float y = -table.ringCos[r];
+            float x = table.sectorCos[s] * table.ringSin[r];
+            float z = table.sectorSin[s] * table.ringSin[r];
 
             // float z = sin(-PI / 2.0f + PI * r * R);
             // float y = cos(-PI / 2.0f + PI * r * R) * sin(2.0f * PI * s * S);
             // float x = cos(-PI / 2.0f + PI * r * R) * cos(2.0f * PI * s * S);
 
-            texCoords[t++] = s * S;
-            texCoords[t++] = r * R;
+            SphereVertex& vertex = m_vertices[v++];
+            vertex.x = x * radius;
+            vertex.y = y * radius;
+            vertex.z = z * radius;
+            vertex.u = s * S;
+            vertex.v = r * R;
+        }
+    }
 
-            vertices[v++] = x * radius;
-            vertices[v++] = y * radius;
-            vertices[v++] = z * radius;
+    // 先统一生成32位索引，顶点数在16位范围内时再转换，少占一半显存和带宽
+    if (m_order == SphereIndexOrder::STRIP) {
+        buildStrips();
+    } else {
+        buildTriangleList();
+        if (m_order == SphereIndexOrder::TIPSIFY) {
+            m_indices32 = tipsify(m_indices32, getNumVertices(), VERTEX_CACHE_SIZE);
         }
     }
+    if (m_order != SphereIndexOrder::ROW_MAJOR) {
+        reorderVertices();
+    }
+    // 16位时 0xFFFF 留作重启索引
+    if (m_vertices.size() < 65536) {
+        m_indices16.resize(m_indices32.size());
+        for (size_t i = 0; i < m_indices32.size(); i++) {
+            m_indices16[i] = m_indices32[i] == RESTART_INDEX ? 0xFFFF : (GLushort)m_indices32[i];
+        }
+        std::vector<GLuint>().swap(m_indices32);
+    }
+}
+
+std::shared_ptr<const SphereData> SphereData::getShared(float radius, unsigned int rings, unsigned int sectors, SphereIndexOrder order) {
+    typedef std::tuple<float, unsigned int, unsigned int, int> Key;
+    static std::mutex mutex;
+    static std::map<Key, std::weak_ptr<const SphereData>> instances;
 
-    for (unsigned int r = 0; r < rings - 1; r++) {
-        for (unsigned int s = 0; s < sectors - 1; s++) {
-            indices[i++] = r * sectors + s;
-            indices[i++] = r * sectors + (s + 1);
-            indices[i++] = (r + 1) * sectors + (s + 1);
-            indices[i++] = r * sectors + s;
-            indices[i++] = (r + 1) * sectors + (s + 1);
-            indices[i++] = (r + 1) * sectors + s;
+    Key key(radius, rings, sectors, (int)order);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const SphereData> sphere = instances[key].lock();
+    if (!sphere) {
+        sphere = std::make_shared<const SphereData>(radius, rings, sectors, order);
+        instances[key] = sphere;
+    }
+    return sphere;
+}
+
+void SphereData::buildTriangleList() {
+    m_indices32.reserve((size_t)(m_rings - 1) * (m_sectors - 1) * 6);
+    for (unsigned int r = 0; r < m_rings - 1; r++) {
+        for (unsigned int s = 0; s < m_sectors - 1; s++) {
+            m_indices32.push_back(r * m_sectors + s);
+            m_indices32.push_back(r * m_sectors + (s + 1));
+            m_indices32.push_back((r + 1) * m_sectors + (s + 1));
+            m_indices32.push_back(r * m_sectors + s);
+            m_indices32.push_back((r + 1) * m_sectors + (s + 1));
+            m_indices32.push_back((r + 1) * m_sectors + s);
         }
     }
+    m_numTriangles = (int)m_indices32.size() / 3;
 }
 
-SphereData::~SphereData() {
-    delete[] vertices;
-    delete[] texCoords;
-    delete[] indices;
+void SphereData::buildStrips() {
+    // 整行的带在经线数大于缓存时，上一行的顶点到下一行时已被挤出缓存；按列分成宽度为缓存大小减3的块，
+    // 块内逐行生成三角形带，上一条带的下边顶点正好还在缓存中
+    unsigned int blockWidth = VERTEX_CACHE_SIZE - 3;
+    unsigned int quads = m_sectors - 1;
+    m_numTriangles = 0;
+    for (unsigned int s0 = 0; s0 < quads; s0 += blockWidth) {
+        unsigned int s1 = std::min(s0 + blockWidth, quads);
+        // 每块的第一条带会同时载入两行顶点，被复用的那一行在下一条带用到前就已被挤出，此后每行都全部未命中；
+        // 先用一条只含第0行顶点的带把这一行放进缓存。第0行全部位于极点，这些三角形面积为0，不会产生片元
+        if (!m_indices32.empty()) m_indices32.push_back(RESTART_INDEX);
+        m_indices32.push_back(s0);
+        for (unsigned int s = s0; s <= s1; s++) {
+            m_indices32.push_back(s);
+        }
+        for (unsigned int r = 0; r < m_rings - 1; r++) {
+            m_indices32.push_back(RESTART_INDEX);
+            // 先下一行再本行，与三角形列表的绕序相同
+            for (unsigned int s = s0; s <= s1; s++) {
+                m_indices32.push_back((r + 1) * m_sectors + s);
+                m_indices32.push_back(r * m_sectors + s);
+            }
+            m_numTriangles += 2 * (s1 - s0);
+        }
+    }
 }
 
-const GLfloat* SphereData::getVertices() const {
-    return vertices;
+void SphereData::reorderVertices() {
+    std::vector<GLuint> remap(m_vertices.size(), RESTART_INDEX);
+    std::vector<SphereVertex> vertices;
+    vertices.reserve(m_vertices.size());
+    for (GLuint& index : m_indices32) {
+        if (index == RESTART_INDEX) continue;
+        if (remap[index] == RESTART_INDEX) {
+            remap[index] = (GLuint)vertices.size();
+            vertices.push_back(m_vertices[index]);
+        }
+        index = remap[index];
+    }
+    m_vertices.swap(vertices);
 }
 
-const GLfloat* SphereData::getTexCoords() const {
-    return texCoords;
+double SphereData::measureACMR(int cacheSize) const {
+    if (m_numTriangles == 0) return 0.0;
+    // FIFO 缓存：记录每个顶点进入缓存时的未命中序号，之后又有 cacheSize 次未命中即被挤出
+    std::vector<long> insertedAt(m_vertices.size(), -1);
+    long misses = 0;
+    GLuint restart = getRestartIndex();
+    for (int i = 0; i < getNumIndices(); i++) {
+        GLuint index = m_indices16.empty() ? m_indices32[i] : m_indices16[i];
+        if (index == restart) continue;
+        if (insertedAt[index] < 0 || misses - insertedAt[index] >= cacheSize) {
+            insertedAt[index] = misses++;
+        }
+    }
+    return (double)misses / m_numTriangles;
 }
 
-const GLushort* SphereData::getIndices() const {
-    return indices;
+const SphereVertex* SphereData::getVertexData() const {
+    return m_vertices.data();
 }
 
 int SphereData::getNumVertices() const {
-    return numVertices;
+    return (int)m_vertices.size();
+}
+
+GLenum SphereData::getIndexType() const {
+    return m_indices16.empty() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+}
+
+const void* SphereData::getIndices() const {
+    return m_indices16.empty() ? (const void*)m_indices32.data() : (const void*)m_indices16.data();
 }
 
-int SphereData::getNumTexs() const {
-    return numTexs;
+GLsizeiptr SphereData::getIndexBufferSize() const {
+    return m_indices16.empty() ? m_indices32.size() * sizeof(GLuint) : m_indices16.size() * sizeof(GLushort);
 }
 
 int SphereData::getNumIndices() const {
-    return numIndices;
+    return m_indices16.empty() ? (int)m_indices32.size() : (int)m_indices16.size();
+}
+
+GLenum SphereData::getPrimitiveType() const {
+    return m_order == SphereIndexOrder::STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+}
+
+GLuint SphereData::getRestartIndex() const {
+    return m_indices16.empty() ? RESTART_INDEX : 0xFFFF;
 }
 
 int SphereData::getRings() const {
@@ -83,3 +286,25 @@ int SphereData::getRings() const {
 int SphereData::getSectors() const {
     return m_sectors;
 }
+
+const char* SphereData::indexOrderName(SphereIndexOrder order) {
+    switch (order) {
+        case SphereIndexOrder::ROW_MAJOR:
+            return "list";
+        case SphereIndexOrder::TIPSIFY:
+            return "tipsify";
+        case SphereIndexOrder::STRIP:
+            return "strip";
+    }
+    return "unknown";
+}
+
+bool SphereData::parseIndexOrder(const std::string& name, SphereIndexOrder& order) {
+    for (SphereIndexOrder o : {SphereIndexOrder::ROW_MAJOR, SphereIndexOrder::TIPSIFY, SphereIndexOrder::STRIP}) {
+        if (name == indexOrderName(o)) {
+            order = o;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,32 +1,71 @@
 #ifndef SPHERE_DATA_H
 #define SPHERE_DATA_H
 
+#include <memory>
+#include <string>
+#include <vector>
 #include <GL/glew.h>
 //#include <GLES3/gl3.h>
 
 #define PI 3.14159265358979323846f
+
+// 交错存储的顶点：位置和纹理坐标放在一起，一次读取一个顶点只访问一段连续内存
+struct SphereVertex {
+    GLfloat x, y, z;  // 位置
+    GLfloat u, v;     // 纹理坐标
+};
+
+// 球体网格的索引组织方式
+enum class SphereIndexOrder { ROW_MAJOR,  // 逐行的三角形列表，每个四边形6个索引
+                              TIPSIFY,    // 三角形列表按 Tipsify 算法重排，提高顶点变换缓存的命中率
+                              STRIP };    // 按列分块的三角形带，每块每行一条带，带之间用图元重启分隔
+
 class SphereData {
    public:
-    SphereData(float radius, unsigned int rings, unsigned int sectors);
-    ~SphereData();
+    // 估计的顶点变换缓存大小（FIFO），用于重排索引和统计 ACMR，低端集显通常在16左右
+    enum { VERTEX_CACHE_SIZE = 16 };
+
+    SphereData(float radius, unsigned int rings, unsigned int sectors, SphereIndexOrder order = SphereIndexOrder::ROW_MAJOR);
+
+    // 进程内共享的只读网格：相同参数的网格只要还有持有者就不会重复生成，多个渲染器实例共用一份几何数据
+    static std::shared_ptr<const SphereData> getShared(float radius, unsigned int rings, unsigned int sectors, SphereIndexOrder order = SphereIndexOrder::ROW_MAJOR);
 
-    const GLfloat* getVertices() const;
-    const GLfloat* getTexCoords() const;
-    const GLushort* getIndices() const;
-    int getNumVertices() const;
+    const SphereVertex* getVertexData() const;
+    int getNumVertices() const;  // 顶点个数
+    static GLsizei getVertexStride() { return sizeof(SphereVertex); }
+
+    // 顶点数小于65536时索引为 GL_UNSIGNED_SHORT，否则为 GL_UNSIGNED_INT
+    GLenum getIndexType() const;
+    const void* getIndices() const;
+    GLsizeiptr getIndexBufferSize() const;  // 索引数据的字节数
     int getNumIndices() const;
-    int getNumTexs() const;
+
+    // GL_TRIANGLES 或 GL_TRIANGLE_STRIP，三角形带需要启用图元重启，重启索引为索引类型的最大值
+    GLenum getPrimitiveType() const;
+    GLuint getRestartIndex() const;
+    SphereIndexOrder getIndexOrder() const { return m_order; }
+    int getNumTriangles() const { return m_numTriangles; }
+
+    // 按 cacheSize 大小的 FIFO 顶点缓存模拟绘制，返回平均每个三角形的缓存未命中次数（ACMR），理想的规则网格接近0.5
+    double measureACMR(int cacheSize = VERTEX_CACHE_SIZE) const;
 
     int getRings() const;
     int getSectors() const;
 
+    static const char* indexOrderName(SphereIndexOrder order);
+    static bool parseIndexOrder(const std::string& name, SphereIndexOrder& order);
+
    private:
-    GLfloat* vertices;
-    GLfloat* texCoords;
-    GLushort* indices;
-    int numVertices;
-    int numIndices;
-    int numTexs;
+    void buildTriangleList();
+    void buildStrips();
+    // 按第一次被引用的顺序给顶点重新编号，使顶点读取也基本顺序访问显存
+    void reorderVertices();
+
+    std::vector<SphereVertex> m_vertices;
+    std::vector<GLushort> m_indices16;
+    std::vector<GLuint> m_indices32;
+    SphereIndexOrder m_order;
+    int m_numTriangles;
 
     GLuint m_rings;
     GLuint m_sectors;
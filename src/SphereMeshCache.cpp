@@ -0,0 +1,93 @@
+/**
+* @file        :SphereMeshCache.cpp
+* @brief       :按视场角选择细节级别的球体网格缓存实现
+* @details     :误差估计：相邻顶点夹角为 d、h = d/2 时，相机在球心看到的平面三角形上纹理的最大角度偏差约为 0.128*h^3；
+*               相机偏离球心时弦与球面之间的距离 h^2/2 还会产生视差，按可见表面到相机的最近距离换算成角度
+* @date        :2026/10/16 21:40:10
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "SphereMeshCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+
+SphereMeshCache::SphereMeshCache()
+    : m_indexOrder(SphereIndexOrder::STRIP), m_report(false) {
+}
+
+int SphereMeshCache::selectLevel(float fovY, int viewportHeight, float eyeDistance) {
+    if (viewportHeight <= 0) return 0;
+    float maxError = 0.5f * fovY / viewportHeight;  // 半个像素对应的角度
+    // 小行星（相机在球面上）和水晶球（相机在球外1.5倍半径处）视角中，可见表面离相机都不小于约半个半径
+    float offset = std::min(eyeDistance, 1.0f);
+    float surfaceDistance = std::max(std::fabs(1.0f - eyeDistance), 0.5f);
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        float h = PI / getSectors(level);
+        float error = 0.128f * h * h * h;
+        if (offset > 0.01f) {
+            error += offset * 0.5f * h * h / surfaceDistance;
+        }
+        if (error <= maxError) return level;
+    }
+    return LEVEL_COUNT - 1;
+}
+
+bool SphereMeshCache::isBuilt(int level) const {
+    return level >= 0 && level < LEVEL_COUNT && m_meshes[level].vao != 0;
+}
+
+void SphereMeshCache::build(int level) {
+    if (level < 0 || level >= LEVEL_COUNT || isBuilt(level)) return;
+
+    int sectors = getSectors(level);
+    Mesh &mesh = m_meshes[level];
+    // 同一进程中的其它渲染器已生成过同样的网格时直接共用
+    mesh.data = SphereData::getShared(1.0f, sectors / 2 + 1, sectors, m_indexOrder);
+    const SphereData &sphere = *mesh.data;
+    mesh.rings = sphere.getRings();
+    mesh.sectors = sphere.getSectors();
+    mesh.primitiveType = sphere.getPrimitiveType();
+    mesh.indexType = sphere.getIndexType();
+    mesh.restartIndex = sphere.getRestartIndex();
+    mesh.numIndices = sphere.getNumIndices();
+    if (m_report) {
+        printf("[mesh] level %d: %dx%d, %d vertices, %d triangles, %s with %d-bit indices, ACMR %.3f (FIFO %d)\n", level, mesh.sectors, mesh.rings, sphere.getNumVertices(), sphere.getNumTriangles(),
+               SphereData::indexOrderName(m_indexOrder), mesh.indexType == GL_UNSIGNED_INT ? 32 : 16, sphere.measureACMR(), (int)SphereData::VERTEX_CACHE_SIZE);
+    }
+
+    glGenVertexArrays(1, &mesh.vao);
+    glGenBuffers(1, &mesh.vbo);
+    glGenBuffers(1, &mesh.ibo);
+    glBindVertexArray(mesh.vao);
+
+    // 位置和纹理坐标交错存放在同一个缓冲区
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sphere.getNumVertices() * SphereData::getVertexStride(), sphere.getVertexData(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, SphereData::getVertexStride(), (const void *)offsetof(SphereVertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, SphereData::getVertexStride(), (const void *)offsetof(SphereVertex, u));
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere.getIndexBufferSize(), sphere.getIndices(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SphereMeshCache::release() {
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        Mesh &mesh = m_meshes[level];
+        if (mesh.vao == 0) continue;
+        glDeleteBuffers(1, &mesh.vbo);
+        glDeleteBuffers(1, &mesh.ibo);
+        glDeleteVertexArrays(1, &mesh.vao);
+        mesh = Mesh();
+    }
+}
@@ -0,0 +1,68 @@
+/**
+* @file        :SphereMeshCache.h
+* @brief       :按视场角选择细节级别的球体网格缓存
+* @details     :用平面三角形近似球面会使纹理偏离正确位置，偏差随相邻顶点夹角的立方（相机在球心时）或平方（相机偏离球心时）增长，
+*               视场角越小，一个像素对应的角度越小，同样的网格误差在屏幕上越明显。这里按经线数 64、128、256、512 预设四个级别，
+*               每帧根据视场角和视口高度选出误差不超过半个像素的最粗级别；每个级别的顶点和索引缓冲区只在第一次用到时生成一次，之后一直复用
+* @date        :2026/10/16 21:40:10
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef SPHEREMESHCACHE_H
+#define SPHEREMESHCACHE_H
+
+#include <memory>
+#include <GL/glew.h>
+#include "Sphere.h"
+
+class SphereMeshCache {
+   public:
+    enum { LEVEL_COUNT = 4 };
+
+    // 一个细节级别的 GL 对象，VAO 中顶点属性0为位置，1为纹理坐标
+    struct Mesh {
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLuint ibo = 0;
+        GLenum primitiveType = GL_TRIANGLES;
+        GLenum indexType = GL_UNSIGNED_SHORT;
+        GLuint restartIndex = 0xFFFF;  // 图元重启索引，为索引类型的最大值
+        GLsizei numIndices = 0;
+        int rings = 0;
+        int sectors = 0;
+        std::shared_ptr<const SphereData> data;  // 共享的CPU端网格，持有期间其它渲染器生成同一级别时不再重新计算
+    };
+
+    SphereMeshCache();
+    SphereMeshCache(const SphereMeshCache &) = delete;
+    SphereMeshCache &operator=(const SphereMeshCache &) = delete;
+
+    // 选择误差不超过半个像素的最粗级别。fovY 为垂直视场角（弧度），viewportHeight 为渲染的像素高度，
+    // eyeDistance 为相机到球心的距离（单位球半径为1），相机在球心时为0
+    static int selectLevel(float fovY, int viewportHeight, float eyeDistance);
+    // 级别 level 的经线数，纬线数取其一半加1，使经纬方向的顶点间隔相同
+    static int getSectors(int level) { return 64 << level; }
+
+    // 之后生成的级别使用的索引组织方式，已生成的级别不受影响
+    void setIndexOrder(SphereIndexOrder order) { m_indexOrder = order; }
+    // 生成每个级别时打印顶点数、三角形数和模拟的顶点缓存 ACMR
+    void setReport(bool report) { m_report = report; }
+
+    bool isBuilt(int level) const;
+    // 生成级别 level 的网格并上传，会改变当前绑定的 VAO 和缓冲区；已生成时不做任何事
+    void build(int level);
+    const Mesh &getMesh(int level) const { return m_meshes[level]; }
+    // 删除所有已生成级别的VAO和缓冲区，必须在 OpenGL 上下文销毁前由持有者调用
+    void release();
+
+   private:
+    Mesh m_meshes[LEVEL_COUNT];
+    SphereIndexOrder m_indexOrder;
+    bool m_report;
+};
+
+#endif  // SPHEREMESHCACHE_H
@@ -0,0 +1,103 @@
+/**
+* @file        :SphereTables.h
+* @brief       :编译期生成的球体网格三角函数表
+* @details     :球面顶点 x = cos(经度)*sin(极角)，y = -cos(极角)，z = sin(经度)*sin(极角)，经纬方向可分离，
+*               因此每种 (rings, sectors) 只需要 rings 个极角和 sectors 个经度的正余弦。常用配置（各细节级别和 50x50）的表
+*               由 constexpr 函数在编译期算好放在只读数据段，构造 SphereData 时不再调用 sin/cos，只剩乘法；其它配置 findTrigTable 返回 false，运行时计算
+* @date        :2026/10/16 22:35:20
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef SPHERETABLES_H
+#define SPHERETABLES_H
+
+namespace sphere_tables {
+
+constexpr double PI_D = 3.14159265358979323846;
+
+// 泰勒级数，输入先归约到 [-π, π]，14项时误差小于 1e-14，远小于 float 精度
+constexpr double sinConstexpr(double x) {
+    while (x > PI_D) x -= 2.0 * PI_D;
+    while (x < -PI_D) x += 2.0 * PI_D;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 14; n++) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cosConstexpr(double x) {
+    return sinConstexpr(x + PI_D / 2.0);
+}
+
+// 不依赖模板参数的表视图，供 SphereData 使用
+struct TrigTable {
+    const float *ringSin;    // sin(π*r/(rings-1))
+    const float *ringCos;    // cos(π*r/(rings-1))
+    const float *sectorSin;  // sin(2π*s/(sectors-1))
+    const float *sectorCos;  // cos(2π*s/(sectors-1))
+};
+
+template <unsigned Rings, unsigned Sectors>
+struct TrigTableData {
+    float ringSin[Rings];
+    float ringCos[Rings];
+    float sectorSin[Sectors];
+    float sectorCos[Sectors];
+};
+
+template <unsigned Rings, unsigned Sectors>
+constexpr TrigTableData<Rings, Sectors> makeTrigTable() {
+    TrigTableData<Rings, Sectors> data{};
+    for (unsigned r = 0; r < Rings; r++) {
+        double angle = PI_D * r / (Rings - 1);
+        data.ringSin[r] = (float)sinConstexpr(angle);
+        data.ringCos[r] = (float)cosConstexpr(angle);
+    }
+    for (unsigned s = 0; s < Sectors; s++) {
+        double angle = 2.0 * PI_D * s / (Sectors - 1);
+        data.sectorSin[s] = (float)sinConstexpr(angle);
+        data.sectorCos[s] = (float)cosConstexpr(angle);
+    }
+    return data;
+}
+
+// 每种配置一份静态表，只有被 findTrigTable 引用的配置才会实例化
+template <unsigned Rings, unsigned Sectors>
+struct StaticTrigTable {
+    static constexpr TrigTableData<Rings, Sectors> data = makeTrigTable<Rings, Sectors>();
+    static TrigTable view() { return TrigTable{data.ringSin, data.ringCos, data.sectorSin, data.sectorCos}; }
+};
+
+template <unsigned Rings, unsigned Sectors>
+constexpr TrigTableData<Rings, Sectors> StaticTrigTable<Rings, Sectors>::data;
+
+// 查找编译期生成的表，没有对应配置时返回 false
+inline bool findTrigTable(unsigned rings, unsigned sectors, TrigTable &table) {
+    // SphereMeshCache 的四个细节级别（经线数 64<<level，纬线数取一半加1）
+    if (rings == 33 && sectors == 64) {
+        table = StaticTrigTable<33, 64>::view();
+    } else if (rings == 65 && sectors == 128) {
+        table = StaticTrigTable<65, 128>::view();
+    } else if (rings == 129 && sectors == 256) {
+        table = StaticTrigTable<129, 256>::view();
+    } else if (rings == 257 && sectors == 512) {
+        table = StaticTrigTable<257, 512>::view();
+    } else if (rings == 50 && sectors == 50) {
+        // PanoViewer 使用的球体
+        table = StaticTrigTable<50, 50>::view();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+}  // namespace sphere_tables
+
+#endif  // SPHERETABLES_H
@@ -0,0 +1,239 @@
+/**
+* @file        :TextureStreamer.cpp
+* @brief       :视频纹理流式上传实现
+* @details     :PBO环的每个缓冲区写入后立即作为 glTexSubImage2D 的数据源，驱动异步完成传输；
+*               环的深度保证CPU写入的缓冲区不会是GPU仍在读取的那一个
+* @date        :2026/10/16 11:05:20
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "TextureStreamer.h"
+
+#include <cstring>
+#include <iostream>
+
+// 把图像按行拷贝为紧密排列的数据，兼容非连续的 cv::Mat（NV12 的Y和UV平面在 cv::Mat 中上下相接，同样按行拷贝）
+static void copyRows(const cv::Mat &frame, unsigned char *dst) {
+    size_t rowBytes = frame.cols * frame.elemSize();
+    if (frame.isContinuous()) {
+        memcpy(dst, frame.data, rowBytes * frame.rows);
+        return;
+    }
+    for (int r = 0; r < frame.rows; r++) {
+        memcpy(dst + r * rowBytes, frame.ptr(r), rowBytes);
+    }
+}
+
+TextureStreamer::TextureStreamer()
+    : m_format(VideoPixelFormat::BGR), m_width(0), m_height(0), m_frameBytes(0), m_mode(UploadMode::PBO), m_bufferCount(3), m_nextBuffer(0), m_persistentBuffer(0), m_mappedPtr(nullptr) {
+}
+
+const char *TextureStreamer::modeName(UploadMode mode) {
+    switch (mode) {
+        case UploadMode::DIRECT:
+            return "DIRECT";
+        case UploadMode::PBO:
+            return "PBO";
+        case UploadMode::PERSISTENT:
+            return "PERSISTENT";
+    }
+    return "UNKNOWN";
+}
+
+bool TextureStreamer::init(int width, int height, VideoPixelFormat format, UploadMode mode, int bufferCount) {
+    release();
+
+    m_format = format;
+    m_width = width;
+    m_height = height;
+    m_bufferCount = bufferCount < 2 ? 2 : bufferCount;
+
+    // 按解码器原生布局描述各个平面，不在CPU上做颜色转换
+    if (format == VideoPixelFormat::NV12) {
+        Plane y = {0, width, height, GL_R8, GL_RED, 1, 0};
+        Plane uv = {0, (width + 1) / 2, (height + 1) / 2, GL_RG8, GL_RG, 2, height};
+        m_planes = {y, uv};
+        m_frameBytes = (size_t)width * height * 3 / 2;
+    } else {
+        Plane bgr = {0, width, height, GL_RGB8, GL_BGR, 3, 0};
+        m_planes = {bgr};
+        m_frameBytes = (size_t)width * height * 3;
+    }
+
+    // 纹理只分配一次，之后只更新内容，不再重新分配存储，也不再每帧设置纹理参数
+    for (Plane &plane : m_planes) {
+        glGenTextures(1, &plane.texture);
+        glBindTexture(GL_TEXTURE_2D, plane.texture);
+        if (GLEW_ARB_texture_storage) {
+            glTexStorage2D(GL_TEXTURE_2D, 1, plane.internalFormat, plane.width, plane.height);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, plane.internalFormat, plane.width, plane.height, 0, plane.format, GL_UNSIGNED_BYTE, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    m_mode = mode;
+    createBuffers();
+    resetStats();
+    return m_planes[0].texture != 0;
+}
+
+void TextureStreamer::release() {
+    destroyBuffers();
+    for (Plane &plane : m_planes) {
+        if (plane.texture) glDeleteTextures(1, &plane.texture);
+    }
+    m_planes.clear();
+}
+
+void TextureStreamer::setMode(UploadMode mode) {
+    if (mode == m_mode) return;
+    destroyBuffers();
+    m_mode = mode;
+    createBuffers();
+    resetStats();
+}
+
+void TextureStreamer::createBuffers() {
+    m_nextBuffer = 0;
+    if (m_mode == UploadMode::PERSISTENT && !GLEW_ARB_buffer_storage) {
+        std::cerr << "GL_ARB_buffer_storage not supported, fall back to PBO upload." << std::endl;
+        m_mode = UploadMode::PBO;
+    }
+
+    if (m_mode == UploadMode::PBO) {
+        m_pbos.resize(m_bufferCount);
+        glGenBuffers(m_bufferCount, m_pbos.data());
+        for (GLuint pbo : m_pbos) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, m_frameBytes, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else if (m_mode == UploadMode::PERSISTENT) {
+        // 一个缓冲区分成m_bufferCount段，整个生命周期保持映射
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &m_persistentBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_persistentBuffer);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, m_frameBytes * m_bufferCount, nullptr, flags);
+        m_mappedPtr = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_frameBytes * m_bufferCount, flags);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_fences.assign(m_bufferCount, nullptr);
+        if (!m_mappedPtr) {
+            std::cerr << "Persistent mapping failed, fall back to PBO upload." << std::endl;
+            destroyBuffers();
+            m_mode = UploadMode::PBO;
+            createBuffers();
+        }
+    }
+}
+
+void TextureStreamer::destroyBuffers() {
+    if (!m_pbos.empty()) {
+        glDeleteBuffers((GLsizei)m_pbos.size(), m_pbos.data());
+        m_pbos.clear();
+    }
+    for (GLsync fence : m_fences) {
+        if (fence) glDeleteSync(fence);
+    }
+    m_fences.clear();
+    if (m_persistentBuffer) {
+        if (m_mappedPtr) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_persistentBuffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            m_mappedPtr = nullptr;
+        }
+        glDeleteBuffers(1, &m_persistentBuffer);
+        m_persistentBuffer = 0;
+    }
+}
+
+void TextureStreamer::upload(const cv::Mat &frame) {
+    if (m_planes.empty() || frame.empty()) return;
+    bool isNV12 = m_format == VideoPixelFormat::NV12;
+    int expectRows = isNV12 ? m_height * 3 / 2 : m_height;
+    int expectType = isNV12 ? CV_8UC1 : CV_8UC3;
+    if (frame.cols != m_width || frame.rows != expectRows || frame.type() != expectType) {
+        std::cerr << "TextureStreamer: frame size/type mismatch, expect " << m_width << "x" << expectRows << (isNV12 ? " CV_8UC1." : " CV_8UC3.") << std::endl;
+        return;
+    }
+
+    double t0 = cv::getTickCount();
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // 每行 width*3 字节，不一定是4字节对齐
+    switch (m_mode) {
+        case UploadMode::DIRECT:
+            uploadDirect(frame);
+            break;
+        case UploadMode::PBO:
+            uploadPBO(frame);
+            break;
+        case UploadMode::PERSISTENT:
+            uploadPersistent(frame);
+            break;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    double elapsedMs = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+    m_stats.frames++;
+    m_stats.totalUploadMs += elapsedMs;
+    if (elapsedMs > m_stats.maxUploadMs) m_stats.maxUploadMs = elapsedMs;
+}
+
+void TextureStreamer::updatePlanes(uintptr_t base, size_t rowBytes) {
+    for (const Plane &plane : m_planes) {
+        // NV12 的UV平面与Y平面行跨度相同，换算成本平面的像素个数
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(rowBytes / plane.bytesPerPixel));
+        glBindTexture(GL_TEXTURE_2D, plane.texture);
+        const void *pixels = reinterpret_cast<const void *>(base + plane.firstRow * rowBytes);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height, plane.format, GL_UNSIGNED_BYTE, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+void TextureStreamer::uploadDirect(const cv::Mat &frame) {
+    updatePlanes(reinterpret_cast<uintptr_t>(frame.data), frame.step);
+}
+
+void TextureStreamer::uploadPBO(const cv::Mat &frame) {
+    GLuint pbo = m_pbos[m_nextBuffer];
+    m_nextBuffer = (m_nextBuffer + 1) % m_bufferCount;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    // INVALIDATE_BUFFER 让驱动丢弃旧内容（orphan），GPU 若仍在读取旧数据也不必等待
+    void *ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_frameBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (ptr) {
+        copyRows(frame, (unsigned char *)ptr);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        // 数据源为当前绑定的PBO，指针参数是缓冲区内偏移；调用立即返回，传输由驱动异步完成
+        updatePlanes(0, frame.cols * frame.elemSize());
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::uploadPersistent(const cv::Mat &frame) {
+    int segment = m_nextBuffer;
+    m_nextBuffer = (m_nextBuffer + 1) % m_bufferCount;
+
+    // 等待GPU读完这一段（环足够深时fence通常早已完成，不会真正阻塞）
+    if (m_fences[segment]) {
+        glClientWaitSync(m_fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        glDeleteSync(m_fences[segment]);
+        m_fences[segment] = nullptr;
+    }
+
+    size_t offset = m_frameBytes * segment;
+    copyRows(frame, m_mappedPtr + offset);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_persistentBuffer);
+    updatePlanes(offset, frame.cols * frame.elemSize());
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,101 @@
+/**
+* @file        :TextureStreamer.h
+* @brief       :视频纹理流式上传
+* @details     :纹理只分配一次（不可变存储），之后每帧通过像素解包缓冲区（PBO）环上传，CPU拷贝与GPU传输/渲染重叠；
+*               支持直接上传、PBO环、持久映射PBO三种模式，并统计每帧上传耗时。
+*               帧数据按解码器原生布局上传（BGR 或 NV12 的Y/UV两个平面），颜色转换和垂直翻转都在着色器中完成
+* @date        :2026/10/16 11:05:20
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include <opencv2/opencv.hpp>
+
+#include "VideoDecoder.h"
+
+class TextureStreamer {
+   public:
+    enum class UploadMode { DIRECT,       // glTexSubImage2D 直接从内存上传
+                            PBO,          // PBO环，每帧映射一个缓冲区写入
+                            PERSISTENT };  // 持久映射的PBO环 + fence 同步，需要 GL 4.4 或 ARB_buffer_storage
+
+    // 上传耗时统计（CPU侧，毫秒）
+    struct Stats {
+        long frames = 0;
+        double totalUploadMs = 0.0;
+        double maxUploadMs = 0.0;
+        double averageUploadMs() const { return frames > 0 ? totalUploadMs / frames : 0.0; }
+    };
+
+    TextureStreamer();
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // 分配纹理存储和PBO环，必须在有 OpenGL 上下文的线程调用
+    bool init(int width, int height, VideoPixelFormat format, UploadMode mode, int bufferCount = 3);
+    // 释放纹理和PBO环。析构时不释放（那时上下文可能已销毁），持有者须在上下文销毁前调用；可重复调用
+    void release();
+
+    // 切换上传模式，纹理保持不变，只重建PBO环
+    void setMode(UploadMode mode);
+    UploadMode getMode() const { return m_mode; }
+
+    // 上传一帧解码器原生布局的图像，尺寸和格式必须与init时一致：
+    // BGR 为 width x height 的 CV_8UC3，NV12 为 (height*3/2) x width 的 CV_8UC1
+    void upload(const cv::Mat &frame);
+
+    VideoPixelFormat getPixelFormat() const { return m_format; }
+    // BGR 格式只有一个纹理；NV12 格式 plane 0 为Y平面（GL_R8），plane 1 为交错的UV平面（GL_RG8）
+    GLuint getTexture(int plane = 0) const { return plane < (int)m_planes.size() ? m_planes[plane].texture : 0; }
+    const Stats &getStats() const { return m_stats; }
+    void resetStats() { m_stats = Stats(); }
+
+    static const char *modeName(UploadMode mode);
+
+   private:
+    // 一个纹理平面在整帧数据中的位置和上传格式
+    struct Plane {
+        GLuint texture;
+        int width;
+        int height;
+        GLenum internalFormat;
+        GLenum format;
+        int bytesPerPixel;
+        int firstRow;   // 该平面在帧 cv::Mat 中的起始行（NV12 的UV平面紧接在Y平面之后）
+    };
+
+    void createBuffers();
+    void destroyBuffers();
+    void uploadDirect(const cv::Mat &frame);
+    void uploadPBO(const cv::Mat &frame);
+    void uploadPersistent(const cv::Mat &frame);
+    // 以当前绑定的PBO（或客户端内存）为数据源更新所有平面，base为PBO内偏移或内存地址，rowBytes为行跨度
+    void updatePlanes(uintptr_t base, size_t rowBytes);
+
+    std::vector<Plane> m_planes;
+    VideoPixelFormat m_format;
+    int m_width;
+    int m_height;
+    size_t m_frameBytes;  // 一帧紧密排列后的字节数
+    UploadMode m_mode;
+    int m_bufferCount;
+    int m_nextBuffer;
+
+    std::vector<GLuint> m_pbos;    // PBO模式：每帧轮换一个缓冲区
+    GLuint m_persistentBuffer;     // PERSISTENT模式：一个缓冲区分成m_bufferCount段
+    unsigned char *m_mappedPtr;    // PERSISTENT模式的持久映射地址
+    std::vector<GLsync> m_fences;  // PERSISTENT模式每段的GPU读取完成fence
+
+    Stats m_stats;
+};
+
+#endif  // TEXTURESTREAMER_H
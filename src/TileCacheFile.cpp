@@ -0,0 +1,272 @@
+/**
+* @file        :TileCacheFile.cpp
+* @brief       :磁盘上的分页金字塔缓存文件实现
+* @details     :每页起始按4096字节对齐，一页原始数据约195KB，只会触及自己的49个内存页；映射时提示随机访问，
+*               避免操作系统为离散的页请求做无用的预读
+* @date        :2026/10/17 09:20:15
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "TileCacheFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char tileCacheMagic[8] = {'P', 'A', 'N', 'O', 'T', 'I', 'L', 'E'};
+static const uint32_t tileCacheVersion = 1;
+// 文件头中尺寸的上限，保证之后按 int 计算的层宽高、页数和页序号不会溢出（128K 宽的全景图像已远超实际需要）
+static const uint32_t tileCacheMaxSide = 1u << 17;
+static const uint32_t tileCacheMinTileSize = 16;
+static const uint32_t tileCacheMaxTileSize = 4096;
+static const uint64_t tileAlignment = 4096;
+
+static uint64_t alignUp(uint64_t value) {
+    return (value + tileAlignment - 1) / tileAlignment * tileAlignment;
+}
+
+TileCacheFile::TileCacheFile()
+    : m_data(nullptr), m_size(0),
+#ifdef _WIN32
+      m_file(nullptr), m_mapping(nullptr),
+#else
+      m_file(-1),
+#endif
+      m_compression(Compression::RAW), m_index(nullptr) {
+}
+
+TileCacheFile::~TileCacheFile() {
+    close();
+}
+
+bool TileCacheFile::isTileCacheFile(const std::string &path) {
+    const std::string ext = ".ptc";
+    return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+bool TileCacheFile::parseCompression(const std::string &name, Compression &compression) {
+    if (name == "raw") {
+        compression = Compression::RAW;
+    } else if (name == "png") {
+        compression = Compression::PNG;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *TileCacheFile::compressionName(Compression compression) {
+    return compression == Compression::PNG ? "png" : "raw";
+}
+
+void TileCacheFile::buildLevelBase() {
+    m_levelBase.assign(m_levelCount + 1, 0);
+    for (int level = 0; level < m_levelCount; level++) {
+        m_levelBase[level + 1] = m_levelBase[level] + getTilesX(level) * getTilesY(level);
+    }
+}
+
+bool TileCacheFile::write(const std::string &path, TileSource &source, Compression compression) {
+    // 借用一个未打开的对象计算布局和索引序号
+    TileCacheFile layout;
+    layout.setLayout(source.getWidth(), source.getHeight(), source.getTileSize(), source.getBorder());
+    layout.buildLevelBase();
+    int tileCount = layout.m_levelBase[layout.m_levelCount];
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Cannot open tile cache for writing: " << path << std::endl;
+        return false;
+    }
+
+    Header header;
+    memcpy(header.magic, tileCacheMagic, sizeof(header.magic));
+    header.version = tileCacheVersion;
+    header.width = source.getWidth();
+    header.height = source.getHeight();
+    header.tileSize = source.getTileSize();
+    header.border = source.getBorder();
+    header.levelCount = layout.m_levelCount;
+    header.compression = (uint32_t)compression;
+    header.tileCount = tileCount;
+    header.fileSize = 0;
+    std::vector<IndexEntry> index(tileCount);
+
+    // 页数据从粗到细写入，最粗的几层（启动时就需要）集中在文件开头
+    uint64_t offset = alignUp(sizeof(Header) + sizeof(IndexEntry) * (uint64_t)tileCount);
+    const std::vector<char> padding(tileAlignment, 0);
+    cv::Mat tile;
+    std::vector<unsigned char> encoded;
+    for (int level = layout.m_levelCount - 1; level >= 0; level--) {
+        for (int ty = 0; ty < layout.getTilesY(level); ty++) {
+            for (int tx = 0; tx < layout.getTilesX(level); tx++) {
+                if (!source.readTile(level, tx, ty, tile)) {
+                    std::cerr << "Cannot read tile " << tx << "," << ty << " of level " << level << std::endl;
+                    return false;
+                }
+                const unsigned char *bytes = tile.data;
+                size_t size = tile.total() * tile.elemSize();
+                if (compression == Compression::PNG) {
+                    // 压缩级别1：解码速度与最高级别相同，编码快得多
+                    if (!cv::imencode(".png", tile, encoded, {cv::IMWRITE_PNG_COMPRESSION, 1})) {
+                        std::cerr << "Cannot encode tile " << tx << "," << ty << " of level " << level << std::endl;
+                        return false;
+                    }
+                    bytes = encoded.data();
+                    size = encoded.size();
+                } else if (!tile.isContinuous()) {
+                    tile = tile.clone();
+                    bytes = tile.data;
+                }
+                file.seekp((std::streamoff)offset);
+                file.write((const char *)bytes, size);
+                IndexEntry &entry = index[layout.tileIndex(level, tx, ty)];
+                entry.offset = offset;
+                entry.size = (uint32_t)size;
+                entry.reserved = 0;
+                offset = alignUp(offset + size);
+            }
+        }
+    }
+    // 文件长度补齐到最后一页的对齐边界，映射时每页都完整
+    file.seekp(0, std::ios::end);
+    uint64_t end = (uint64_t)file.tellp();
+    if (end < offset) {
+        file.write(padding.data(), (std::streamsize)(offset - end));
+    }
+    header.fileSize = offset;
+    file.seekp(0);
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)index.data(), sizeof(IndexEntry) * index.size());
+    file.close();
+    if (!file) {
+        std::cerr << "Failed writing tile cache: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TileCacheFile::open(const std::string &path) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Cannot open tile cache: " << path << std::endl;
+        return false;
+    }
+    m_file = file;
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    m_size = (size_t)fileSize.QuadPart;
+    m_mapping = m_size > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    if (m_mapping) {
+        m_data = (const unsigned char *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    m_file = ::open(path.c_str(), O_RDONLY);
+    if (m_file < 0) {
+        std::cerr << "Cannot open tile cache: " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(m_file, &st) == 0 && st.st_size > 0) {
+        m_size = (size_t)st.st_size;
+        void *data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_file, 0);
+        if (data != MAP_FAILED) {
+            m_data = (const unsigned char *)data;
+            madvise(data, m_size, MADV_RANDOM);
+        }
+    }
+#endif
+    if (!m_data) {
+        std::cerr << "Cannot map tile cache: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    // 文件头和索引都要完整校验，之后读取页时不再检查越界
+    Header header;
+    if (m_size < sizeof(Header)) {
+        std::cerr << "Tile cache too small: " << path << std::endl;
+        close();
+        return false;
+    }
+    memcpy(&header, m_data, sizeof(header));
+    if (memcmp(header.magic, tileCacheMagic, sizeof(header.magic)) != 0 || header.version != tileCacheVersion) {
+        std::cerr << "Not a tile cache (or unsupported version): " << path << std::endl;
+        close();
+        return false;
+    }
+    if (header.fileSize != m_size || header.tileSize < tileCacheMinTileSize || header.tileSize > tileCacheMaxTileSize || header.width == 0 || header.height == 0 ||
+        header.width > tileCacheMaxSide || header.height > tileCacheMaxSide || header.border >= header.tileSize || header.compression > (uint32_t)Compression::PNG) {
+        std::cerr << "Corrupt tile cache header: " << path << std::endl;
+        close();
+        return false;
+    }
+    setLayout(header.width, header.height, header.tileSize, header.border);
+    buildLevelBase();
+    m_compression = (Compression)header.compression;
+    if ((uint32_t)m_levelCount != header.levelCount || (uint32_t)m_levelBase[m_levelCount] != header.tileCount || sizeof(Header) + sizeof(IndexEntry) * (uint64_t)header.tileCount > m_size) {
+        std::cerr << "Corrupt tile cache layout: " << path << std::endl;
+        close();
+        return false;
+    }
+    m_index = (const IndexEntry *)(m_data + sizeof(Header));
+    uint64_t rawSize = (uint64_t)getSlotSize() * getSlotSize() * 3;
+    for (uint32_t i = 0; i < header.tileCount; i++) {
+        const IndexEntry &entry = m_index[i];
+        // 先比较 offset，避免构造的索引让 offset + size 溢出
+        if (entry.offset > m_size || entry.size > m_size - entry.offset || (m_compression == Compression::RAW && entry.size != rawSize)) {
+            std::cerr << "Corrupt tile cache index: " << path << std::endl;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void TileCacheFile::close() {
+#ifdef _WIN32
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file) CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data) munmap((void *)m_data, m_size);
+    if (m_file >= 0) ::close(m_file);
+    m_file = -1;
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_index = nullptr;
+}
+
+bool TileCacheFile::readTile(int level, int tx, int ty, cv::Mat &tile) {
+    if (!m_data || level < 0 || level >= m_levelCount || tx < 0 || ty < 0 || tx >= getTilesX(level) || ty >= getTilesY(level)) return false;
+    const IndexEntry &entry = m_index[tileIndex(level, tx, ty)];
+    unsigned char *bytes = const_cast<unsigned char *>(m_data + entry.offset);
+    int slotSize = getSlotSize();
+    if (m_compression == Compression::RAW) {
+        // 不拷贝：上传时直接从映射的内存读取，第一次访问时操作系统才从磁盘读入
+        tile = cv::Mat(slotSize, slotSize, CV_8UC3, bytes);
+        return true;
+    }
+    tile = cv::imdecode(cv::Mat(1, (int)entry.size, CV_8UC1, bytes), cv::IMREAD_COLOR);
+    return tile.rows == slotSize && tile.cols == slotSize;
+}
@@ -0,0 +1,87 @@
+/**
+* @file        :TileCacheFile.h
+* @brief       :磁盘上的分页金字塔缓存文件（.ptc），内存映射读取
+* @details     :超大全景图像每次启动都重新解码 JPEG 需要数秒。预处理一次，把金字塔按虚拟纹理的页（带边框）写入缓存文件，
+*               之后打开文件只读取文件头和索引并映射整个文件，页的数据在虚拟纹理第一次需要时才由操作系统按页读入，
+*               首帧只需要最粗的一层。
+*               文件布局（小端）：文件头 | 每页一项的索引 | 页数据。页按层级从粗到细存放，每页起始按4096字节对齐；
+*               索引按 层级、行、列 的顺序排列。页数据为 getSlotSize() 见方的 BGR 原始像素，或 PNG 压缩
+* @date        :2026/10/17 09:20:15
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef TILECACHEFILE_H
+#define TILECACHEFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TileSource.h"
+
+class TileCacheFile : public TileSource {
+   public:
+    enum class Compression { RAW = 0,   // 原始像素，读取时不拷贝，直接引用映射的内存
+                             PNG = 1 };  // 无损压缩，文件约小一半，读取时解码
+
+    TileCacheFile();
+    ~TileCacheFile();
+
+    // 把数据源的全部页写入缓存文件
+    static bool write(const std::string &path, TileSource &source, Compression compression = Compression::RAW);
+    // 按扩展名 .ptc 判断
+    static bool isTileCacheFile(const std::string &path);
+    static bool parseCompression(const std::string &name, Compression &compression);
+    static const char *compressionName(Compression compression);
+
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+    Compression getCompression() const { return m_compression; }
+
+    // RAW 时 tile 直接指向映射的只读内存，文件关闭前有效，不能写入
+    bool readTile(int level, int tx, int ty, cv::Mat &tile) override;
+
+   private:
+#pragma pack(push, 1)
+    struct Header {
+        char magic[8];  // "PANOTILE"
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t tileSize;
+        uint32_t border;
+        uint32_t levelCount;
+        uint32_t compression;
+        uint32_t tileCount;
+        uint64_t fileSize;
+    };
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t reserved;
+    };
+#pragma pack(pop)
+
+    // 第 level 层的第一页在索引中的序号
+    void buildLevelBase();
+    int tileIndex(int level, int tx, int ty) const { return m_levelBase[level] + ty * getTilesX(level) + tx; }
+
+    const unsigned char *m_data;  // 映射的整个文件
+    size_t m_size;
+#ifdef _WIN32
+    void *m_file;
+    void *m_mapping;
+#else
+    int m_file;
+#endif
+    Compression m_compression;
+    const IndexEntry *m_index;
+    std::vector<int> m_levelBase;
+};
+
+#endif  // TILECACHEFILE_H
@@ -0,0 +1,85 @@
+/**
+* @file        :TileSource.cpp
+* @brief       :虚拟纹理的分页数据源实现
+* @details     :金字塔每层由上一层用 INTER_AREA 缩小一半得到，相当于2x2盒式滤波
+* @date        :2026/10/16 23:10:40
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "TileSource.h"
+
+#include <algorithm>
+#include <cstring>
+
+void TileSource::setLayout(int width, int height, int tileSize, int border) {
+    m_width = width;
+    m_height = height;
+    m_tileSize = tileSize;
+    m_border = border;
+    m_levelCount = 1;
+    while (getLevelWidth(m_levelCount - 1) > tileSize || getLevelHeight(m_levelCount - 1) > tileSize) {
+        m_levelCount++;
+    }
+}
+
+void TileSource::copyTile(const cv::Mat &levelImage, int tx, int ty, cv::Mat &tile) const {
+    int slotSize = getSlotSize();
+    tile.create(slotSize, slotSize, CV_8UC3);
+    int width = levelImage.cols;
+    int height = levelImage.rows;
+    int x0 = tx * m_tileSize - m_border;
+    int y0 = ty * m_tileSize - m_border;
+    for (int y = 0; y < slotSize; y++) {
+        int sy = std::min(std::max(y0 + y, 0), height - 1);
+        const unsigned char *src = levelImage.ptr<unsigned char>(sy);
+        unsigned char *dst = tile.ptr<unsigned char>(y);
+        // 大部分像素是一整段连续的行，只有边框和跨过经度接缝的部分需要逐像素环绕
+        int x = 0;
+        while (x < slotSize) {
+            int sx = ((x0 + x) % width + width) % width;
+            int run = std::min(slotSize - x, width - sx);
+            memcpy(dst + 3 * x, src + 3 * sx, 3 * run);
+            x += run;
+        }
+    }
+}
+
+bool TileSource::readLevel(int level, cv::Mat &image) {
+    if (level < 0 || level >= m_levelCount) return false;
+    int width = getLevelWidth(level);
+    int height = getLevelHeight(level);
+    image.create(height, width, CV_8UC3);
+    cv::Mat tile;
+    for (int ty = 0; ty < getTilesY(level); ty++) {
+        for (int tx = 0; tx < getTilesX(level); tx++) {
+            if (!readTile(level, tx, ty, tile)) return false;
+            cv::Rect rect(tx * m_tileSize, ty * m_tileSize, std::min(m_tileSize, width - tx * m_tileSize), std::min(m_tileSize, height - ty * m_tileSize));
+            tile(cv::Rect(m_border, m_border, rect.width, rect.height)).copyTo(image(rect));
+        }
+    }
+    return true;
+}
+
+int TileSource::findLevel(int maxWidth) const {
+    int level = 0;
+    while (level + 1 < m_levelCount && getLevelWidth(level) > maxWidth) level++;
+    return level;
+}
+
+ImageTileSource::ImageTileSource(const cv::Mat &image, int tileSize, int border) {
+    setLayout(image.cols, image.rows, tileSize, border);
+    m_levels.resize(m_levelCount);
+    m_levels[0] = image;
+    for (int level = 1; level < m_levelCount; level++) {
+        cv::resize(m_levels[level - 1], m_levels[level], cv::Size(getLevelWidth(level), getLevelHeight(level)), 0, 0, cv::INTER_AREA);
+    }
+}
+
+bool ImageTileSource::readTile(int level, int tx, int ty, cv::Mat &tile) {
+    if (level < 0 || level >= m_levelCount || tx < 0 || ty < 0 || tx >= getTilesX(level) || ty >= getTilesY(level)) return false;
+    copyTile(m_levels[level], tx, ty, tile);
+    return true;
+}
@@ -0,0 +1,74 @@
+/**
+* @file        :TileSource.h
+* @brief       :虚拟纹理的分页数据源
+* @details     :全景图像组织为多分辨率金字塔：第0层为原图，每层宽高减半（向上取整），直到整层放得进一页；
+*               每层切成 tileSize 见方的页，读取时每页四周带 border 像素的边框，供GPU双线性过滤跨页时使用。
+*               左右边框按经度环绕取图像另一侧的像素，上下边框和超出图像的部分复制边缘像素
+* @date        :2026/10/16 23:10:40
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef TILESOURCE_H
+#define TILESOURCE_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+class TileSource {
+   public:
+    enum { CPU_LEVEL_MAX_WIDTH = 8192 };  // CPU 重投影使用的最宽一层，输出不超过4K时更细的层没有意义
+
+    virtual ~TileSource() {}
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    int getTileSize() const { return m_tileSize; }
+    int getBorder() const { return m_border; }
+    int getLevelCount() const { return m_levelCount; }
+    // 一页连同边框的边长
+    int getSlotSize() const { return m_tileSize + 2 * m_border; }
+
+    int getLevelWidth(int level) const { return (m_width + (1 << level) - 1) >> level; }
+    int getLevelHeight(int level) const { return (m_height + (1 << level) - 1) >> level; }
+    int getTilesX(int level) const { return (getLevelWidth(level) + m_tileSize - 1) / m_tileSize; }
+    int getTilesY(int level) const { return (getLevelHeight(level) + m_tileSize - 1) / m_tileSize; }
+
+    // 读取第 level 层的 (tx, ty) 页，输出 getSlotSize() 见方的 CV_8UC3 BGR 图像，页内容从 (border, border) 开始。
+    // 可能在后台线程调用，实现需要线程安全
+    virtual bool readTile(int level, int tx, int ty, cv::Mat &tile) = 0;
+    // 由各页拼出第 level 层的整张图像（CPU 渲染和导出使用）
+    bool readLevel(int level, cv::Mat &image);
+    // 宽度不超过 maxWidth 的最细一层
+    int findLevel(int maxWidth) const;
+
+   protected:
+    TileSource() : m_width(0), m_height(0), m_tileSize(0), m_border(0), m_levelCount(0) {}
+    // 设置金字塔布局，层数由图像尺寸和页大小决定
+    void setLayout(int width, int height, int tileSize, int border);
+    // 从一层的完整图像中按上述边框规则取出一页
+    void copyTile(const cv::Mat &levelImage, int tx, int ty, cv::Mat &tile) const;
+
+    int m_width;
+    int m_height;
+    int m_tileSize;
+    int m_border;
+    int m_levelCount;
+};
+
+// 由已解码的整张图像在内存中建立金字塔，第0层与传入的图像共用像素数据
+class ImageTileSource : public TileSource {
+   public:
+    ImageTileSource(const cv::Mat &image, int tileSize = 256, int border = 1);
+
+    bool readTile(int level, int tx, int ty, cv::Mat &tile) override;
+    const cv::Mat &getLevel(int level) const { return m_levels[level]; }
+
+   private:
+    std::vector<cv::Mat> m_levels;
+};
+
+#endif  // TILESOURCE_H
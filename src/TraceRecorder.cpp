@@ -0,0 +1,137 @@
+/**
+* @file        :TraceRecorder.cpp
+* @brief       :Chrome trace-event（JSON）格式的时间线记录实现
+* @details     :时间戳换算为相对开始时刻的微秒；每个线程缓冲区的事件数以 release 写入、acquire 读出，
+*               写文件时只读取已经完整写入的事件，记录线程仍在运行也不会读到半个事件
+* @date        :2026/10/17 15:20:40
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "TraceRecorder.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+std::atomic<bool> TraceRecorder::s_recording(false);
+
+namespace {
+// 线程名可能来自外部输入，转义引号、反斜杠和控制字符
+std::string escapeJson(const std::string &text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+}  // namespace
+
+TraceRecorder &TraceRecorder::instance() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+TraceRecorder::TraceRecorder()
+    : m_startTick(0), m_stopTick(0), m_finished(false) {
+}
+
+TraceRecorder::~TraceRecorder() {
+    // 所有 return 和 exit() 的退出路径都会经过这里
+    finish();
+}
+
+void TraceRecorder::start(const std::string &path, double seconds) {
+    m_path = path;
+    m_startTick = cv::getTickCount();
+    m_stopTick = m_startTick + (int64_t)(seconds * cv::getTickFrequency());
+    m_finished = false;
+    s_recording.store(true);
+}
+
+bool TraceRecorder::finish() {
+    if (m_path.empty() || m_finished) return false;
+    s_recording.store(false);
+    m_finished = true;
+
+    std::ofstream out(m_path);
+    if (!out) {
+        std::cerr << "Could not write trace: " << m_path << std::endl;
+        return false;
+    }
+    const double usPerTick = 1e6 / cv::getTickFrequency();
+    long events = 0, dropped = 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"360Viewer\"}}";
+    char line[256];
+    for (const std::unique_ptr<ThreadBuffer> &buffer : m_buffers) {
+        std::string name = buffer->name.empty() ? "thread " + std::to_string(buffer->tid) : buffer->name;
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":\"" << escapeJson(name) << "\"}}";
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+            const Event &e = buffer->events[i];
+            std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"pano\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}", e.name,
+                          (e.begin - m_startTick) * usPerTick, (e.end - e.begin) * usPerTick, buffer->tid);
+            out << line;
+        }
+        events += (long)count;
+        dropped += buffer->dropped;
+    }
+    out << "\n]}\n";
+    if (!out) {
+        std::cerr << "Could not write trace: " << m_path << std::endl;
+        return false;
+    }
+    printf("Trace with %ld events from %d threads written to %s", events, (int)m_buffers.size(), m_path.c_str());
+    if (dropped > 0) printf(" (%ld events dropped, per-thread buffer full)", dropped);
+    printf("\n");
+    return true;
+}
+
+TraceRecorder::ThreadBuffer *TraceRecorder::threadBuffer() {
+    // 每个线程只在第一次记录时加锁登记，缓冲区由记录器持有，线程结束后仍然有效
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer) {
+        std::unique_ptr<ThreadBuffer> created(new ThreadBuffer());
+        created->events.resize(THREAD_CAPACITY);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        created->tid = (int)m_buffers.size() + 1;
+        buffer = created.get();
+        m_buffers.push_back(std::move(created));
+    }
+    return buffer;
+}
+
+void TraceRecorder::setThreadName(const char *name) {
+    if (!isRecording()) return;
+    ThreadBuffer *buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer->name = name;
+}
+
+void TraceRecorder::addEvent(const char *name, int64_t begin, int64_t end) {
+    if (end > m_stopTick) {
+        s_recording.store(false, std::memory_order_relaxed);  // 到达记录时长，之后的事件不再记录
+        return;
+    }
+    ThreadBuffer *buffer = threadBuffer();
+    size_t index = buffer->count.load(std::memory_order_relaxed);
+    if (index >= buffer->events.size()) {
+        buffer->dropped++;
+        return;
+    }
+    buffer->events[index] = Event{name, begin, end};
+    buffer->count.store(index + 1, std::memory_order_release);
+}
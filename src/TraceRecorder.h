@@ -0,0 +1,88 @@
+/**
+* @file        :TraceRecorder.h
+* @brief       :Chrome trace-event（JSON）格式的时间线记录
+* @details     :渲染线程、解码线程、后台导出的渲染和编码线程等各自把事件追加到自己的缓冲区，缓冲区在线程第一次记录时分配并登记，
+*               之后的追加只有该线程写入，不加锁；退出时合并写出 about:tracing / Perfetto 可以直接打开的 JSON。
+*               事件在作用域结束时以 "X"（完整事件，开始时间加时长）记录，名称必须是静态字符串。
+*               进程内只有一个记录器，各模块不需要互相传递指针；只记录开始后的前若干秒，未开始时 TraceScope 只读一次原子标志
+* @date        :2026/10/17 15:20:40
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+class TraceRecorder {
+   public:
+    enum { THREAD_CAPACITY = 1 << 17 };  // 每个线程最多记录的事件数，超出的丢弃并计数
+
+    static TraceRecorder &instance();
+    static bool isRecording() { return s_recording.load(std::memory_order_relaxed); }
+
+    // 开始记录，seconds 秒后自动停止；程序退出时写入 path
+    void start(const std::string &path, double seconds);
+    // 停止记录并写出文件，可以重复调用，只写一次
+    bool finish();
+
+    // 当前线程在时间线上显示的名称，在线程开始处调用
+    void setThreadName(const char *name);
+    // 追加一个完整事件，begin/end 为 cv::getTickCount() 的值；超过记录时长后停止记录
+    void addEvent(const char *name, int64_t begin, int64_t end);
+
+   private:
+    struct Event {
+        const char *name;
+        int64_t begin;  // cv::getTickCount()
+        int64_t end;
+    };
+    struct ThreadBuffer {
+        std::vector<Event> events;
+        std::atomic<size_t> count;  // 已写入的事件数，只有所属线程修改
+        std::atomic<long> dropped;  // 缓冲区满后丢弃的事件数
+        int tid = 0;
+        std::string name;           // 在 m_mutex 下访问
+        ThreadBuffer() : count(0), dropped(0) {}
+    };
+
+    TraceRecorder();
+    ~TraceRecorder();
+    ThreadBuffer *threadBuffer();
+
+    static std::atomic<bool> s_recording;
+    std::mutex m_mutex;  // 保护线程缓冲区的登记和线程名
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    std::string m_path;
+    int64_t m_startTick;
+    int64_t m_stopTick;
+    bool m_finished;
+};
+
+// 作用域事件：构造时取开始时间，析构时记录
+class TraceScope {
+   public:
+    explicit TraceScope(const char *name)
+        : m_name(name), m_start(TraceRecorder::isRecording() ? cv::getTickCount() : 0) {}
+    ~TraceScope() {
+        if (m_start != 0) TraceRecorder::instance().addEvent(m_name, m_start, cv::getTickCount());
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+   private:
+    const char *m_name;
+    int64_t m_start;
+};
+
+#endif  // TRACERECORDER_H
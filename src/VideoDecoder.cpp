@@ -0,0 +1,388 @@
+/**
+* @file        :VideoDecoder.cpp
+* @brief       :全景视频后台解码器实现
+* @details     :解码线程写入环形缓冲区尾部的空闲槽位，渲染线程读取头部槽位，二者只在移动头尾指针时加锁
+* @date        :2026/10/16 10:12:45
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "VideoDecoder.h"
+
+#include <chrono>
+#include <iostream>
+
+// 解码线程每次最多连续跳过的帧数，避免长时间落后时一直跳帧而不产出画面
+static const int kMaxSkipFrames = 8;
+
+static long long steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PlaybackClock::start(double mediaMs) {
+    m_originNs.store(steadyNowNs() - (long long)(mediaMs * 1e6));
+}
+
+double PlaybackClock::nowMs() const {
+    long long origin = m_originNs.load();
+    if (origin < 0) return 0.0;
+    return (steadyNowNs() - origin) / 1e6;
+}
+
+// 按请求的像素布局打开视频源
+static bool openSource(cv::VideoCapture &capture, const std::string &filepath, VideoPixelFormat format) {
+    if (format == VideoPixelFormat::NV12) {
+        // 让 GStreamer 直接输出 NV12 平面，OpenCV 以 (height*3/2) x width 的单通道 Mat 返回
+        std::string pipeline = "filesrc location=\"" + filepath + "\" ! decodebin ! videoconvert ! video/x-raw,format=NV12 ! appsink sync=false";
+        return capture.open(pipeline, cv::CAP_GSTREAMER);
+    }
+    return capture.open(filepath);
+}
+
+VideoDecoder::VideoDecoder(size_t ringCapacity, LoopMode loopMode, int prerollFrames)
+    : m_capture(new cv::VideoCapture()), m_ring(ringCapacity < 2 ? 2 : ringCapacity), m_head(0), m_count(0), m_acquired(false), m_running(false), m_width(0), m_height(0), m_fps(0.0), m_format(VideoPixelFormat::BGR), m_decodedFrames(0), m_streamFrame(0), m_lastStreamPtsMs(0.0), m_loopOffsetMs(0.0), m_skippedFrames(0), m_droppedFrames(0), m_loopMode(loopMode), m_prerollFrames(prerollFrames < 1 ? 1 : prerollFrames), m_prerollCount(0), m_replayPos(-1), m_firstPass(true), m_cacheHoldsAll(false), m_standby(new cv::VideoCapture()) {
+}
+
+VideoDecoder::~VideoDecoder() {
+    close();
+}
+
+// 打开视频并解码第一帧，确认解码输出与期望的像素布局一致
+bool VideoDecoder::openCapture(const std::string &filepath, VideoPixelFormat format) {
+    if (!openSource(*m_capture, filepath, format)) {
+        return false;
+    }
+
+    m_format = format;
+    m_width = (int)m_capture->get(cv::CAP_PROP_FRAME_WIDTH);
+    m_height = (int)m_capture->get(cv::CAP_PROP_FRAME_HEIGHT);
+    m_fps = m_capture->get(cv::CAP_PROP_FPS);
+    if (m_fps <= 0.0) {
+        m_fps = 30.0;  // 部分容器不记录帧率，按30帧处理
+    }
+
+    // 第一帧直接解码到槽位0，顺便校验输出布局
+    int rows = format == VideoPixelFormat::NV12 ? m_height * 3 / 2 : m_height;
+    int type = format == VideoPixelFormat::NV12 ? CV_8UC1 : CV_8UC3;
+    if (!decodeInto(m_ring[0]) || m_ring[0].image.rows != rows || m_ring[0].image.cols != m_width || m_ring[0].image.type() != type) {
+        m_capture->release();
+        return false;
+    }
+    return true;
+}
+
+bool VideoDecoder::open(const std::string &filepath, VideoPixelFormat preferredFormat) {
+    close();
+
+    m_head = 0;
+    m_count = 0;
+    m_acquired = false;
+    m_decodedFrames = 0;
+    m_streamFrame = 0;
+    m_lastStreamPtsMs = 0.0;
+    m_loopOffsetMs = 0.0;
+    m_skippedFrames.store(0);
+    m_droppedFrames.store(0);
+    m_clock.reset();
+    m_filepath = filepath;
+    m_prerollCount = 0;
+    m_replayPos = -1;
+    m_firstPass = true;
+    m_cacheHoldsAll = false;
+
+    if (!openCapture(filepath, preferredFormat)) {
+        if (preferredFormat == VideoPixelFormat::BGR) {
+            return false;
+        }
+        std::cerr << "NV12 decode output not available, fall back to BGR." << std::endl;
+        m_decodedFrames = 0;
+        m_streamFrame = 0;
+        m_lastStreamPtsMs = 0.0;
+        m_prerollCount = 0;
+        if (!openCapture(filepath, VideoPixelFormat::BGR)) {
+            return false;
+        }
+    }
+
+    // 预分配其余槽位，之后解码直接写入这些缓冲区，运行期间不再分配内存
+    const cv::Mat &first = m_ring[0].image;
+    for (size_t i = 1; i < m_ring.size(); i++) {
+        m_ring[i].image.create(first.rows, first.cols, first.type());
+    }
+    m_count = 1;  // 槽位0已经是第一帧
+
+    if (m_loopMode == LoopMode::GAPLESS) {
+        // 预读缓存在第一轮播放时顺带填充；备用解码实例在后台线程中准备，不占用解码线程
+        m_preroll.resize(m_prerollFrames);
+        for (auto &cached : m_preroll) {
+            cached.image.create(first.rows, first.cols, first.type());
+        }
+        first.copyTo(m_preroll[0].image);
+        m_preroll[0].timestampMs = m_lastStreamPtsMs;
+        m_prerollCount = 1;
+        m_standbyReady = std::async(std::launch::async, [this] {
+            prepareStandby();
+            return m_standby->isOpened();
+        });
+    }
+
+    m_running.store(true);
+    m_worker = std::thread(&VideoDecoder::decodeLoop, this);
+    return true;
+}
+
+void VideoDecoder::close() {
+    if (m_worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running.store(false);
+        }
+        m_notFull.notify_all();
+        m_worker.join();
+    }
+    m_running.store(false);
+    if (m_standbyReady.valid()) {
+        m_standbyReady.wait();
+        m_standbyReady = std::future<bool>();
+    }
+    m_standby->release();
+    m_capture->release();
+}
+
+bool VideoDecoder::isOpened() const {
+    return m_capture->isOpened();
+}
+
+const VideoFrame *VideoDecoder::acquireFrame() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_acquired || m_count == 0) {
+        return nullptr;
+    }
+    m_acquired = true;
+    return &m_ring[m_head];
+}
+
+const VideoFrame *VideoDecoder::acquireCurrentFrame() {
+    size_t dropped = 0;
+    const VideoFrame *frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_acquired || m_count == 0) {
+            return nullptr;
+        }
+        // 第一帧显示时启动播放时钟
+        if (!m_clock.isStarted()) {
+            m_clock.start(m_ring[m_head].timestampMs);
+        }
+        double now = m_clock.nowMs();
+
+        // 下一帧还没到显示时间，沿用当前纹理
+        if (m_ring[m_head].timestampMs > now) {
+            return nullptr;
+        }
+        // 后一帧也已经到了显示时间，说明当前帧过时了，直接丢弃，不上传
+        while (m_count > 1 && m_ring[(m_head + 1) % m_ring.size()].timestampMs <= now) {
+            m_head = (m_head + 1) % m_ring.size();
+            m_count--;
+            dropped++;
+        }
+        m_acquired = true;
+        frame = &m_ring[m_head];
+    }
+    if (dropped > 0) {
+        m_droppedFrames += (long)dropped;
+        m_notFull.notify_one();
+    }
+    return frame;
+}
+
+bool VideoDecoder::waitForFrame(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_notEmpty.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return m_count > 0 || !m_running.load(); }) && m_count > 0;
+}
+
+void VideoDecoder::releaseFrame() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_acquired) {
+            return;
+        }
+        m_acquired = false;
+        m_head = (m_head + 1) % m_ring.size();
+        m_count--;
+    }
+    m_notFull.notify_one();
+}
+
+// 解码一帧到指定槽位，保持解码器原生布局，颜色转换和翻转交给着色器
+bool VideoDecoder::decodeInto(VideoFrame &slot) {
+    double pts = 0.0;
+    if (m_cacheHoldsAll && m_replayPos >= m_prerollCount) {
+        handleEndOfStream();  // 整个视频都在缓存中，回放完一轮直接开始下一轮
+    }
+    if (m_replayPos >= 0) {
+        replayFromCache(slot, pts);
+    } else if (!readFromCapture(slot, pts)) {
+        // 播放到结尾，每次只回绕一次；回绕后的第一次读取仍然失败（无法定位的流、截断或损坏的文件）时停止解码
+        if (!handleEndOfStream()) {
+            return false;
+        }
+        if (m_replayPos >= 0) {
+            replayFromCache(slot, pts);
+        } else if (!readFromCapture(slot, pts)) {
+            std::cerr << "Cannot read video after looping back to the start." << std::endl;
+            return false;
+        }
+    }
+
+    m_streamFrame++;
+    m_lastStreamPtsMs = pts;
+    slot.timestampMs = m_loopOffsetMs + pts;
+    slot.index = m_decodedFrames++;
+    return true;
+}
+
+// 循环点之后先从预读缓存回放，只有一次内存拷贝，没有定位和解码
+void VideoDecoder::replayFromCache(VideoFrame &slot, double &pts) {
+    const VideoFrame &cached = m_preroll[m_replayPos++];
+    cached.image.copyTo(slot.image);
+    pts = cached.timestampMs;
+    if (m_replayPos >= m_prerollCount && !m_cacheHoldsAll) {
+        m_replayPos = -1;  // 缓存回放完毕，接着由解码实例继续解码
+    }
+}
+
+bool VideoDecoder::readFromCapture(VideoFrame &slot, double &pts) {
+    // read() 拆成 grab() 和 retrieve()，分别计入解码和格式转换两个阶段，行为与 read() 相同
+    bool grabbed;
+    {
+        ScopedStageTimer timer(m_profiler, FrameProfiler::VIDEO_DECODE);
+        grabbed = m_capture->grab();
+    }
+    if (grabbed) {
+        ScopedStageTimer timer(m_profiler, FrameProfiler::VIDEO_CONVERT);
+        grabbed = m_capture->retrieve(slot.image);
+    }
+    if (!grabbed) {
+        return false;
+    }
+    // 优先使用容器给出的时间戳，后端不支持时按帧率推算
+    pts = m_capture->get(cv::CAP_PROP_POS_MSEC);
+    if (pts <= 0.0 && m_streamFrame > 0) {
+        pts = m_streamFrame * 1000.0 / m_fps;
+    }
+    // 第一轮播放时顺带缓存开头的若干帧
+    if (m_loopMode == LoopMode::GAPLESS && m_firstPass && m_streamFrame < (long)m_preroll.size() && m_streamFrame == m_prerollCount) {
+        slot.image.copyTo(m_preroll[m_streamFrame].image);
+        m_preroll[m_streamFrame].timestampMs = pts;
+        m_prerollCount = (int)m_streamFrame + 1;
+    }
+    return true;
+}
+
+bool VideoDecoder::handleEndOfStream() {
+    // 下一轮的时间戳接在这一轮之后
+    m_loopOffsetMs += m_lastStreamPtsMs + 1000.0 / m_fps;
+    m_streamFrame = 0;
+    bool wasFirstPass = m_firstPass;
+    m_firstPass = false;
+
+    if (m_loopMode == LoopMode::SEEK || m_prerollCount == 0) {
+        // 定位操作发生在解码线程，不会阻塞渲染，但循环点仍有一次定位和关键帧解码
+        m_capture->set(cv::CAP_PROP_POS_FRAMES, 0);
+        return true;
+    }
+
+    if (wasFirstPass && m_prerollCount < (int)m_preroll.size()) {
+        // 整个视频都在缓存里，之后不再解码，直接循环回放缓存
+        m_cacheHoldsAll = true;
+    }
+
+    if (m_cacheHoldsAll) {
+        m_replayPos = 0;
+        return true;
+    }
+
+    // 备用实例已经定位在缓存之后的那一帧，与当前实例交换，循环点既不定位也不重新打开；
+    // 备用实例还在打开或前进时不等待，这一次退回定位方式，下一个循环点再用
+    bool standbyReady = m_standbyReady.valid() && m_standbyReady.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    bool standbyOk = standbyReady && m_standbyReady.get();
+    if (standbyOk) {
+        std::swap(m_capture, m_standby);
+        m_standbyReady = std::async(std::launch::async, [this] {
+            prepareStandby();
+            return m_standby->isOpened();
+        });
+    } else {
+        // 备用实例不可用时退回定位方式
+        std::cerr << "Standby video capture not ready, seek to loop point." << std::endl;
+        m_capture->set(cv::CAP_PROP_POS_FRAMES, m_prerollCount);
+    }
+    m_replayPos = 0;
+    return true;
+}
+
+void VideoDecoder::prepareStandby() {
+    TraceRecorder::instance().setThreadName("video standby");
+    TraceScope trace("open standby decoder");
+    m_standby->release();
+    if (!openSource(*m_standby, m_filepath, m_format)) {
+        return;
+    }
+    // 跳过会从缓存回放的开头几帧
+    for (int i = 0; i < m_prerollFrames; i++) {
+        if (!m_standby->grab()) {
+            break;
+        }
+    }
+}
+
+// 解码落后于播放时钟时，用 grab() 跳过来不及显示的帧，省去 retrieve 的格式转换和拷贝
+void VideoDecoder::skipLateFrames() {
+    if (!m_clock.isStarted() || m_replayPos >= 0) return;  // 缓存回放本身几乎没有开销，不需要跳帧
+    if (m_firstPass && m_streamFrame < m_prerollFrames) return;  // 保证预读缓存是连续的开头几帧
+
+    double interval = 1000.0 / m_fps;
+    for (int i = 0; i < kMaxSkipFrames; i++) {
+        double nextPts = m_loopOffsetMs + m_lastStreamPtsMs + interval;
+        if (nextPts + interval >= m_clock.nowMs()) break;  // 下一帧仍在显示窗口内，正常解码
+        if (!m_capture->grab()) break;                      // 到达结尾，交给decodeInto处理循环
+        m_streamFrame++;
+        m_lastStreamPtsMs += interval;
+        m_skippedFrames++;
+    }
+}
+
+void VideoDecoder::decodeLoop() {
+    TraceRecorder::instance().setThreadName("video decoder");
+    while (m_running.load()) {
+        size_t tail;
+        {
+            // 等待空闲槽位，缓冲区满时解码线程休眠，不会无限超前解码
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_notFull.wait(lock, [this] { return m_count < m_ring.size() || !m_running.load(); });
+            if (!m_running.load()) {
+                break;
+            }
+            tail = (m_head + m_count) % m_ring.size();
+        }
+
+        // 尾部槽位此时不会被渲染线程访问，可以在锁外解码
+        skipLateFrames();
+        if (!decodeInto(m_ring[tail])) {
+            std::cerr << "Video decode failed, decoder thread stopped." << std::endl;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running.store(false);
+            m_notEmpty.notify_all();
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_count++;
+        }
+        m_notEmpty.notify_one();
+    }
+}
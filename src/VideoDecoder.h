@@ -0,0 +1,149 @@
+/**
+* @file        :VideoDecoder.h
+* @brief       :全景视频后台解码器
+* @details     :独立的解码线程把视频帧解码到固定容量、预先分配好的环形缓冲区中，渲染线程只负责消费已就绪的帧并上传纹理，
+*               解码耗时不再占用渲染循环
+* @date        :2026/10/16 10:12:45
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef VIDEODECODER_H
+#define VIDEODECODER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "FrameProfiler.h"
+
+// 解码输出的像素布局，渲染线程按原生布局上传，不在CPU上做颜色转换和翻转
+enum class VideoPixelFormat { BGR,    // width x height 的 CV_8UC3
+                              NV12 };  // (height*3/2) x width 的 CV_8UC1，Y平面之后紧跟交错的UV平面，需要 GStreamer 后端
+
+// 解码完成、可以直接上传为纹理的一帧
+struct VideoFrame {
+    cv::Mat image;       // 像素数据（原生布局），缓冲区在open时预分配，之后循环复用
+    double timestampMs;  // 该帧的显示时间戳（毫秒）
+    long index;          // 从打开视频开始累计的帧序号
+};
+
+// 视频播放时钟：把墙上时间映射为媒体时间，解码线程和渲染线程都可以无锁读取
+class PlaybackClock {
+   public:
+    PlaybackClock() : m_originNs(-1) {}
+
+    // 从媒体时间mediaMs开始计时
+    void start(double mediaMs);
+    void reset() { m_originNs.store(-1); }
+    bool isStarted() const { return m_originNs.load() >= 0; }
+    // 当前媒体时间（毫秒），未开始时返回0
+    double nowMs() const;
+
+   private:
+    std::atomic<long long> m_originNs;  // 媒体时间为0时对应的 steady_clock 时刻（纳秒）
+};
+
+// 单生产者（解码线程）单消费者（渲染线程）的视频解码器
+class VideoDecoder {
+   public:
+    enum class LoopMode { SEEK,      // 播放结束时定位回第0帧（循环点会有一次定位和关键帧解码的卡顿）
+                          GAPLESS };  // 预读缓存开头若干帧，并准备一个备用的解码实例，循环点无额外耗时
+
+    explicit VideoDecoder(size_t ringCapacity = 4, LoopMode loopMode = LoopMode::GAPLESS, int prerollFrames = 8);
+    ~VideoDecoder();
+
+    // 打开视频并启动解码线程。请求NV12时尝试通过 GStreamer 直接取得YUV平面，不支持时退回BGR
+    bool open(const std::string &filepath, VideoPixelFormat preferredFormat = VideoPixelFormat::BGR);
+    // 停止解码线程并关闭视频
+    void close();
+    bool isOpened() const;
+
+    // 渲染线程调用，取出最早的一帧已解码帧，没有就绪帧时立即返回nullptr
+    const VideoFrame *acquireFrame();
+    // 渲染线程调用，按播放时钟取出当前应当显示的帧：丢弃已经过时的帧，
+    // 下一帧还没到显示时间时返回nullptr（继续沿用当前纹理）
+    const VideoFrame *acquireCurrentFrame();
+    // 阻塞等待，直到至少有一帧就绪（不取出）或超过timeoutMs毫秒
+    bool waitForFrame(int timeoutMs);
+    // 归还acquireFrame取得的帧，槽位交还给解码线程复用
+    void releaseFrame();
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    double getFps() const { return m_fps; }
+    VideoPixelFormat getPixelFormat() const { return m_format; }
+    const PlaybackClock &getClock() const { return m_clock; }
+
+    // 播放统计：解码线程用 grab() 跳过的帧数，渲染线程丢弃的过时帧数
+    long getSkippedFrames() const { return m_skippedFrames.load(); }
+    long getDroppedFrames() const { return m_droppedFrames.load(); }
+
+    // 解码线程把 grab/retrieve 的耗时记录到 profiler，需要在 open 之前设置；profiler 的生命周期须长于解码线程
+    void setProfiler(FrameProfiler *profiler) { m_profiler = profiler; }
+
+   private:
+    void decodeLoop();
+    bool openCapture(const std::string &filepath, VideoPixelFormat format);
+    bool decodeInto(VideoFrame &slot);
+    void replayFromCache(VideoFrame &slot, double &pts);
+    // 从当前解码实例读一帧，读不到（结尾或出错）时返回 false
+    bool readFromCapture(VideoFrame &slot, double &pts);
+    void skipLateFrames();
+    // 播放到结尾时的处理，返回false表示无法继续解码
+    bool handleEndOfStream();
+    // 在后台线程中打开备用解码实例，并前进到预读缓存之后的位置
+    void prepareStandby();
+
+    std::unique_ptr<cv::VideoCapture> m_capture;
+    FrameProfiler *m_profiler = nullptr;  // 可以为空
+    std::string m_filepath;
+    std::vector<VideoFrame> m_ring;  // 固定容量的帧环形缓冲区
+    size_t m_head;                   // 最早的就绪帧所在槽位
+    size_t m_count;                  // 就绪帧数量
+    bool m_acquired;                 // 渲染线程是否正持有m_head槽位
+
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;   // 有空闲槽位，唤醒解码线程
+    std::condition_variable m_notEmpty;  // 有就绪帧，唤醒等待的渲染线程
+
+    std::thread m_worker;
+    std::atomic<bool> m_running;
+
+    int m_width;
+    int m_height;
+    double m_fps;
+    VideoPixelFormat m_format;
+    long m_decodedFrames;
+
+    // 播放时钟在渲染线程取到第一帧时开始（acquireCurrentFrame），open 时重置，两个线程都读取，内部为原子变量
+    PlaybackClock m_clock;
+    // 以下只在解码线程中修改
+    long m_streamFrame;         // 当前这一轮播放中已经读过的帧数（包括跳过的帧）
+    double m_lastStreamPtsMs;   // 当前这一轮中最后一帧的时间戳
+    double m_loopOffsetMs;      // 循环播放累计的时间偏移，保证时间戳单调递增
+    std::atomic<long> m_skippedFrames;
+    std::atomic<long> m_droppedFrames;
+
+    // 无缝循环相关，只在解码线程中访问（m_standby 在 m_standbyReady 完成前归后台线程所有）
+    LoopMode m_loopMode;
+    int m_prerollFrames;                          // 预读缓存的帧数
+    std::vector<VideoFrame> m_preroll;            // 第一轮播放时顺带缓存的开头若干帧
+    int m_prerollCount;                           // 已缓存的帧数
+    int m_replayPos;                              // 正在回放的缓存位置，-1表示不在回放
+    bool m_firstPass;                             // 是否处于第一轮播放
+    bool m_cacheHoldsAll;                         // 视频总帧数不超过缓存容量，之后全部从缓存循环
+    std::unique_ptr<cv::VideoCapture> m_standby;  // 备用解码实例，已定位到缓存之后的那一帧
+    std::future<bool> m_standbyReady;
+};
+
+#endif  // VIDEODECODER_H
@@ -0,0 +1,476 @@
+/**
+* @file        :VirtualTexture.cpp
+* @brief       :分页的虚拟纹理实现
+* @details     :页表texel为 RGBA8UI：槽位的列、行，实际驻留的层级，有效标志；页表按层上下排列在同一张纹理中，
+*               第 level 层从 m_pageRows[level] 行开始。反馈缓冲区为 RGBA16UI：页的列、行、层级、是否命中球面
+* @date        :2026/10/16 23:10:40
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+static const char *virtualTextureSource = R"(
+    uniform usampler2D m_vtPageTable;  // 每层每页一个texel：槽位列、行，驻留层级，有效标志
+    uniform vec2 m_vtImageSize;        // 第0层的像素尺寸
+    uniform float m_vtTileSize;        // 每页的像素数（不含边框）
+    uniform float m_vtBorder;          // 每页四周的边框像素数
+    uniform float m_vtAtlasSize;       // 物理页缓存纹理的边长
+    uniform int m_vtLevelCount;
+    uniform int m_vtPageRow[16];       // 每层在页表中的起始行
+    uniform float m_vtLodBias;         // 反馈缓冲区缩小的倍数取 log2，正常绘制为0
+
+    // 与 CPU 端的金字塔一致：每层宽高为上一层的一半向上取整
+    vec2 vtLevelSize(int level) {
+        return ceil(m_vtImageSize / exp2(float(level)));
+    }
+    int vtLevel(vec2 uvDx, vec2 uvDy) {
+        vec2 dx = uvDx * m_vtImageSize;
+        vec2 dy = uvDy * m_vtImageSize;
+        float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) - m_vtLodBias;
+        return clamp(int(floor(lod)), 0, m_vtLevelCount - 1);
+    }
+    ivec2 vtTile(vec2 uv, int level) {
+        vec2 size = vtLevelSize(level);
+        vec2 tiles = ceil(size / m_vtTileSize);
+        return ivec2(clamp(floor(uv * size / m_vtTileSize), vec2(0.0), tiles - 1.0));
+    }
+    // 页未驻留时页表给出最近的已驻留祖先页，按它所在的层级重新计算页内坐标
+    vec4 sampleVirtual(sampler2D atlas, vec2 uv, vec2 uvDx, vec2 uvDy) {
+        int level = vtLevel(uvDx, uvDy);
+        ivec2 tile = vtTile(uv, level);
+        uvec4 entry = texelFetch(m_vtPageTable, ivec2(tile.x, m_vtPageRow[level] + tile.y), 0);
+        int resident = int(entry.b);
+        vec2 offset = uv * vtLevelSize(resident) - vec2(vtTile(uv, resident)) * m_vtTileSize;
+        vec2 slot = vec2(entry.rg) * (m_vtTileSize + 2.0 * m_vtBorder);
+        return textureLod(atlas, (slot + m_vtBorder + offset) / m_vtAtlasSize, 0.0);
+    }
+)";
+
+// 与光线投射绘制相同的全屏三角形，每个像素输出它需要的页
+static const char *feedbackVertexSource = R"(
+    #version 330 core
+    out vec2 NdcPos;
+    void main() {
+        NdcPos = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+        gl_Position = vec4(NdcPos, 0.0, 1.0);
+    }
+)";
+
+static const char *feedbackFragmentMain = R"(
+    in vec2 NdcPos;
+    out uvec4 Request;
+    uniform mat4 m_invViewProj;
+    uniform vec3 m_eye;
+    const float PI = 3.14159265358979;
+    void main() {
+        vec4 nearPoint = m_invViewProj * vec4(NdcPos, -1.0, 1.0);
+        vec4 farPoint = m_invViewProj * vec4(NdcPos, 1.0, 1.0);
+        vec3 dir = normalize(farPoint.xyz / farPoint.w - nearPoint.xyz / nearPoint.w);
+        float b = dot(m_eye, dir);
+        float disc = b * b - (dot(m_eye, m_eye) - 1.0);
+        float s = sqrt(max(disc, 0.0));
+        float t = -b - s;
+        if (t <= 1e-4) t = -b + s;
+        bool hit = disc >= 0.0 && t > 1e-4;
+        vec3 p = m_eye + max(t, 0.0) * dir;
+        vec2 uv = vec2(fract(atan(p.z, p.x) / (2.0 * PI)), acos(clamp(p.y, -1.0, 1.0)) / PI);
+        vec2 uvDx = dFdx(uv);
+        vec2 uvDy = dFdy(uv);
+        uvDx.x -= floor(uvDx.x + 0.5);
+        uvDy.x -= floor(uvDy.x + 0.5);
+        int level = vtLevel(uvDx, uvDy);
+        ivec2 tile = vtTile(uv, level);
+        Request = hit ? uvec4(uvec2(tile), uint(level), 1u) : uvec4(0u);
+    }
+)";
+
+static GLuint compileShader(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+        std::cerr << "ERROR::SHADER::VIRTUALTEXTURE::COMPILATION_FAILED\n"
+                  << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+VirtualTexture::VirtualTexture()
+    : m_atlas(0), m_pageTable(0), m_slotsPerSide(0), m_atlasSize(0), m_pageTableWidth(0), m_pageTableHeight(0), m_pageTableDirty(false), m_feedbackProgram(0), m_feedbackVao(0), m_feedbackFbo(0), m_feedbackColor(0), m_feedbackIndex(0), m_feedbackWidth(0), m_feedbackHeight(0), m_feedbackLodBias(0.0f), m_feedbackInvViewProj(-1), m_feedbackEye(-1), m_frame(0) {
+    m_feedbackPbo[0] = m_feedbackPbo[1] = 0;
+    m_feedbackPending[0] = m_feedbackPending[1] = false;
+}
+
+const char *VirtualTexture::getShaderSource() {
+    return virtualTextureSource;
+}
+
+bool VirtualTexture::init(std::shared_ptr<TileSource> source, int slotsPerSide) {
+    release();
+    m_source = source;
+    if (m_source->getLevelCount() > MAX_LEVELS) {
+        std::cerr << "Virtual texture: " << m_source->getLevelCount() << " levels exceed the limit of " << MAX_LEVELS << "." << std::endl;
+        return false;
+    }
+
+    // 物理页缓存
+    int slotSize = m_source->getSlotSize();
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    m_slotsPerSide = std::max(1, std::min(std::min(slotsPerSide, maxSize / slotSize), 255));
+    if (m_slotsPerSide != slotsPerSide) {
+        std::cerr << "Virtual texture cache of " << slotsPerSide << "x" << slotsPerSide << " tiles not available, use " << m_slotsPerSide << "x" << m_slotsPerSide << "." << std::endl;
+    }
+    m_atlasSize = m_slotsPerSide * slotSize;
+    m_slots.assign(m_slotsPerSide * m_slotsPerSide, Slot());
+    glGenTextures(1, &m_atlas);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, m_atlasSize, m_atlasSize, 0, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // 页表，各层上下排列；整数纹理只能用最近邻过滤
+    m_pageRows.clear();
+    m_pageTableWidth = m_source->getTilesX(0);
+    m_pageTableHeight = 0;
+    for (int level = 0; level < m_source->getLevelCount(); level++) {
+        m_pageRows.push_back(m_pageTableHeight);
+        m_pageTableHeight += m_source->getTilesY(level);
+    }
+    m_pageTableData.assign((size_t)m_pageTableWidth * m_pageTableHeight * 4, 0);
+    glGenTextures(1, &m_pageTable);
+    glBindTexture(GL_TEXTURE_2D, m_pageTable);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8UI, m_pageTableWidth, m_pageTableHeight, 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // 最粗的一层常驻，保证页表中每一项都有可以退回的祖先页
+    int top = m_source->getLevelCount() - 1;
+    for (int ty = 0; ty < m_source->getTilesY(top); ty++) {
+        for (int tx = 0; tx < m_source->getTilesX(top); tx++) {
+            if (!loadTile(tileKey(top, tx, ty), true)) {
+                std::cerr << "Virtual texture: cannot load the coarsest level." << std::endl;
+                release();
+                return false;
+            }
+        }
+    }
+    rebuildPageTable();
+
+    // 反馈程序
+    std::string fragmentSource = std::string("#version 330 core\n") + virtualTextureSource + feedbackFragmentMain;
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, feedbackVertexSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource.c_str());
+    if (!vertexShader || !fragmentShader) {
+        release();
+        return false;
+    }
+    m_feedbackProgram = glCreateProgram();
+    glAttachShader(m_feedbackProgram, vertexShader);
+    glAttachShader(m_feedbackProgram, fragmentShader);
+    glLinkProgram(m_feedbackProgram);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    GLint success;
+    glGetProgramiv(m_feedbackProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(m_feedbackProgram, 512, nullptr, infoLog);
+        std::cerr << "ERROR::SHADER::VIRTUALTEXTURE::LINKING_FAILED\n"
+                  << infoLog << std::endl;
+        release();
+        return false;
+    }
+    m_feedbackInvViewProj = glGetUniformLocation(m_feedbackProgram, "m_invViewProj");
+    m_feedbackEye = glGetUniformLocation(m_feedbackProgram, "m_eye");
+    glUseProgram(m_feedbackProgram);
+    applyUniforms(m_feedbackProgram);
+    glUseProgram(0);
+    glGenVertexArrays(1, &m_feedbackVao);
+    glGenFramebuffers(1, &m_feedbackFbo);
+    glGenBuffers(2, m_feedbackPbo);
+
+    std::cout << "Virtual texture: " << m_source->getWidth() << "x" << m_source->getHeight() << ", " << m_source->getLevelCount() << " levels of " << m_source->getTileSize() << "px tiles, cache "
+              << m_slotsPerSide << "x" << m_slotsPerSide << " tiles (" << m_atlasSize << "px)" << std::endl;
+    return true;
+}
+
+void VirtualTexture::release() {
+    if (m_atlas) glDeleteTextures(1, &m_atlas);
+    if (m_pageTable) glDeleteTextures(1, &m_pageTable);
+    if (m_feedbackProgram) glDeleteProgram(m_feedbackProgram);
+    if (m_feedbackVao) glDeleteVertexArrays(1, &m_feedbackVao);
+    if (m_feedbackFbo) glDeleteFramebuffers(1, &m_feedbackFbo);
+    if (m_feedbackColor) glDeleteRenderbuffers(1, &m_feedbackColor);
+    if (m_feedbackPbo[0]) glDeleteBuffers(2, m_feedbackPbo);
+    m_atlas = m_pageTable = m_feedbackProgram = m_feedbackVao = m_feedbackFbo = m_feedbackColor = 0;
+    m_feedbackPbo[0] = m_feedbackPbo[1] = 0;
+    m_feedbackPending[0] = m_feedbackPending[1] = false;
+    m_feedbackWidth = m_feedbackHeight = 0;
+    m_slots.clear();
+    m_resident.clear();
+    m_tileBuffer.release();  // 可能引用数据源映射的内存，先于数据源释放
+    m_source.reset();
+}
+
+void VirtualTexture::applyUniforms(GLuint program) const {
+    glUniform1i(glGetUniformLocation(program, "m_vtPageTable"), PAGE_TABLE_UNIT);
+    if (!m_source) return;
+    glUniform2f(glGetUniformLocation(program, "m_vtImageSize"), (float)m_source->getWidth(), (float)m_source->getHeight());
+    glUniform1f(glGetUniformLocation(program, "m_vtTileSize"), (float)m_source->getTileSize());
+    glUniform1f(glGetUniformLocation(program, "m_vtBorder"), (float)m_source->getBorder());
+    glUniform1f(glGetUniformLocation(program, "m_vtAtlasSize"), (float)m_atlasSize);
+    glUniform1i(glGetUniformLocation(program, "m_vtLevelCount"), m_source->getLevelCount());
+    glUniform1iv(glGetUniformLocation(program, "m_vtPageRow"), (GLsizei)m_pageRows.size(), m_pageRows.data());
+    glUniform1f(glGetUniformLocation(program, "m_vtLodBias"), 0.0f);
+}
+
+bool VirtualTexture::createFeedbackTarget(int width, int height) {
+    if (width == m_feedbackWidth && height == m_feedbackHeight) return true;
+    if (m_feedbackColor) glDeleteRenderbuffers(1, &m_feedbackColor);
+    glGenRenderbuffers(1, &m_feedbackColor);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_feedbackColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA16UI, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_feedbackColor);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Virtual texture feedback framebuffer not complete! Error code: " << status << std::endl;
+        return false;
+    }
+
+    size_t bytes = (size_t)width * height * 4 * sizeof(unsigned short);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_feedbackPbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        m_feedbackPending[i] = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_feedbackWidth = width;
+    m_feedbackHeight = height;
+    return true;
+}
+
+void VirtualTexture::renderFeedback(const glm::mat4 &projection, const glm::mat4 &view) {
+    glm::mat4 invViewProj = glm::inverse(projection * view);
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFbo);
+    glViewport(0, 0, m_feedbackWidth, m_feedbackHeight);
+    const GLuint clearValue[4] = {0, 0, 0, 0};
+    glClearBufferuiv(GL_COLOR, 0, clearValue);
+    glUseProgram(m_feedbackProgram);
+    glUniformMatrix4fv(m_feedbackInvViewProj, 1, GL_FALSE, glm::value_ptr(invViewProj));
+    glUniform3fv(m_feedbackEye, 1, glm::value_ptr(eye));
+    glUniform1f(glGetUniformLocation(m_feedbackProgram, "m_vtLodBias"), m_feedbackLodBias);
+    glBindVertexArray(m_feedbackVao);
+    // 反馈缓冲区没有深度附件，深度测试不起作用，不需要切换
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+bool VirtualTexture::update(const glm::mat4 &projection, const glm::mat4 &view, int viewportWidth, int viewportHeight, bool complete, int maxUploads) {
+    if (!isValid()) return false;
+    m_frame++;
+    m_stats.frames++;
+
+    GLint savedDraw = 0, savedRead = 0, savedViewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedDraw);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &savedRead);
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+
+    int width = std::max(1, (viewportWidth + FEEDBACK_DOWNSCALE - 1) / FEEDBACK_DOWNSCALE);
+    int height = std::max(1, (viewportHeight + FEEDBACK_DOWNSCALE - 1) / FEEDBACK_DOWNSCALE);
+    std::vector<long long> missing;
+    bool processed = false;
+    if (createFeedbackTarget(width, height)) {
+        // 反馈缓冲区中相邻像素的导数是视口中的若干倍，层级要相应减掉
+        m_feedbackLodBias = std::log2(0.5f * ((float)viewportWidth / width + (float)viewportHeight / height));
+        renderFeedback(projection, view);
+        int count = width * height;
+        if (complete) {
+            m_feedbackData.resize((size_t)count * 4);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, width, height, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, m_feedbackData.data());
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            collectRequests(m_feedbackData.data(), count, missing);
+            processed = true;
+        } else {
+            // 本帧的反馈读入一个PBO，处理另一个PBO中上一帧的结果，不等待GPU
+            int current = m_feedbackIndex;
+            int previous = 1 - current;
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, m_feedbackPbo[current]);
+            glReadPixels(0, 0, width, height, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            m_feedbackPending[current] = true;
+            if (m_feedbackPending[previous]) {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, m_feedbackPbo[previous]);
+                const unsigned short *pixels = (const unsigned short *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)count * 4 * sizeof(unsigned short), GL_MAP_READ_BIT);
+                if (pixels) {
+                    collectRequests(pixels, count, missing);
+                    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                    processed = true;
+                }
+                m_feedbackPending[previous] = false;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            m_feedbackIndex = previous;
+        }
+    }
+
+    // 从粗到细加载，缓存放不下时剩下的页继续使用祖先页
+    // 缓存已满（槽位都被本帧用到）时停止，不算作还有待加载的页，否则会一直重绘
+    int uploads = 0;
+    bool more = false;
+    for (long long key : missing) {
+        if (!complete && uploads >= maxUploads) {
+            more = true;
+            break;
+        }
+        if (!loadTile(key, false)) break;
+        uploads++;
+    }
+    if (m_pageTableDirty) {
+        rebuildPageTable();
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, savedDraw);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, savedRead);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    return !processed || uploads > 0 || more;
+}
+
+void VirtualTexture::collectRequests(const unsigned short *pixels, int count, std::vector<long long> &missing) {
+    std::unordered_set<long long> requested;
+    for (int i = 0; i < count; i++) {
+        const unsigned short *p = pixels + 4 * i;
+        if (p[3] == 0) continue;
+        requested.insert(tileKey(p[2], p[0], p[1]));
+    }
+    m_stats.requested += (long)requested.size();
+
+    // 需要的页及其所有祖先都标记为本帧使用，缺少的祖先也一并加载，放大时先出现中间层级
+    std::unordered_set<long long> missingSet;
+    int levelCount = m_source->getLevelCount();
+    for (long long key : requested) {
+        int level = (int)(key >> 40);
+        int ty = (int)((key >> 20) & 0xFFFFF);
+        int tx = (int)(key & 0xFFFFF);
+        if (level >= levelCount || tx >= m_source->getTilesX(level) || ty >= m_source->getTilesY(level)) continue;
+        for (; level < levelCount; level++, tx >>= 1, ty >>= 1) {
+            long long k = tileKey(level, tx, ty);
+            auto it = m_resident.find(k);
+            if (it != m_resident.end()) {
+                m_slots[it->second].lastUsed = m_frame;
+            } else {
+                missingSet.insert(k);
+            }
+        }
+    }
+    missing.assign(missingSet.begin(), missingSet.end());
+    std::sort(missing.begin(), missing.end(), [](long long a, long long b) { return a > b; });
+}
+
+int VirtualTexture::findFreeSlot() {
+    // 空槽优先，否则淘汰最久未用的页；本帧用到的页不淘汰
+    int best = -1;
+    for (int i = 0; i < (int)m_slots.size(); i++) {
+        const Slot &slot = m_slots[i];
+        if (slot.key < 0) return i;
+        if (slot.pinned || slot.lastUsed >= m_frame) continue;
+        if (best < 0 || slot.lastUsed < m_slots[best].lastUsed) best = i;
+    }
+    return best;
+}
+
+bool VirtualTexture::loadTile(long long key, bool pinned) {
+    int slotIndex = findFreeSlot();
+    if (slotIndex < 0) return false;
+    int level = (int)(key >> 40);
+    int ty = (int)((key >> 20) & 0xFFFFF);
+    int tx = (int)(key & 0xFFFFF);
+    if (!m_source->readTile(level, tx, ty, m_tileBuffer)) {
+        std::cerr << "Virtual texture: cannot read tile " << tx << "," << ty << " of level " << level << std::endl;
+        return false;
+    }
+
+    Slot &slot = m_slots[slotIndex];
+    if (slot.key >= 0) {
+        m_resident.erase(slot.key);
+    }
+    slot.key = key;
+    slot.lastUsed = m_frame;
+    slot.pinned = pinned;
+    m_resident[key] = slotIndex;
+
+    int slotSize = m_source->getSlotSize();
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(m_tileBuffer.step / m_tileBuffer.elemSize()));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (slotIndex % m_slotsPerSide) * slotSize, (slotIndex / m_slotsPerSide) * slotSize, slotSize, slotSize, GL_BGR, GL_UNSIGNED_BYTE, m_tileBuffer.data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    m_stats.uploads++;
+    m_pageTableDirty = true;
+    return true;
+}
+
+void VirtualTexture::rebuildPageTable() {
+    // 从最粗的一层往细处填：驻留的页指向自己的槽位，否则沿用父页（上一层 tx/2, ty/2）的内容
+    for (int level = m_source->getLevelCount() - 1; level >= 0; level--) {
+        bool top = level == m_source->getLevelCount() - 1;
+        for (int ty = 0; ty < m_source->getTilesY(level); ty++) {
+            for (int tx = 0; tx < m_source->getTilesX(level); tx++) {
+                unsigned char *entry = &m_pageTableData[((size_t)(m_pageRows[level] + ty) * m_pageTableWidth + tx) * 4];
+                auto it = m_resident.find(tileKey(level, tx, ty));
+                if (it != m_resident.end()) {
+                    entry[0] = (unsigned char)(it->second % m_slotsPerSide);
+                    entry[1] = (unsigned char)(it->second / m_slotsPerSide);
+                    entry[2] = (unsigned char)level;
+                    entry[3] = 1;
+                } else if (!top) {
+                    const unsigned char *parent = &m_pageTableData[((size_t)(m_pageRows[level + 1] + ty / 2) * m_pageTableWidth + tx / 2) * 4];
+                    memcpy(entry, parent, 4);
+                }
+            }
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, m_pageTable);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_pageTableWidth, m_pageTableHeight, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, m_pageTableData.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    m_pageTableDirty = false;
+    m_stats.resident = (int)m_resident.size();
+    m_stats.capacity = (int)m_slots.size();
+}
+
+void VirtualTexture::resetStats() {
+    int resident = m_stats.resident;
+    int capacity = m_stats.capacity;
+    m_stats = Stats();
+    m_stats.resident = resident;
+    m_stats.capacity = capacity;
+}
@@ -0,0 +1,117 @@
+/**
+* @file        :VirtualTexture.h
+* @brief       :分页的虚拟纹理（超过 GL_MAX_TEXTURE_SIZE 的全景图像）
+* @details     :物理页缓存是一张固定大小的纹理，按页分成若干槽位；页表是一张整数纹理，每层每页一个texel，记录该页所在的槽位，
+*               未驻留的页记录最近的已驻留祖先页，着色器据此退回到较粗的层级，因此任何时候都能画出完整的画面。
+*               每帧先以缩小的分辨率画一遍反馈，每个像素输出它按屏幕导数需要的层级和页号，CPU 回读后只加载缺少的页，
+*               槽位不够时按最近最少使用淘汰，最粗的一层常驻
+* @date        :2026/10/16 23:10:40
+* @author      :cuixingxing(cuixingxing150@gmail.com)
+* @version     :1.0
+*
+* @copyright Copyright (c) 2024
+*
+*/
+
+#ifndef VIRTUALTEXTURE_H
+#define VIRTUALTEXTURE_H
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <GL/glew.h>
+#include <opencv2/opencv.hpp>
+
+#include "glm/glm.hpp"
+#include "TileSource.h"
+
+class VirtualTexture {
+   public:
+    enum { PAGE_TABLE_UNIT = 2,      // 页表使用的纹理单元，物理页缓存使用单元0（采样器 texture1）
+           FEEDBACK_DOWNSCALE = 8,   // 反馈缓冲区相对视口的缩小倍数
+           MAX_LEVELS = 16 };
+
+    struct Stats {
+        long frames = 0;
+        long requested = 0;  // 反馈中出现的不同页数的累计
+        long uploads = 0;    // 上传的页数
+        int resident = 0;    // 当前驻留的页数
+        int capacity = 0;    // 槽位总数
+    };
+
+    VirtualTexture();
+    VirtualTexture(const VirtualTexture &) = delete;
+    VirtualTexture &operator=(const VirtualTexture &) = delete;
+
+    // slotsPerSide 为物理页缓存每边的槽位数，超出 GL_MAX_TEXTURE_SIZE 时自动减小；最粗的一层在这里加载并常驻
+    bool init(std::shared_ptr<TileSource> source, int slotsPerSide);
+    // 释放物理页缓存、页表和反馈缓冲区，持有者须在上下文销毁前调用（析构时不释放 GL 对象）
+    void release();
+    bool isValid() const { return m_atlas != 0; }
+
+    // GLSL 函数 sampleVirtual(atlas, uv, uvDx, uvDy) 及其 uniform，拼接在使用它的着色器之前
+    static const char *getShaderSource();
+    // 设置程序中与虚拟纹理有关的 uniform，程序需已绑定
+    void applyUniforms(GLuint program) const;
+
+    // 按当前相机画反馈、加载缺少的页。complete 为 true 时同步回读本帧的反馈并加载全部缺页（导出时每帧都是完整的），
+    // 否则处理上一帧异步回读的反馈，最多上传 maxUploads 页。会改变当前的程序、VAO、纹理绑定，帧缓冲区和视口在返回前恢复。
+    // 返回 true 表示驻留的页还在变化（本帧有上传、还有缺页或反馈尚未处理），相机不动时也需要再画一帧
+    bool update(const glm::mat4 &projection, const glm::mat4 &view, int viewportWidth, int viewportHeight, bool complete, int maxUploads);
+
+    GLuint getAtlasTexture() const { return m_atlas; }
+    GLuint getPageTableTexture() const { return m_pageTable; }
+    const std::shared_ptr<TileSource> &getSource() const { return m_source; }
+    const Stats &getStats() const { return m_stats; }
+    void resetStats();
+
+   private:
+    struct Slot {
+        long long key = -1;   // 驻留页的键，-1 为空槽
+        long lastUsed = -1;   // 最近一次被反馈用到的帧号
+        bool pinned = false;  // 常驻，不参与淘汰
+    };
+
+    long long tileKey(int level, int tx, int ty) const { return ((long long)level << 40) | ((long long)ty << 20) | tx; }
+    bool createFeedbackTarget(int width, int height);
+    void renderFeedback(const glm::mat4 &projection, const glm::mat4 &view);
+    // 统计反馈中用到的页，返回按层级从粗到细排列的缺页
+    void collectRequests(const unsigned short *pixels, int count, std::vector<long long> &missing);
+    bool loadTile(long long key, bool pinned);
+    int findFreeSlot();
+    void rebuildPageTable();
+
+    std::shared_ptr<TileSource> m_source;
+    GLuint m_atlas;
+    GLuint m_pageTable;
+    int m_slotsPerSide;
+    int m_atlasSize;
+    std::vector<Slot> m_slots;
+    std::unordered_map<long long, int> m_resident;  // 页键 -> 槽位
+    std::vector<int> m_pageRows;                    // 每层在页表中的起始行
+    int m_pageTableWidth;
+    int m_pageTableHeight;
+    std::vector<unsigned char> m_pageTableData;
+    bool m_pageTableDirty;
+    cv::Mat m_tileBuffer;
+
+    // 反馈：整数颜色缓冲区，两个PBO轮流异步回读
+    GLuint m_feedbackProgram;
+    GLuint m_feedbackVao;
+    GLuint m_feedbackFbo;
+    GLuint m_feedbackColor;
+    GLuint m_feedbackPbo[2];
+    bool m_feedbackPending[2];
+    int m_feedbackIndex;
+    int m_feedbackWidth;
+    int m_feedbackHeight;
+    float m_feedbackLodBias;
+    GLint m_feedbackInvViewProj;
+    GLint m_feedbackEye;
+    std::vector<unsigned short> m_feedbackData;
+
+    long m_frame;
+    Stats m_stats;
+};
+
+#endif  // VIRTUALTEXTURE_H
@@ -1,22 +1,293 @@
-
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include "PanoramaRenderer.h"
+#include "CpuReprojector.h"
+#include "TraceRecorder.h"
+
+static void printUsage(const char* program) {
+    std::cout << " Usage: " << program << " [filepath] [options] [-h|--help]" << std::endl;
+    std::cout << "  filepath: Path to the panorama image, video or .ptc tile cache file." << std::endl;
+    std::cout << "  --upload direct|pbo|persistent: Video texture upload mode (default: pbo), press U to cycle at runtime." << std::endl;
+    std::cout << "  --video-format bgr|nv12: Requested video decode output (default: bgr), nv12 is converted to RGB in the fragment shader (needs the GStreamer backend)." << std::endl;
+    std::cout << "  --loop seek|gapless: Video loop mode (default: gapless), gapless replays a cache of the first frames while a standby decoder takes over." << std::endl;
+    std::cout << "  --preroll N: Number of leading video frames cached for gapless looping (default: 8)." << std::endl;
+    std::cout << "  --backend window|hidden|egl|osmesa: OpenGL context backend (default: window), egl and osmesa render offscreen without a display." << std::endl;
+    std::cout << "  --render-mode mesh|raycast: Draw a textured sphere mesh or ray-cast a full-screen triangle per pixel (default: mesh), key R toggles." << std::endl;
+    std::cout << "  --sphere-mesh strip|tipsify|list: Index layout of the sphere mesh (default: strip), cache-blocked triangle strips with primitive restart, a Tipsify-reordered or a row-major triangle list." << std::endl;
+    std::cout << "  --continuous: Redraw every frame instead of only when the view, animation, video frame or texture changes." << std::endl;
+    std::cout << "  --no-progressive: Decode the whole JPEG before the first frame instead of showing a 1/4 size preview while it decodes in the background." << std::endl;
+    std::cout << "  --virtual-texture: Page a panorama image through a tile cache by on-screen demand (always on for images larger than GL_MAX_TEXTURE_SIZE)." << std::endl;
+    std::cout << "  --vt-cache N: Tile cache of the virtual texture, N x N tiles of 256 pixels (default: 16)." << std::endl;
+    std::cout << "  --vt-uploads N: Maximum virtual texture tiles uploaded per interactive frame (default: 16), --export loads every visible tile." << std::endl;
+    std::cout << "  --gl-profile core|compat: OpenGL context profile (default: core, compat when built with PANO_LEGACY_GL)." << std::endl;
+    std::cout << "  --gl-stats: Print GL calls and skipped redundant binds per frame (and video upload/frame time stats) every 2 seconds, and the vertex cache ACMR of each sphere mesh level." << std::endl;
+    std::cout << "  --profile file: Time each frame stage (input, video decode/convert/upload, render, swap, ...) on the CPU and with GL timer queries on the GPU, and write count, mean, p50/p95/p99, max and a histogram per stage to file at exit." << std::endl;
+    std::cout << "  --hud: Show the per-stage frame time overlay from the start, key H toggles it." << std::endl;
+    std::cout << "  --trace file.json: Record render, video decode, upload and export timelines of every thread as Chrome trace events (about:tracing, Perfetto), written at exit." << std::endl;
+    std::cout << "  --trace-seconds N: Length of the --trace recording from program start (default: 10)." << std::endl;
+    std::cout << "  --export file: Render the photo animator of a panorama image to a video file and exit, works with every backend." << std::endl;
+    std::cout << "  --animator rotate|swipe|swipe_rotate: Animation used by --export (default: rotate), same as keys F1, F2 and F3." << std::endl;
+    std::cout << "  --export-size WxH: Output size of --export and --cpu-render (default: 1920x1080), independent of the window size." << std::endl;
+    std::cout << "  --export-fps N: Frame rate of --export (default: 30)." << std::endl;
+    std::cout << "  --export-supersample N: Render --export at N times the output size per axis (1, 2 or 4) and downsample on the GPU (default: 1)." << std::endl;
+    std::cout << "  --export-workers N: Export with N CPU render threads and a separate encoder thread instead of OpenGL, no GL context is created." << std::endl;
+    std::cout << "  --remap-cache MB: Memory budget of the CPU export lookup table cache, kept across exports and reported at the end (default: 256, 0 disables it)." << std::endl;
+    std::cout << "  --cpu-render file: Render one perspective view of a panorama image on the CPU (no GPU or display needed) and exit, size from --export-size." << std::endl;
+    std::cout << "  --yaw D --pitch D --fov D: View used by --cpu-render in degrees (default: 0 0 60)." << std::endl;
+    std::cout << "  --make-tile-cache file.ptc: Convert the panorama image into a tiled pyramid cache file and exit, open the .ptc instead of the image for a fast start." << std::endl;
+    std::cout << "  --tile-compression raw|png: Tile storage of --make-tile-cache (default: raw), raw tiles are uploaded straight from the memory-mapped file." << std::endl;
+    std::cout << "  -h, --help: Show this help message." << std::endl;
+    std::cout << "  Drag the mouse to adjust the viewing direction, use the scroll wheel to zoom the FOV, and keys 1, 2, and 3 represent the perspective view, asteroid, and crystal ball respectively." << std::endl;
+}
+
+static bool parseUploadMode(const std::string& value, TextureStreamer::UploadMode& mode) {
+    if (value == "direct") {
+        mode = TextureStreamer::UploadMode::DIRECT;
+    } else if (value == "pbo") {
+        mode = TextureStreamer::UploadMode::PBO;
+    } else if (value == "persistent") {
+        mode = TextureStreamer::UploadMode::PERSISTENT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// CPU 渲染使用的源图：分页缓存文件取宽度不超过 CPU_LEVEL_MAX_WIDTH 的一层，其它直接解码
+static cv::Mat loadPanorama(const std::string& filepath) {
+    cv::Mat panorama;
+    if (TileCacheFile::isTileCacheFile(filepath)) {
+        TileCacheFile cache;
+        if (cache.open(filepath)) {
+            cache.readLevel(cache.findLevel(TileSource::CPU_LEVEL_MAX_WIDTH), panorama);
+        }
+        return panorama;
+    }
+    return cv::imread(filepath, cv::IMREAD_COLOR);
+}
+
 int main(int argc, char* argv[]) {
     if (argc == 1 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help"))) {
-        std::cout << " Usage: " << argv[0] << " [filepath] [-h|--help]" << std::endl;
-        std::cout << "  filepath: Path to the panorama image or video file." << std::endl;
-        std::cout << "  -h, --help: Show this help message." << std::endl;
-        std::cout << "  Drag the mouse to adjust the viewing direction, use the scroll wheel to zoom the FOV, and keys 1, 2, and 3 represent the perspective view, asteroid, and crystal ball respectively." << std::endl;
+        printUsage(argv[0]);
         return 0;
-    } else if (argc == 2) {
-        std::string filepath = argv[1];
-        PanoramaRenderer renderer(filepath);
-        // 进入渲染循环等操作
-        renderer.renderLoop();
-    } else {
-        std::cerr << "Invalid number of arguments." << std::endl;
-        std::cout << "Usage: " << argv[0] << " [filepath] [-h|--help]" << std::endl;
+    }
+
+    std::string filepath;
+    RendererOptions options;
+    std::string exportFile;
+    PanoramaRenderer::PanoAnimator animator = PanoramaRenderer::PanoAnimator::ROTATE;
+    int exportWidth = 1920;
+    int exportHeight = 1080;
+    int exportFps = 30;
+    int exportWorkers = 0;
+    std::string cpuRenderFile;
+    std::string tileCacheFile;
+    std::string traceFile;
+    double traceSeconds = 10.0;
+    TileCacheFile::Compression tileCompression = TileCacheFile::Compression::RAW;
+    float yaw = 0.0f, pitch = 0.0f, fov = 60.0f;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--upload" && i + 1 < argc) {
+            if (!parseUploadMode(argv[++i], options.videoUploadMode)) {
+                std::cerr << "Invalid upload mode: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--video-format" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "bgr") {
+                options.videoPixelFormat = VideoPixelFormat::BGR;
+            } else if (value == "nv12") {
+                options.videoPixelFormat = VideoPixelFormat::NV12;
+            } else {
+                std::cerr << "Invalid video format: " << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--loop" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "seek") {
+                options.videoLoopMode = VideoDecoder::LoopMode::SEEK;
+            } else if (value == "gapless") {
+                options.videoLoopMode = VideoDecoder::LoopMode::GAPLESS;
+            } else {
+                std::cerr << "Invalid loop mode: " << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--preroll" && i + 1 < argc) {
+            options.videoPrerollFrames = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--render-mode" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "mesh") {
+                options.renderMode = PanoramaRenderMode::MESH;
+            } else if (value == "raycast") {
+                options.renderMode = PanoramaRenderMode::RAYCAST;
+            } else {
+                std::cerr << "Invalid render mode: " << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--sphere-mesh" && i + 1 < argc) {
+            if (!SphereData::parseIndexOrder(argv[++i], options.sphereIndexOrder)) {
+                std::cerr << "Invalid sphere mesh layout: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--profile" && i + 1 < argc) {
+            options.profileFile = argv[++i];
+        } else if (arg == "--hud") {
+            options.showProfilerHud = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (arg == "--trace-seconds" && i + 1 < argc) {
+            traceSeconds = std::max(0.1, atof(argv[++i]));
+        } else if (arg == "--continuous") {
+            options.renderOnDemand = false;
+        } else if (arg == "--no-progressive") {
+            options.progressiveLoad = false;
+        } else if (arg == "--virtual-texture") {
+            options.virtualTexture = true;
+        } else if (arg == "--vt-cache" && i + 1 < argc) {
+            options.virtualTextureCache = std::max(2, atoi(argv[++i]));
+        } else if (arg == "--vt-uploads" && i + 1 < argc) {
+            options.virtualTextureUploads = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--gl-profile" && i + 1 < argc) {
+            if (!GLContext::parseProfile(argv[++i], options.contextProfile)) {
+                std::cerr << "Invalid GL profile: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--gl-stats") {
+            options.printGLStats = true;
+        } else if (arg == "--backend" && i + 1 < argc) {
+            if (!GLContext::parseBackend(argv[++i], options.contextBackend)) {
+                std::cerr << "Invalid backend: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--export" && i + 1 < argc) {
+            exportFile = argv[++i];
+        } else if (arg == "--animator" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "rotate") {
+                animator = PanoramaRenderer::PanoAnimator::ROTATE;
+            } else if (value == "swipe") {
+                animator = PanoramaRenderer::PanoAnimator::SWIPE;
+            } else if (value == "swipe_rotate") {
+                animator = PanoramaRenderer::PanoAnimator::SWIPE_ROTATE;
+            } else {
+                std::cerr << "Invalid animator: " << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--export-size" && i + 1 < argc) {
+            int w = 0, h = 0;
+            if (sscanf(argv[++i], "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) {
+                std::cerr << "Invalid export size: " << argv[i] << std::endl;
+                return 1;
+            }
+            exportWidth = w;
+            exportHeight = h;
+        } else if (arg == "--export-fps" && i + 1 < argc) {
+            exportFps = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--export-supersample" && i + 1 < argc) {
+            options.exportSupersample = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--export-workers" && i + 1 < argc) {
+            exportWorkers = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--remap-cache" && i + 1 < argc) {
+            options.remapCacheMB = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--cpu-render" && i + 1 < argc) {
+            cpuRenderFile = argv[++i];
+        } else if (arg == "--make-tile-cache" && i + 1 < argc) {
+            tileCacheFile = argv[++i];
+        } else if (arg == "--tile-compression" && i + 1 < argc) {
+            if (!TileCacheFile::parseCompression(argv[++i], tileCompression)) {
+                std::cerr << "Invalid tile compression: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--yaw" && i + 1 < argc) {
+            yaw = (float)atof(argv[++i]);
+        } else if (arg == "--pitch" && i + 1 < argc) {
+            pitch = std::max(-89.0f, std::min(89.0f, (float)atof(argv[++i])));
+        } else if (arg == "--fov" && i + 1 < argc) {
+            fov = std::max(1.0f, std::min(120.0f, (float)atof(argv[++i])));
+        } else if (filepath.empty() && arg[0] != '-') {
+            filepath = arg;
+        } else {
+            std::cerr << "Invalid arguments: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (filepath.empty()) {
+        std::cerr << "Missing panorama file path." << std::endl;
+        printUsage(argv[0]);
         return 1;
     }
+
+    if (!traceFile.empty()) {
+        // 从这里开始记录，退出时写出文件
+        TraceRecorder::instance().start(traceFile, traceSeconds);
+        TraceRecorder::instance().setThreadName("main (render)");
+    }
+
+    if (!tileCacheFile.empty()) {
+        // 预处理：解码一次，把金字塔的全部页写入缓存文件
+        double t0 = cv::getTickCount();
+        cv::Mat panorama = cv::imread(filepath, cv::IMREAD_COLOR);
+        if (panorama.empty()) {
+            std::cerr << "can not load image: " << filepath << std::endl;
+            return 1;
+        }
+        double t1 = cv::getTickCount();
+        ImageTileSource source(panorama);
+        if (!TileCacheFile::write(tileCacheFile, source, tileCompression)) {
+            return 1;
+        }
+        double f = 1000.0 / cv::getTickFrequency();
+        printf("tile cache %s: %dx%d, %d levels, %s tiles, decode %.1f ms, write %.1f ms\n", tileCacheFile.c_str(), source.getWidth(), source.getHeight(), source.getLevelCount(),
+               TileCacheFile::compressionName(tileCompression), (t1 - t0) * f, (cv::getTickCount() - t1) * f);
+        return 0;
+    }
+
+    if (!cpuRenderFile.empty()) {
+        // 纯CPU渲染，不创建 OpenGL 上下文
+        cv::Mat panorama = loadPanorama(filepath);
+        CpuReprojector reprojector;
+        if (!reprojector.setSource(panorama)) {
+            std::cerr << "can not load image: " << filepath << std::endl;
+            return 1;
+        }
+        glm::mat4 projection, view;
+        PanoramaRenderer::getPerspectiveMatrices(fov, yaw, pitch, (float)exportWidth / exportHeight, projection, view);
+        cv::Mat result;
+        double t1 = cv::getTickCount();
+        reprojector.render(projection, view, exportWidth, exportHeight, result);
+        printf("cpu render (%s): %.3f ms\n", CpuReprojector::kernelName(reprojector.getKernel()), (cv::getTickCount() - t1) * 1000.0 / cv::getTickFrequency());
+        return cv::imwrite(cpuRenderFile, result) ? 0 : 1;
+    }
+
+    if (!exportFile.empty() && exportWorkers > 0) {
+        // 多线程CPU导出，不创建 OpenGL 上下文
+        AnimationExporter::Job job;
+        job.outputFile = exportFile;
+        job.width = exportWidth;
+        job.height = exportHeight;
+        job.fps = exportFps;
+        job.effect = PanoramaRenderer::makeAnimationEffect(animator);
+        job.panorama = loadPanorama(filepath);
+        job.workers = exportWorkers;
+        job.remapCacheBytes = (size_t)options.remapCacheMB << 20;
+        AnimationExporter exporter;
+        return exporter.run(job) ? 0 : 1;
+    }
+
+    PanoramaRenderer renderer(filepath, options);
+    if (!exportFile.empty()) {
+        // 直接导出动画视频，不进入交互，配合 egl/osmesa 后端可以在没有显示器的机器上运行
+        renderer.setPanoAnimator(animator);
+        return renderer.exportAnimationEffect(exportFile, exportWidth, exportHeight, exportFps) ? 0 : 1;
+    }
+    // 进入渲染循环等操作
+    renderer.renderLoop();
     return 0;
 }
@@ -1,6 +1,7 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <opencv2/opencv.hpp>
+#include <cstddef>
 #include <iostream>
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -26,8 +27,8 @@ ViewMode currentView = CENTER_VIEW;
 
 SphereData* sphere = nullptr;  // SphereData 实例
 
-GLuint vao, vboVertices, vboIndices, vboTexCoords;  // 顶点数组对象和缓冲对象
-GLuint shaderProgram, texture;                      // 着色器程序和纹理对象
+GLuint vao, vboVertices, vboIndices;  // 顶点数组对象和缓冲对象
+GLuint shaderProgram, texture;        // 着色器程序和纹理对象
 
 const char* vertexShaderSource = R"(
     #version 330 core
@@ -152,26 +153,21 @@ void initPanoramaRenderer(SphereData* sphereData) {
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vboVertices);
     glGenBuffers(1, &vboIndices);
-    glGenBuffers(1, &vboTexCoords);
 
     // 绑定 VAO
     glBindVertexArray(vao);
 
-    // 顶点数据
+    // 顶点数据，位置和纹理坐标交错存放
     glBindBuffer(GL_ARRAY_BUFFER, vboVertices);
-    glBufferData(GL_ARRAY_BUFFER, sphereData->getNumVertices() * sizeof(GLfloat), sphereData->getVertices(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), nullptr);
+    glBufferData(GL_ARRAY_BUFFER, sphereData->getNumVertices() * SphereData::getVertexStride(), sphereData->getVertexData(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, SphereData::getVertexStride(), (const void*)offsetof(SphereVertex, x));
     glEnableVertexAttribArray(0);
-
-    // 纹理坐标数据
-    glBindBuffer(GL_ARRAY_BUFFER, vboTexCoords);
-    glBufferData(GL_ARRAY_BUFFER, sphereData->getNumTexs() * sizeof(GLfloat), sphereData->getTexCoords(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), nullptr);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, SphereData::getVertexStride(), (const void*)offsetof(SphereVertex, u));
     glEnableVertexAttribArray(1);
 
     // 索引数据
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboIndices);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereData->getNumIndices() * sizeof(GLushort), sphereData->getIndices(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereData->getIndexBufferSize(), sphereData->getIndices(), GL_STATIC_DRAW);
 
     // 解绑 VAO
     glBindVertexArray(0);
@@ -328,7 +324,7 @@ void renderPanorama(SphereData* sphereData, glm::mat4 projection, glm::mat4 view
 
     // 绘制球体
     glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, sphereData->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    glDrawElements(GL_TRIANGLES, sphereData->getNumIndices(), sphereData->getIndexType(), 0);
     glBindVertexArray(0);
 
     glUseProgram(0);